@@ -1,27 +1,82 @@
 #pragma once
 
+#ifdef CARRAY_STATISTICS
+#include "CArrayStats.h"
+#endif
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <functional>
+#include <cstring>
+#include <initializer_list>
 #include <iterator>
+#include <memory>
+#include <new>
 #include <stdexcept>
+#include <type_traits>
+#include <utility>
 #include <assert.h>
 
-template <typename TData>
-class CArray;
+// С CARRAY_STATISTICS каждый тип массива ведёт счётчики CArrayStats
+// (отчёт - CArrayStatsRegistry::instance().report()); без него вызовы учёта
+// раскрываются в пустое выражение и ничего не стоят.
+#ifdef CARRAY_STATISTICS
+#define CARRAY_STATS(_call) statistics()._call
+#else
+#define CARRAY_STATS(_call) ((void)0)
+#endif
 
+// С CARRAY_CHECKED_ITERATORS итератор помнит границы массива и проверяет их
+// при разыменовании; без него это обычный указатель.
 template <typename TData>
-class CArrayIterator : public std::iterator<std::random_access_iterator_tag, TData>
+class CArrayIterator
 {
+  template <typename TOther>
+  friend class CArrayIterator;
+
 public:
+  typedef std::random_access_iterator_tag iterator_category;
+  typedef typename std::remove_const<TData>::type value_type;
+  typedef std::ptrdiff_t difference_type;
+  typedef TData* pointer;
+  typedef TData& reference;
+
   CArrayIterator()
-    : m_pos(-1)
-    , m_array(nullptr)
+    : m_ptr(nullptr)
+#ifdef CARRAY_CHECKED_ITERATORS
+    , m_begin(nullptr)
+    , m_end(nullptr)
+#endif
   {}
 
   CArrayIterator(
-      CArray<TData>* _array,
-      int _pos
+      TData* _ptr,
+      TData* _begin,
+      TData* _end
+    )
+    : m_ptr(_ptr)
+#ifdef CARRAY_CHECKED_ITERATORS
+    , m_begin(_begin)
+    , m_end(_end)
+#endif
+  {
+    (void)_begin;
+    (void)_end;
+  }
+
+  template <
+      typename TOther,
+      typename = typename std::enable_if<std::is_convertible<TOther*, TData*>::value>::type
+    >
+  CArrayIterator(
+      const CArrayIterator<TOther>& _other
     )
-    : m_pos(_pos)
-    , m_array(_array)
+    : m_ptr(_other.m_ptr)
+#ifdef CARRAY_CHECKED_ITERATORS
+    , m_begin(_other.m_begin)
+    , m_end(_other.m_end)
+#endif
   {}
 
   CArrayIterator(const CArrayIterator&) = default;
@@ -29,43 +84,73 @@ public:
   ~CArrayIterator() = default;
 
 public:
+  template <typename TOther>
   bool operator==(
-      const CArrayIterator& _other
+      const CArrayIterator<TOther>& _other
     ) const
   {
-    assert(m_array == _other.m_array);
-    return m_pos == _other.m_pos;
+    check_compatible(_other);
+    return m_ptr == _other.m_ptr;
   }
 
+  template <typename TOther>
   bool operator!=(
-      const CArrayIterator& _other
+      const CArrayIterator<TOther>& _other
     ) const
   {
-    assert(m_array == _other.m_array);
-    return m_pos != _other.m_pos;
+    check_compatible(_other);
+    return m_ptr != _other.m_ptr;
   }
 
+  template <typename TOther>
   bool operator<(
-      const CArrayIterator& _other
+      const CArrayIterator<TOther>& _other
+    ) const
+  {
+    check_compatible(_other);
+    return m_ptr < _other.m_ptr;
+  }
+
+  template <typename TOther>
+  bool operator>(
+      const CArrayIterator<TOther>& _other
     ) const
   {
-    assert(m_array == _other.m_array);
-    return m_pos < _other.m_pos;
+    return _other < *this;
   }
 
-  TData& operator*()
+  template <typename TOther>
+  bool operator<=(
+      const CArrayIterator<TOther>& _other
+    ) const
   {
-    return (*m_array)[m_pos];
+    return !(_other < *this);
+  }
+
+  template <typename TOther>
+  bool operator>=(
+      const CArrayIterator<TOther>& _other
+    ) const
+  {
+    return !(*this < _other);
+  }
+
+  TData& operator*() const
+  {
+#ifdef CARRAY_CHECKED_ITERATORS
+    assert(m_ptr >= m_begin && m_ptr < m_end);
+#endif
+    return *m_ptr;
   }
 
   TData* operator->() const
   {
-    return &(*m_array)[m_pos];
+    return &**this;
   }
 
   CArrayIterator& operator++()
   {
-    ++m_pos;
+    ++m_ptr;
     return *this;
   }
 
@@ -78,66 +163,213 @@ public:
 
   CArrayIterator& operator--()
   {
-    --m_pos;
+    --m_ptr;
     return *this;
   }
 
+  CArrayIterator operator--(int)
+  {
+    CArrayIterator old(*this);
+    --(*this);
+    return old;
+  }
+
   TData& operator[](
-      int _n
+      difference_type _n
     ) const
   {
-    auto tmp = *this;
-    tmp += _n;
-    return *tmp;
+    return *(*this + _n);
   }
 
   CArrayIterator& operator+=(
-      int _n
+      difference_type _n
     )
   {
-    m_pos += _n;
+    m_ptr += _n;
     return *this;
   }
 
   CArrayIterator& operator-=(
-      int _n
+      difference_type _n
     )
   {
-    return *this += -_n;
+    m_ptr -= _n;
+    return *this;
   }
 
   CArrayIterator operator+(
-      int _n
+      difference_type _n
     ) const
   {
-    return CArrayIterator(m_array, m_pos + _n);
+    CArrayIterator result(*this);
+    return result += _n;
+  }
+
+  friend CArrayIterator operator+(
+      difference_type _n,
+      const CArrayIterator& _it
+    )
+  {
+    return _it + _n;
   }
 
-  int operator-(
-      const CArrayIterator& _other
+  template <typename TOther>
+  difference_type operator-(
+      const CArrayIterator<TOther>& _other
     ) const
   {
-    return m_pos - _other.m_pos;
+    check_compatible(_other);
+    return m_ptr - _other.m_ptr;
   }
 
   CArrayIterator operator-(
-      int _n
+      difference_type _n
+    ) const
+  {
+    CArrayIterator result(*this);
+    return result -= _n;
+  }
+
+private:
+  template <typename TOther>
+  void check_compatible(
+      const CArrayIterator<TOther>& _other
     ) const
   {
-    return CArrayIterator(m_array, m_pos - _n);
+#ifdef CARRAY_CHECKED_ITERATORS
+    assert(m_begin == _other.m_begin);
+#endif
+    (void)_other;
   }
 
 private:
-  int m_pos;
-  CArray<TData>* m_array;
+  TData* m_ptr;
+#ifdef CARRAY_CHECKED_ITERATORS
+  TData* m_begin;
+  TData* m_end;
+#endif
+};
+
+// Политики роста: по текущей ёмкости и требуемому размеру (в элементах)
+// возвращают новую ёмкость не меньше требуемой.
+
+// Удвоение, пока блок меньше 64 КиБ, дальше рост в полтора раза
+struct CGeometricGrowth
+{
+  static std::size_t get_new_allocation_size(
+      std::size_t _allocationSize,
+      std::size_t _requiredSize,
+      std::size_t _elementSize
+    );
+};
+
+// Рост кусками по ChunkSize элементов
+template <std::size_t ChunkSize>
+struct CFixedChunkGrowth
+{
+  static_assert(ChunkSize > 0, "chunk size must be positive");
+
+  static std::size_t get_new_allocation_size(
+      std::size_t _allocationSize,
+      std::size_t _requiredSize,
+      std::size_t _elementSize
+    );
+};
+
+// Геометрический рост с округлением блока до целых страниц
+template <std::size_t PageSize = 4096>
+struct CPageAlignedGrowth
+{
+  static_assert(PageSize && !(PageSize & (PageSize - 1)), "page size must be a power of two");
+
+  static std::size_t get_new_allocation_size(
+      std::size_t _allocationSize,
+      std::size_t _requiredSize,
+      std::size_t _elementSize
+    );
+};
+
+
+// Распределитель может предоставить reallocate(ptr, oldSize, newSize), который
+// меняет размер блока без копирования; CArray пользуется им для тривиально
+// копируемых элементов.
+template <typename TAllocator, typename TData>
+class CArrayHasReallocate
+{
+  template <typename TOther>
+  static auto test(int) -> decltype(std::declval<TOther&>().reallocate(std::declval<TData*>(),
+                                                                       std::size_t(),
+                                                                       std::size_t()),
+                                    std::true_type());
+  template <typename>
+  static std::false_type test(...);
+
+public:
+  typedef decltype(test<TAllocator>(0)) type;
+  static const bool value = type::value;
+};
+
+// Распределители, которые всегда равны между собой: память, выделенную одним,
+// освобождает любой другой. Без is_always_equal (C++11) - по пустоте класса.
+template <typename TAllocator>
+class CArrayAllocatorAlwaysEqual
+{
+  template <typename TOther>
+  static typename TOther::is_always_equal test(int);
+  template <typename TOther>
+  static std::is_empty<TOther> test(...);
+
+public:
+  typedef decltype(test<TAllocator>(0)) type;
+  static const bool value = type::value;
+};
+
+// Место под InlineCapacity элементов внутри самого объекта: пока элементы
+// в нём помещаются, распределитель не вызывается.
+template <typename TData, std::size_t InlineCapacity>
+class CArrayInlineStorage
+{
+protected:
+  TData* inline_data() const
+  {
+    return reinterpret_cast<TData*>(const_cast<Storage*>(m_storage));
+  }
+
+private:
+  typedef typename std::aligned_storage<sizeof(TData), alignof(TData)>::type Storage;
+
+  Storage m_storage[InlineCapacity];
 };
 
 template <typename TData>
-class CArray
+class CArrayInlineStorage<TData, 0>
+{
+protected:
+  TData* inline_data() const
+  {
+    return nullptr;
+  }
+};
+
+template <
+    typename TData,
+    typename TAllocator = std::allocator<TData>,
+    std::size_t InlineCapacity = 0,
+    typename TGrowthPolicy = CGeometricGrowth
+  >
+class CArray : private TAllocator, private CArrayInlineStorage<TData, InlineCapacity>
 {
+  static_assert(std::is_same<typename TAllocator::value_type, TData>::value,
+                "allocator value_type must match the element type");
+
 public:
+  typedef TData value_type;
+  typedef TAllocator allocator_type;
+  typedef std::size_t size_type;
   typedef CArrayIterator<TData> iterator;
   typedef CArrayIterator<const TData> const_iterator;
+  typedef std::reverse_iterator<iterator> reverse_iterator;
+  typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
 
   iterator begin();
   iterator end();
@@ -145,375 +377,1406 @@ public:
   const_iterator begin() const;
   const_iterator end() const;
 
+  const_iterator cbegin() const;
+  const_iterator cend() const;
+
+  reverse_iterator rbegin();
+  reverse_iterator rend();
+
+  const_reverse_iterator rbegin() const;
+  const_reverse_iterator rend() const;
+
+  const_reverse_iterator crbegin() const;
+  const_reverse_iterator crend() const;
+
 public:
   CArray();
+  explicit CArray(
+      const TAllocator& _allocator
+    );
   CArray(
-      std::initializer_list<TData> _values
+      std::initializer_list<TData> _values,
+      const TAllocator& _allocator = TAllocator()
     );
   CArray(
       const CArray& _array
     );
+  CArray(
+      CArray&& _array
+    ) noexcept(InlineCapacity == 0 || std::is_nothrow_move_constructible<TData>::value);
   ~CArray();
 
+  CArray& operator=(
+      const CArray& _array
+    );
+  CArray& operator=(
+      CArray&& _array
+    ) noexcept(InlineCapacity == 0
+               && (std::allocator_traits<TAllocator>::propagate_on_container_move_assignment::value
+                   || CArrayAllocatorAlwaysEqual<TAllocator>::value));
+
 public:
   void push_back(
       const TData& _value
     );
+  void push_back(
+      TData&& _value
+    );
+  template <typename... TArgs>
+  void emplace_back(
+      TArgs&&... _args
+    );
   void pop_back();
   void insert(
-      unsigned int _index,
+      std::size_t _index,
       const TData& _value
     );
+  void insert(
+      std::size_t _index,
+      TData&& _value
+    );
+  template <typename... TArgs>
+  void emplace(
+      std::size_t _index,
+      TArgs&&... _args
+    );
+  template <typename TIterator>
+  void insert(
+      std::size_t _index,
+      TIterator _first,
+      TIterator _last
+    );
+  template <typename TIterator>
+  void append(
+      TIterator _first,
+      TIterator _last
+    );
+  template <typename TIterator>
+  void assign(
+      TIterator _first,
+      TIterator _last
+    );
+  void erase(
+      std::size_t _index
+    );
   void erase(
-      unsigned int _index
+      std::size_t _first,
+      std::size_t _last
+    );
+  template <typename TPredicate>
+  std::size_t erase_if(
+      TPredicate _predicate
     );
   void clear();
-  unsigned int size() const;
-  unsigned int capacity() const;
+  void swap(
+      CArray& _array
+    ) noexcept(InlineCapacity == 0
+               && (std::allocator_traits<TAllocator>::propagate_on_container_swap::value
+                   || CArrayAllocatorAlwaysEqual<TAllocator>::value));
+  std::size_t size() const;
+  std::size_t capacity() const;
+  std::size_t max_size() const;
+  void reserve(
+      std::size_t _size
+    );
+  void resize(
+      std::size_t _size
+    );
+  void resize(
+      std::size_t _size,
+      const TData& _value
+    );
+  void shrink_to_fit();
+  TData* data();
+  const TData* data() const;
   TData& operator[](
-      unsigned int _index
+      std::size_t _index
     );
+  const TData& operator[](
+      std::size_t _index
+    ) const;
+  TAllocator get_allocator() const;
 
 private:
-  unsigned int get_new_allocation_size(
-      unsigned int _requiredSize
+  typedef std::allocator_traits<TAllocator> allocator_traits;
+
+  // объекты, которые можно перемещать по памяти побайтово
+  typedef std::integral_constant<
+      bool,
+      std::is_trivially_copyable<TData>::value
+    > trivially_relocatable;
+
+  // блок можно расширить на месте средствами распределителя
+  typedef std::integral_constant<
+      bool,
+      trivially_relocatable::value && CArrayHasReallocate<TAllocator, TData>::value
+    > reallocatable;
+
+#ifdef CARRAY_STATISTICS
+  static CArrayStats& statistics();
+#endif
+  TAllocator& data_allocator();
+  bool is_equal_allocator(
+      CArray& _array
+    );
+  void copy_allocator(
+      const CArray& _array,
+      std::true_type
+    );
+  void copy_allocator(
+      const CArray& _array,
+      std::false_type
+    );
+  void move_allocator(
+      CArray& _array,
+      std::true_type
+    );
+  void move_allocator(
+      CArray& _array,
+      std::false_type
+    );
+  void swap_allocator(
+      CArray& _array,
+      std::true_type
+    );
+  void swap_allocator(
+      CArray& _array,
+      std::false_type
+    );
+  // Забирает элементы _array, оставляя себе свой распределитель; _array
+  // становится пустым. _sameAllocator - память _array можно отдать нашему
+  // распределителю, тогда буфер забирается целиком, иначе элементы
+  // переносятся поэлементно.
+  void take_elements(
+      CArray& _array,
+      bool _sameAllocator
+    );
+  bool is_inline() const;
+  std::size_t get_new_allocation_size(
+      std::size_t _requiredSize
     ) const;
   TData* allocate_memory(
-      unsigned int _size
-    ) const;
+      std::size_t _size
+    );
+  void release_memory(
+      TData* _ptr,
+      std::size_t _allocationSize
+    );
   void release_and_clear_memory(
       TData* _ptr,
-      unsigned int _objectsNumber
-    ) const;
+      std::size_t _objectsNumber,
+      std::size_t _allocationSize
+    );
+  template <typename... TArgs>
+  void construct_object(
+      TData* _ptr,
+      TArgs&&... _args
+    );
+  void destroy_objects(
+      TData* _ptr,
+      std::size_t _objectsNumber
+    );
+  template <typename TIterator>
   void copy_objects_to_data_memory(
+      TData* _to,
+      TIterator _from,
+      std::size_t _count
+    );
+  template <typename... TArgs>
+  void fill_objects_to_data_memory(
+      TData* _to,
+      std::size_t _count,
+      const TArgs&... _args
+    );
+  void move_objects_to_data_memory(
+      TData* _to,
+      TData* _from,
+      std::size_t _count,
+      std::true_type
+    );
+  void move_objects_to_data_memory(
       TData* _to,
       TData* _from,
-      unsigned int _count
+      std::size_t _count,
+      std::false_type
+    );
+  template <typename TIterator>
+  bool is_own_element(
+      TIterator _it,
+      std::true_type
     ) const;
-  void extended_copy_data(
-      unsigned int _newAllocationSize,
-      TData*& _toData,
-      unsigned int _toSize,
-      TData* _fromData,
-      unsigned int _fromSize
+  template <typename TIterator>
+  bool is_own_element(
+      TIterator _it,
+      std::false_type
     ) const;
+  template <typename TIterator>
+  void insert_range(
+      std::size_t _index,
+      TIterator _first,
+      TIterator _last,
+      std::input_iterator_tag
+    );
+  template <typename TIterator>
+  void insert_range(
+      std::size_t _index,
+      TIterator _first,
+      TIterator _last,
+      std::forward_iterator_tag
+    );
+  template <typename... TArgs>
+  void resize_objects(
+      std::size_t _size,
+      const TArgs&... _args
+    );
+  template <typename TConstructor>
+  void extended_copy_data(
+      std::size_t _newAllocationSize,
+      std::size_t _gapPos,
+      std::size_t _gapSize,
+      TConstructor _construct
+    );
+  template <typename TConstructor>
+  void extended_copy_data(
+      std::size_t _newAllocationSize,
+      std::size_t _gapPos,
+      std::size_t _gapSize,
+      TConstructor _construct,
+      std::true_type
+    );
+  template <typename TConstructor>
+  void extended_copy_data(
+      std::size_t _newAllocationSize,
+      std::size_t _gapPos,
+      std::size_t _gapSize,
+      TConstructor _construct,
+      std::false_type
+    );
+  template <typename TConstructor>
   void copy_objects_with_shift_insert(
-      int _insert_pos,
-      const TData& _value
+      std::size_t _insertPos,
+      std::size_t _count,
+      TConstructor _construct,
+      std::true_type
+    );
+  template <typename TConstructor>
+  void copy_objects_with_shift_insert(
+      std::size_t _insertPos,
+      std::size_t _count,
+      TConstructor _construct,
+      std::false_type
+    );
+  void copy_objects_with_shift_erase(
+      std::size_t _erasePos,
+      std::size_t _count,
+      std::true_type
+    );
+  void copy_objects_with_shift_erase(
+      std::size_t _erasePos,
+      std::size_t _count,
+      std::false_type
     );
-  void copy_objects_with_shift_insert_to_memory(
-      TData* _to_data,
-      TData* _from_data,
-      int _from_size,
-      int _insert_pos,
-      const TData& _value
-    ) const;
 
 private:
   TData* m_data;
-  unsigned int m_size;
-  unsigned int m_allocationSize;
+  std::size_t m_size;
+  std::size_t m_allocationSize;
 
 };
 
+template <
+    typename TData,
+    std::size_t InlineCapacity,
+    typename TAllocator = std::allocator<TData>
+  >
+using SmallCArray = CArray<TData, TAllocator, InlineCapacity>;
+
 
 // -----------------------------------------------------------------------------
 
-template<typename TData>
-typename CArray<TData>::iterator CArray<TData>::begin()
+inline std::size_t CGeometricGrowth::get_new_allocation_size(
+    std::size_t _allocationSize,
+    std::size_t _requiredSize,
+    std::size_t _elementSize
+  )
+{
+  if (_allocationSize == 0) return (_requiredSize <= 2) ? 2 : _requiredSize;
+
+  const std::size_t limit = std::size_t(-1) / _elementSize;
+  std::size_t result = _allocationSize;
+  while (result < _requiredSize)
+  {
+    // от единицы: у элемента от 64 КиБ половина единичной ёмкости - ноль
+    std::size_t increment = std::max<std::size_t>(1, (result * _elementSize < 65536) ? result : result / 2);
+    if (result > limit - increment) return _requiredSize;
+    result += increment;
+  }
+  return result;
+}
+
+template <std::size_t ChunkSize>
+std::size_t CFixedChunkGrowth<ChunkSize>::get_new_allocation_size(
+    std::size_t,
+    std::size_t _requiredSize,
+    std::size_t
+  )
+{
+  std::size_t remainder = _requiredSize % ChunkSize;
+  if (remainder == 0 || _requiredSize > std::size_t(-1) - ChunkSize) return _requiredSize;
+  return _requiredSize + ChunkSize - remainder;
+}
+
+template <std::size_t PageSize>
+std::size_t CPageAlignedGrowth<PageSize>::get_new_allocation_size(
+    std::size_t _allocationSize,
+    std::size_t _requiredSize,
+    std::size_t _elementSize
+  )
+{
+  std::size_t result = CGeometricGrowth::get_new_allocation_size(_allocationSize,
+                                                                 _requiredSize,
+                                                                 _elementSize);
+  if (result > (std::size_t(-1) - PageSize) / _elementSize) return result;
+  std::size_t bytes = (result * _elementSize + PageSize - 1) & ~(PageSize - 1);
+  return bytes / _elementSize;
+}
+
+
+// -----------------------------------------------------------------------------
+
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy>
+typename CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>::iterator CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>::begin()
+{
+  return iterator(m_data, m_data, m_data + m_size);
+}
+
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy>
+typename CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>::iterator CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>::end()
+{
+  return iterator(m_data + m_size, m_data, m_data + m_size);
+}
+
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy>
+typename CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>::const_iterator CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>::begin() const
+{
+  return const_iterator(m_data, m_data, m_data + m_size);
+}
+
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy>
+typename CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>::const_iterator CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>::end() const
+{
+  return const_iterator(m_data + m_size, m_data, m_data + m_size);
+}
+
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy>
+typename CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>::const_iterator CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>::cbegin() const
+{
+  return begin();
+}
+
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy>
+typename CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>::const_iterator CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>::cend() const
+{
+  return end();
+}
+
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy>
+typename CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>::reverse_iterator CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>::rbegin()
+{
+  return reverse_iterator(end());
+}
+
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy>
+typename CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>::reverse_iterator CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>::rend()
+{
+  return reverse_iterator(begin());
+}
+
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy>
+typename CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>::const_reverse_iterator CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>::rbegin() const
 {
-  return iterator(this, 0);
+  return const_reverse_iterator(end());
 }
 
-template<typename TData>
-typename CArray<TData>::iterator CArray<TData>::end()
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy>
+typename CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>::const_reverse_iterator CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>::rend() const
 {
-  return iterator(this, m_size);
+  return const_reverse_iterator(begin());
 }
 
-template<typename TData>
-typename CArray<TData>::const_iterator CArray<TData>::begin() const
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy>
+typename CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>::const_reverse_iterator CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>::crbegin() const
 {
-  return iterator(this, 0);
+  return rbegin();
 }
 
-template<typename TData>
-typename CArray<TData>::const_iterator CArray<TData>::end() const
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy>
+typename CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>::const_reverse_iterator CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>::crend() const
 {
-  return iterator(this, m_size);
+  return rend();
 }
 
-template<typename TData>
-CArray<TData>::CArray()
-  : m_data(nullptr)
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy>
+CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>::CArray()
+  : m_data(this->inline_data())
+  , m_size(0)
+  , m_allocationSize(InlineCapacity)
+{}
+
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy>
+CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>::CArray(
+    const TAllocator& _allocator
+  )
+  : TAllocator(_allocator)
+  , m_data(this->inline_data())
   , m_size(0)
-  , m_allocationSize(0)
+  , m_allocationSize(InlineCapacity)
 {}
 
-template<typename TData>
-CArray<TData>::CArray(
-    std::initializer_list<TData> _values
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy>
+CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>::CArray(
+    std::initializer_list<TData> _values,
+    const TAllocator& _allocator
   )
-  : m_data(static_cast<TData*>(malloc(_values.size() * sizeof(TData))))
+  : TAllocator(_allocator)
+  , m_data(this->inline_data())
   , m_size(0)
-  , m_allocationSize(_values.size())
+  , m_allocationSize(InlineCapacity)
 {
-  for (const TData& value: _values) push_back(value);
+  append(_values.begin(), _values.end());
 }
 
-template<typename TData>
-CArray<TData>::CArray(
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy>
+CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>::CArray(
     const CArray& _array
   )
-  : m_data(nullptr)
+  : TAllocator(allocator_traits::select_on_container_copy_construction(_array.get_allocator()))
+  , m_data(this->inline_data())
   , m_size(0)
-  , m_allocationSize(0)
+  , m_allocationSize(InlineCapacity)
 {
-  extended_copy_data(_array.m_size, m_data, m_size, _array.m_data, _array.m_size);
-  m_allocationSize = m_size = _array.m_size;
+  if (_array.m_size == 0) return;
+
+  if (_array.m_size > InlineCapacity)
+  {
+    m_data = allocate_memory(_array.m_size);
+    m_allocationSize = _array.m_size;
+  }
+  try
+  {
+    copy_objects_to_data_memory(m_data, _array.m_data, _array.m_size);
+  }
+  catch (...)
+  {
+    release_memory(m_data, m_allocationSize);
+    throw;
+  }
+  m_size = _array.m_size;
+}
+
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy>
+CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>::CArray(
+    CArray&& _array
+  ) noexcept(InlineCapacity == 0 || std::is_nothrow_move_constructible<TData>::value)
+  : TAllocator(std::move(_array.data_allocator()))
+  , m_data(this->inline_data())
+  , m_size(0)
+  , m_allocationSize(InlineCapacity)
+{
+  if (_array.is_inline())
+  {
+    move_objects_to_data_memory(m_data, _array.m_data, _array.m_size, trivially_relocatable());
+    m_size = _array.m_size;
+    _array.clear();
+    return;
+  }
+
+  m_data = _array.m_data;
+  m_size = _array.m_size;
+  m_allocationSize = _array.m_allocationSize;
+  _array.m_data = _array.inline_data();
+  _array.m_size = 0;
+  _array.m_allocationSize = InlineCapacity;
 }
 
-template<typename TData>
-CArray<TData>::~CArray()
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy>
+CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>::~CArray()
 {
-  release_and_clear_memory(m_data, m_size);
+  release_and_clear_memory(m_data, m_size, m_allocationSize);
 }
 
-template<typename TData>
-void CArray<TData>::push_back(
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy>
+CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>& CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>::operator=(
+    const CArray& _array
+  )
+{
+  if (this == &_array) return *this;
+
+  // копия строится целиком до изменения *this: если конструктор элемента
+  // бросит исключение, массив останется прежним, затем забирается переносом
+  typedef typename allocator_traits::propagate_on_container_copy_assignment propagate;
+  CArray array(propagate::value ? _array.get_allocator() : get_allocator());
+  array.reserve(_array.m_size);
+  array.append(_array.m_data, _array.m_data + _array.m_size);
+
+  // распределитель копии теперь и наш, так что буфер забирается целиком
+  clear();
+  copy_allocator(array, propagate());
+  take_elements(array, true);
+  return *this;
+}
+
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy>
+CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>& CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>::operator=(
+    CArray&& _array
+  ) noexcept(InlineCapacity == 0
+             && (std::allocator_traits<TAllocator>::propagate_on_container_move_assignment::value
+                 || CArrayAllocatorAlwaysEqual<TAllocator>::value))
+{
+  if (this == &_array) return *this;
+
+  typedef typename allocator_traits::propagate_on_container_move_assignment propagate;
+  if (propagate::value)
+  {
+    clear();
+    move_allocator(_array, propagate());
+    take_elements(_array, true);
+  }
+  else take_elements(_array, is_equal_allocator(_array));
+  return *this;
+}
+
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy>
+void CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>::push_back(
     const TData& _value
   )
+{
+  emplace_back(_value);
+}
+
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy>
+void CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>::push_back(
+    TData&& _value
+  )
+{
+  emplace_back(std::move(_value));
+}
+
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy>
+template<typename... TArgs>
+void CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>::emplace_back(
+    TArgs&&... _args
+  )
 {
   if (m_size < m_allocationSize)
   {
-    new (m_data + m_size) TData(_value);
+    construct_object(m_data + m_size, std::forward<TArgs>(_args)...);
+    ++m_size;
+  }
+  else if (reallocatable::value)
+  {
+    // при расширении на месте блок может переехать вместе с объектами,
+    // на которые ссылаются аргументы
+    TData value(std::forward<TArgs>(_args)...);
+    extended_copy_data(get_new_allocation_size(m_size + 1), m_size, 1, [&](TData* _to) {
+      construct_object(_to, std::move(value));
+    });
   }
   else
   {
-    unsigned int newAllocationSize = get_new_allocation_size(m_size + 1);
-    extended_copy_data(newAllocationSize, m_data, m_size, m_data, m_size);
-    new (m_data + m_size) TData(_value);
-    m_allocationSize = newAllocationSize;
+    // новый элемент создаётся до переноса старых: аргументы могут ссылаться на них
+    extended_copy_data(get_new_allocation_size(m_size + 1), m_size, 1, [&](TData* _to) {
+      construct_object(_to, std::forward<TArgs>(_args)...);
+    });
   }
-  ++m_size;
 }
 
-template<typename TData>
-void CArray<TData>::pop_back()
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy>
+void CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>::pop_back()
 {
-  m_data[--m_size].~TData();
+  destroy_objects(m_data + --m_size, 1);
 }
 
-template<typename TData>
-void CArray<TData>::insert(
-    unsigned int _index,
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy>
+void CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>::insert(
+    std::size_t _index,
     const TData& _value
   )
 {
-  if (_index == m_size) push_back(_value);
-  else
+  emplace(_index, _value);
+}
+
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy>
+void CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>::insert(
+    std::size_t _index,
+    TData&& _value
+  )
+{
+  emplace(_index, std::move(_value));
+}
+
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy>
+template<typename... TArgs>
+void CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>::emplace(
+    std::size_t _index,
+    TArgs&&... _args
+  )
+{
+  if (_index == m_size) emplace_back(std::forward<TArgs>(_args)...);
+  else if (m_size < m_allocationSize || reallocatable::value)
   {
+    // сдвиг хвоста или расширение блока на месте может переместить объекты,
+    // на которые ссылаются аргументы
+    TData value(std::forward<TArgs>(_args)...);
+    auto construct = [&](TData* _to) {
+      construct_object(_to, std::move(value));
+    };
     if (m_size < m_allocationSize)
     {
-      copy_objects_with_shift_insert(_index, _value);
-    }
-    else
-    {
-      unsigned int newAllocationSize = get_new_allocation_size(m_size + 1);
-      TData* newData = allocate_memory(newAllocationSize);
-      copy_objects_with_shift_insert_to_memory(newData, m_data, m_size, _index, _value);
-      std::swap(newData, m_data);
-      release_and_clear_memory(newData, m_size);
-      m_allocationSize = newAllocationSize;
+      copy_objects_with_shift_insert(_index, 1, construct, trivially_relocatable());
     }
-    ++m_size;
+    else extended_copy_data(get_new_allocation_size(m_size + 1), _index, 1, construct);
+  }
+  else
+  {
+    extended_copy_data(get_new_allocation_size(m_size + 1), _index, 1, [&](TData* _to) {
+      construct_object(_to, std::forward<TArgs>(_args)...);
+    });
   }
 }
 
-template<typename TData>
-void CArray<TData>::erase(
-    unsigned int _index
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy>
+template<typename TIterator>
+void CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>::insert(
+    std::size_t _index,
+    TIterator _first,
+    TIterator _last
   )
 {
-  if (_index == (m_size - 1)) pop_back();
-  else
+  insert_range(_index, _first, _last,
+               typename std::iterator_traits<TIterator>::iterator_category());
+}
+
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy>
+template<typename TIterator>
+void CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>::append(
+    TIterator _first,
+    TIterator _last
+  )
+{
+  insert(m_size, _first, _last);
+}
+
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy>
+template<typename TIterator>
+void CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>::assign(
+    TIterator _first,
+    TIterator _last
+  )
+{
+  destroy_objects(m_data, m_size);
+  m_size = 0;
+  insert(0, _first, _last);
+}
+
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy>
+void CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>::erase(
+    std::size_t _index
+  )
+{
+  copy_objects_with_shift_erase(_index, 1, trivially_relocatable());
+}
+
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy>
+void CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>::erase(
+    std::size_t _first,
+    std::size_t _last
+  )
+{
+  if (_first < _last) copy_objects_with_shift_erase(_first, _last - _first, trivially_relocatable());
+}
+
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy>
+template<typename TPredicate>
+std::size_t CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>::erase_if(
+    TPredicate _predicate
+  )
+{
+  std::size_t firstErased = 0;
+  while (firstErased < m_size && !_predicate(m_data[firstErased])) ++firstErased;
+
+  std::size_t writePos = firstErased;
+  for (std::size_t readPos = firstErased + 1; readPos < m_size; ++readPos)
   {
-    unsigned int i;
-    try
-    {
-      for (i = _index; i < (m_size - 1); ++i)
-      {
-        m_data[i].~TData();
-        new (m_data + i) TData(m_data[i + 1]);
-      }
-      m_data[m_size - 1].~TData();
-    }
-    catch(...)
-    {
-      for (++i; i < m_size; ++i) m_data[i].~TData();
-      m_size = _index;
-      throw;
-    }
-    --m_size;
+    if (!_predicate(m_data[readPos])) m_data[writePos++] = std::move(m_data[readPos]);
   }
+  CARRAY_STATS(on_shift_erase(writePos - firstErased));
+
+  std::size_t erased = m_size - writePos;
+  destroy_objects(m_data + writePos, erased);
+  m_size = writePos;
+  return erased;
+}
+
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy>
+void CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>::clear()
+{
+  release_and_clear_memory(m_data, m_size, m_allocationSize);
+  m_data = this->inline_data();
+  m_size = 0;
+  m_allocationSize = InlineCapacity;
 }
 
-template<typename TData>
-void CArray<TData>::clear()
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy>
+void CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>::swap(
+    CArray& _array
+  ) noexcept(InlineCapacity == 0
+             && (std::allocator_traits<TAllocator>::propagate_on_container_swap::value
+                 || CArrayAllocatorAlwaysEqual<TAllocator>::value))
 {
-  release_and_clear_memory(m_data, m_size);
-  m_data = nullptr;
-  m_size = m_allocationSize = 0;
+  typedef typename allocator_traits::propagate_on_container_swap propagate;
+  if (is_inline() || _array.is_inline() || (!propagate::value && !is_equal_allocator(_array)))
+  {
+    // Элементы переносятся явно через временные массивы, а распределители
+    // меняются, только если этого требует propagate_on_container_swap
+    // (переносящее присваивание смотрело бы на признак переноса). Пока
+    // распределители меняются, оба массива пусты.
+    CArray mine(get_allocator());
+    mine.take_elements(*this, true);
+    CArray theirs(_array.get_allocator());
+    theirs.take_elements(_array, true);
+    swap_allocator(_array, propagate());
+    take_elements(theirs, is_equal_allocator(theirs));
+    _array.take_elements(mine, _array.is_equal_allocator(mine));
+    return;
+  }
+
+  swap_allocator(_array, propagate());
+  std::swap(m_data, _array.m_data);
+  std::swap(m_size, _array.m_size);
+  std::swap(m_allocationSize, _array.m_allocationSize);
 }
 
-template<typename TData>
-unsigned int CArray<TData>::size() const
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy>
+std::size_t CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>::size() const
 {
   return m_size;
 }
 
-template<typename TData>
-unsigned int CArray<TData>::capacity() const
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy>
+std::size_t CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>::capacity() const
 {
   return m_allocationSize;
 }
 
-template<typename TData>
-TData& CArray<TData>::operator[](
-    unsigned int _index
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy>
+std::size_t CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>::max_size() const
+{
+  return allocator_traits::max_size(static_cast<const TAllocator&>(*this));
+}
+
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy>
+void CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>::reserve(
+    std::size_t _size
+  )
+{
+  if (_size <= m_allocationSize) return;
+  if (_size > max_size()) throw std::length_error("CArray size limit exceeded");
+  extended_copy_data(_size, m_size, 0, [](TData*) {});
+}
+
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy>
+void CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>::resize(
+    std::size_t _size
+  )
+{
+  resize_objects(_size);
+}
+
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy>
+void CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>::resize(
+    std::size_t _size,
+    const TData& _value
+  )
+{
+  resize_objects(_size, _value);
+}
+
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy>
+void CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>::shrink_to_fit()
+{
+  if (is_inline() || m_size == m_allocationSize) return;
+  if (m_size == 0) clear();
+  else extended_copy_data(m_size, m_size, 0, [](TData*) {});
+}
+
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy>
+TData* CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>::data()
+{
+  return m_data;
+}
+
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy>
+const TData* CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>::data() const
+{
+  return m_data;
+}
+
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy>
+TData& CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>::operator[](
+    std::size_t _index
   )
 {
   return m_data[_index];
 }
 
-template<typename TData>
-unsigned int CArray<TData>::get_new_allocation_size(
-    unsigned int _requiredSize
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy>
+const TData& CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>::operator[](
+    std::size_t _index
   ) const
 {
-  unsigned int result;
+  return m_data[_index];
+}
+
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy>
+TAllocator CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>::get_allocator() const
+{
+  return *this;
+}
+
+#ifdef CARRAY_STATISTICS
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy>
+CArrayStats& CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>::statistics()
+{
+  static CArrayStats stats(CArrayStatsRegistry::type_name<CArray>());
+  return stats;
+}
+#endif
+
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy>
+TAllocator& CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>::data_allocator()
+{
+  return *this;
+}
+
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy>
+bool CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>::is_equal_allocator(
+    CArray& _array
+  )
+{
+  return CArrayAllocatorAlwaysEqual<TAllocator>::value || data_allocator() == _array.data_allocator();
+}
+
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy>
+void CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>::copy_allocator(
+    const CArray& _array,
+    std::true_type
+  )
+{
+  data_allocator() = _array.get_allocator();
+}
+
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy>
+void CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>::copy_allocator(
+    const CArray&,
+    std::false_type
+  )
+{}
+
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy>
+void CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>::move_allocator(
+    CArray& _array,
+    std::true_type
+  )
+{
+  data_allocator() = std::move(_array.data_allocator());
+}
 
-  if (m_allocationSize == 0) result = (_requiredSize <= 2) ? 2 : _requiredSize;
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy>
+void CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>::move_allocator(
+    CArray&,
+    std::false_type
+  )
+{}
+
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy>
+void CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>::swap_allocator(
+    CArray& _array,
+    std::true_type
+  )
+{
+  using std::swap;
+  swap(data_allocator(), _array.data_allocator());
+}
+
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy>
+void CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>::swap_allocator(
+    CArray&,
+    std::false_type
+  )
+{}
+
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy>
+void CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>::take_elements(
+    CArray& _array,
+    bool _sameAllocator
+  )
+{
+  if (!_array.is_inline() && _sameAllocator)
+  {
+    clear();
+    m_data = _array.m_data;
+    m_size = _array.m_size;
+    m_allocationSize = _array.m_allocationSize;
+    _array.m_data = _array.inline_data();
+    _array.m_size = 0;
+    _array.m_allocationSize = InlineCapacity;
+  }
   else
   {
-    result = m_allocationSize;
-    do
-    {
-      if (result * sizeof(TData) < 65536) result *= 2;
-      else result *= 1.5;
-    } while (result < _requiredSize);
+    // память чужого распределителя и встроенный буфер забрать нельзя
+    assign(std::make_move_iterator(_array.m_data),
+           std::make_move_iterator(_array.m_data + _array.m_size));
+    _array.clear();
   }
+}
 
-  return result;
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy>
+bool CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>::is_inline() const
+{
+  return InlineCapacity > 0 && m_data == this->inline_data();
 }
 
-template<typename TData>
-TData* CArray<TData>::allocate_memory(
-    unsigned int _size
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy>
+std::size_t CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>::get_new_allocation_size(
+    std::size_t _requiredSize
   ) const
 {
-  TData* dataBlock = static_cast<TData*>(malloc(_size * sizeof(TData)));
-  if (!dataBlock) throw std::bad_alloc();
-  return dataBlock;
+  std::size_t maxSize = max_size();
+  if (_requiredSize > maxSize) throw std::length_error("CArray size limit exceeded");
+
+  std::size_t result = TGrowthPolicy::get_new_allocation_size(m_allocationSize,
+                                                              _requiredSize,
+                                                              sizeof(TData));
+  if (result > maxSize) result = maxSize;
+  assert(result >= _requiredSize);
+  return result;
 }
 
-template<typename TData>
-void CArray<TData>::release_and_clear_memory(
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy>
+TData* CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>::allocate_memory(
+    std::size_t _size
+  )
+{
+  if (_size <= InlineCapacity && !is_inline()) return this->inline_data();
+  TData* ptr = allocator_traits::allocate(data_allocator(), _size);
+  CARRAY_STATS(on_allocate(_size, _size * sizeof(TData)));
+  return ptr;
+}
+
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy>
+void CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>::release_memory(
     TData* _ptr,
-    unsigned int _objectsNumber
-  ) const
+    std::size_t _allocationSize
+  )
 {
-  for (unsigned int i = 0; i < _objectsNumber; ++i)
+  if (_ptr && _ptr != this->inline_data())
   {
-    (_ptr + i)->~TData();
+    allocator_traits::deallocate(data_allocator(), _ptr, _allocationSize);
   }
-  if (_ptr) free(_ptr);
 }
 
-template<typename TData>
-void CArray<TData>::copy_objects_to_data_memory(
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy>
+void CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>::release_and_clear_memory(
+    TData* _ptr,
+    std::size_t _objectsNumber,
+    std::size_t _allocationSize
+  )
+{
+  CARRAY_STATS(on_release(_allocationSize, _objectsNumber));
+  destroy_objects(_ptr, _objectsNumber);
+  release_memory(_ptr, _allocationSize);
+}
+
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy>
+template<typename... TArgs>
+void CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>::construct_object(
+    TData* _ptr,
+    TArgs&&... _args
+  )
+{
+  allocator_traits::construct(data_allocator(), _ptr, std::forward<TArgs>(_args)...);
+}
+
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy>
+void CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>::destroy_objects(
+    TData* _ptr,
+    std::size_t _objectsNumber
+  )
+{
+  for (std::size_t i = 0; i < _objectsNumber; ++i)
+  {
+    allocator_traits::destroy(data_allocator(), _ptr + i);
+  }
+}
+
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy>
+template<typename TIterator>
+void CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>::copy_objects_to_data_memory(
+    TData* _to,
+    TIterator _from,
+    std::size_t _count
+  )
+{
+  std::size_t i;
+  try
+  {
+    for (i = 0; i < _count; ++i, ++_from) construct_object(_to + i, *_from);
+  }
+  catch (...)
+  {
+    destroy_objects(_to, i);
+    throw;
+  }
+}
+
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy>
+template<typename... TArgs>
+void CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>::fill_objects_to_data_memory(
+    TData* _to,
+    std::size_t _count,
+    const TArgs&... _args
+  )
+{
+  std::size_t i;
+  try
+  {
+    for (i = 0; i < _count; ++i) construct_object(_to + i, _args...);
+  }
+  catch (...)
+  {
+    destroy_objects(_to, i);
+    throw;
+  }
+}
+
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy>
+void CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>::move_objects_to_data_memory(
     TData* _to,
     TData* _from,
-    unsigned int _count
-  ) const
+    std::size_t _count,
+    std::true_type
+  )
 {
-  unsigned int i;
+  if (_count) memcpy(_to, _from, _count * sizeof(TData));
+}
+
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy>
+void CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>::move_objects_to_data_memory(
+    TData* _to,
+    TData* _from,
+    std::size_t _count,
+    std::false_type
+  )
+{
+  std::size_t i;
   try
   {
-    for (i = 0; i < _count; ++i) new (_to + i) TData(_from[i]);
+    for (i = 0; i < _count; ++i) construct_object(_to + i, std::move_if_noexcept(_from[i]));
   }
   catch (...)
   {
-    release_and_clear_memory(_to, i);
+    destroy_objects(_to, i);
     throw;
   }
 }
 
-template<typename TData>
-void CArray<TData>::extended_copy_data(
-    unsigned int _newAllocationSize,
-    TData*& _toData,
-    unsigned int _toSize,
-    TData* _fromData,
-    unsigned int _fromSize
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy>
+template<typename TIterator>
+bool CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>::is_own_element(
+    TIterator _it,
+    std::true_type
+  ) const
+{
+  const TData* ptr = std::addressof(*_it);
+  return !std::less<const TData*>()(ptr, m_data) && std::less<const TData*>()(ptr, m_data + m_size);
+}
+
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy>
+template<typename TIterator>
+bool CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>::is_own_element(
+    TIterator,
+    std::false_type
   ) const
+{
+  return false;
+}
+
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy>
+template<typename TIterator>
+void CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>::insert_range(
+    std::size_t _index,
+    TIterator _first,
+    TIterator _last,
+    std::input_iterator_tag
+  )
+{
+  // длину однопроходного диапазона заранее не узнать: сначала собираем его целиком
+  CArray buffer(get_allocator());
+  for (; _first != _last; ++_first) buffer.push_back(*_first);
+  insert(_index,
+         std::make_move_iterator(buffer.m_data),
+         std::make_move_iterator(buffer.m_data + buffer.m_size));
+}
+
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy>
+template<typename TIterator>
+void CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>::insert_range(
+    std::size_t _index,
+    TIterator _first,
+    TIterator _last,
+    std::forward_iterator_tag
+  )
+{
+  std::size_t count = std::distance(_first, _last);
+  if (count == 0) return;
+
+  // диапазон из самого массива сдвиг хвоста или перенос блока испортит:
+  // сначала копируем его отдельно
+  typedef typename std::iterator_traits<TIterator>::reference reference;
+  typedef std::integral_constant<
+      bool,
+      std::is_lvalue_reference<reference>::value
+      && std::is_same<typename std::decay<reference>::type, TData>::value
+    > addressable;
+  if (is_own_element(_first, addressable()))
+  {
+    CArray buffer(get_allocator());
+    buffer.append(_first, _last);
+    insert(_index,
+           std::make_move_iterator(buffer.m_data),
+           std::make_move_iterator(buffer.m_data + buffer.m_size));
+    return;
+  }
+
+  auto construct = [&](TData* _to) {
+    copy_objects_to_data_memory(_to, _first, count);
+  };
+  if (m_size + count <= m_allocationSize)
+  {
+    copy_objects_with_shift_insert(_index, count, construct, trivially_relocatable());
+  }
+  else extended_copy_data(get_new_allocation_size(m_size + count), _index, count, construct);
+}
+
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy>
+template<typename... TArgs>
+void CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>::resize_objects(
+    std::size_t _size,
+    const TArgs&... _args
+  )
+{
+  if (_size <= m_size)
+  {
+    destroy_objects(m_data + _size, m_size - _size);
+    m_size = _size;
+    return;
+  }
+
+  std::size_t count = _size - m_size;
+  if (_size <= m_allocationSize)
+  {
+    fill_objects_to_data_memory(m_data + m_size, count, _args...);
+    m_size = _size;
+  }
+  else if (reallocatable::value)
+  {
+    // значение может лежать в самом массиве, а блок при расширении переезжает
+    const TData value(_args...);
+    extended_copy_data(get_new_allocation_size(_size), m_size, count, [&](TData* _to) {
+      fill_objects_to_data_memory(_to, count, value);
+    });
+  }
+  else
+  {
+    extended_copy_data(get_new_allocation_size(_size), m_size, count, [&](TData* _to) {
+      fill_objects_to_data_memory(_to, count, _args...);
+    });
+  }
+}
+
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy>
+template<typename TConstructor>
+void CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>::extended_copy_data(
+    std::size_t _newAllocationSize,
+    std::size_t _gapPos,
+    std::size_t _gapSize,
+    TConstructor _construct
+  )
+{
+  extended_copy_data(_newAllocationSize, _gapPos, _gapSize, _construct, reallocatable());
+}
+
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy>
+template<typename TConstructor>
+void CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>::extended_copy_data(
+    std::size_t _newAllocationSize,
+    std::size_t _gapPos,
+    std::size_t _gapSize,
+    TConstructor _construct,
+    std::true_type
+  )
+{
+  // встроенный буфер распределителю не принадлежит
+  if (!m_data || is_inline() || _newAllocationSize <= InlineCapacity)
+  {
+    extended_copy_data(_newAllocationSize, _gapPos, _gapSize, _construct, std::false_type());
+    return;
+  }
+
+  m_data = data_allocator().reallocate(m_data, m_allocationSize, _newAllocationSize);
+  // shrink_to_fit тоже идёт сюда: уменьшение блока новой памяти не выделяет
+  CARRAY_STATS(on_reallocate(_newAllocationSize,
+                             0,
+                             _newAllocationSize > m_allocationSize
+                             ? (_newAllocationSize - m_allocationSize) * sizeof(TData)
+                             : 0));
+  m_allocationSize = _newAllocationSize;
+  CARRAY_STATS(on_shift_insert(m_size - _gapPos));
+
+  TData* gap = m_data + _gapPos;
+  std::size_t tailSize = m_size - _gapPos;
+  memmove(gap + _gapSize, gap, tailSize * sizeof(TData));
+  try
+  {
+    _construct(gap);
+  }
+  catch (...)
+  {
+    memmove(gap, gap + _gapSize, tailSize * sizeof(TData));
+    throw;
+  }
+  m_size += _gapSize;
+}
+
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy>
+template<typename TConstructor>
+void CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>::extended_copy_data(
+    std::size_t _newAllocationSize,
+    std::size_t _gapPos,
+    std::size_t _gapSize,
+    TConstructor _construct,
+    std::false_type
+  )
 {
   TData* newData = allocate_memory(_newAllocationSize);
-  copy_objects_to_data_memory(newData, _fromData, _fromSize);
-  std::swap(newData, _toData);
-  release_and_clear_memory(newData, _toSize);
+  int stage = 0;
+  try
+  {
+    _construct(newData + _gapPos);
+    ++stage;
+    move_objects_to_data_memory(newData, m_data, _gapPos, trivially_relocatable());
+    ++stage;
+    move_objects_to_data_memory(newData + _gapPos + _gapSize,
+                                m_data + _gapPos,
+                                m_size - _gapPos,
+                                trivially_relocatable());
+  }
+  catch (...)
+  {
+    if (stage > 1) destroy_objects(newData, _gapPos);
+    if (stage > 0) destroy_objects(newData + _gapPos, _gapSize);
+    release_memory(newData, _newAllocationSize);
+    throw;
+  }
+  if (m_data) CARRAY_STATS(on_reallocate(_newAllocationSize, m_size, 0));
+  release_and_clear_memory(m_data, m_size, m_allocationSize);
+  m_data = newData;
+  m_size += _gapSize;
+  m_allocationSize = is_inline() ? InlineCapacity : _newAllocationSize;
 }
 
-template<typename TData>
-void CArray<TData>::copy_objects_with_shift_insert(
-    int _insert_pos,
-    const TData& _value
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy>
+template<typename TConstructor>
+void CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>::copy_objects_with_shift_insert(
+    std::size_t _insertPos,
+    std::size_t _count,
+    TConstructor _construct,
+    std::true_type
   )
 {
-  int i = m_size - 1;
+  TData* gap = m_data + _insertPos;
+  std::size_t tailSize = m_size - _insertPos;
+  CARRAY_STATS(on_shift_insert(tailSize));
+  memmove(gap + _count, gap, tailSize * sizeof(TData));
   try
   {
-    new (m_data + m_size) TData(m_data[i]);
-    for (--i; i >= _insert_pos; --i) {
-      m_data[i+1].~TData();
-      new (m_data + i + 1) TData(m_data[i]);
-    }
-    i = _insert_pos - 1;
-    m_data[_insert_pos].~TData();
-    new (m_data + _insert_pos) TData(_value);
+    _construct(gap);
   }
   catch (...)
   {
-    for (i += 2; i < (m_size + 1); ++i) (m_data + i)->~TData();
-    m_size = i + 1;
+    memmove(gap, gap + _count, tailSize * sizeof(TData));
     throw;
   }
+  m_size += _count;
 }
 
-template<typename TData>
-void CArray<TData>::copy_objects_with_shift_insert_to_memory(
-    TData* _to_data,
-    TData* _from_data,
-    int _from_size,
-    int _insert_pos,
-    const TData& _value
-  ) const
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy>
+template<typename TConstructor>
+void CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>::copy_objects_with_shift_insert(
+    std::size_t _insertPos,
+    std::size_t _count,
+    TConstructor _construct,
+    std::false_type
+  )
 {
-  int i;
+  CARRAY_STATS(on_shift_insert(m_size - _insertPos));
+  std::size_t i = m_size;
   try
   {
-    for (i = _from_size - 1; i >= _insert_pos; --i)
+    for (; i > _insertPos; --i)
     {
-      new (_to_data + i + 1) TData(_from_data[i]);
+      construct_object(m_data + i - 1 + _count, std::move_if_noexcept(m_data[i - 1]));
+      destroy_objects(m_data + i - 1, 1);
     }
-    i = _insert_pos - 1;
-    new (_to_data + i + 1) TData(_value);
-    for (--i; i >= -1; --i) new (_to_data + i + 1) TData(_from_data[i + 1]);
+    _construct(m_data + _insertPos);
   }
   catch (...)
   {
-    for (i += 2; i < (m_size + 1); ++i) (_to_data + i)->~TData();
-    if (_to_data) free(_to_data);
+    // хвост уже разорван, поэтому массив обрезается до позиции вставки
+    destroy_objects(m_data + _insertPos, i - _insertPos);
+    destroy_objects(m_data + i + _count, m_size - i);
+    m_size = _insertPos;
     throw;
   }
+  m_size += _count;
+}
+
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy>
+void CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>::copy_objects_with_shift_erase(
+    std::size_t _erasePos,
+    std::size_t _count,
+    std::true_type
+  )
+{
+  TData* gap = m_data + _erasePos;
+  CARRAY_STATS(on_shift_erase(m_size - _erasePos - _count));
+  memmove(gap, gap + _count, (m_size - _erasePos - _count) * sizeof(TData));
+  m_size -= _count;
+}
+
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy>
+void CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>::copy_objects_with_shift_erase(
+    std::size_t _erasePos,
+    std::size_t _count,
+    std::false_type
+  )
+{
+  CARRAY_STATS(on_shift_erase(m_size - _erasePos - _count));
+  for (std::size_t i = _erasePos + _count; i < m_size; ++i)
+  {
+    m_data[i - _count] = std::move(m_data[i]);
+  }
+  destroy_objects(m_data + m_size - _count, _count);
+  m_size -= _count;
 }
@@ -0,0 +1,394 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <new>
+#include <assert.h>
+
+// Монотонная арена: память выдаётся сдвигом указателя внутри блоков и
+// освобождается вся сразу в release() или деструкторе. Не потокобезопасна.
+class CMonotonicArena
+{
+public:
+  explicit CMonotonicArena(
+      std::size_t _chunkSize = 64 * 1024
+    );
+  CMonotonicArena(
+      void* _buffer,
+      std::size_t _bufferSize,
+      std::size_t _chunkSize = 64 * 1024
+    );
+  ~CMonotonicArena();
+
+  CMonotonicArena(const CMonotonicArena&) = delete;
+  CMonotonicArena& operator=(const CMonotonicArena&) = delete;
+
+public:
+  void* allocate(
+      std::size_t _bytes,
+      std::size_t _alignment = alignof(std::max_align_t)
+    );
+  void deallocate(
+      void* _ptr,
+      std::size_t _bytes
+    );
+  void release();
+  std::size_t allocated_bytes() const;
+
+private:
+  struct Chunk
+  {
+    Chunk* next;
+  };
+
+  void add_chunk(
+      std::size_t _minSize
+    );
+
+private:
+  char* m_current;
+  char* m_end;
+  Chunk* m_chunks;
+  char* m_initialBuffer;
+  std::size_t m_initialSize;
+  std::size_t m_chunkSize;
+  std::size_t m_nextChunkSize;
+  std::size_t m_allocatedBytes;
+};
+
+
+// Пул с классами размеров (степени двойки от 16 байт до 4 КиБ): освобождённые
+// блоки уходят в список своего класса и переиспользуются, новые нарезаются из
+// арены. Крупные запросы обслуживает operator new. Не потокобезопасен.
+class CSizeClassPool
+{
+public:
+  explicit CSizeClassPool(
+      std::size_t _chunkSize = 64 * 1024
+    );
+
+  CSizeClassPool(const CSizeClassPool&) = delete;
+  CSizeClassPool& operator=(const CSizeClassPool&) = delete;
+
+public:
+  void* allocate(
+      std::size_t _bytes
+    );
+  void deallocate(
+      void* _ptr,
+      std::size_t _bytes
+    );
+  void release();
+
+private:
+  enum
+  {
+    MIN_CLASS_SHIFT = 4,
+    MAX_CLASS_SHIFT = 12,
+    CLASSES_NUMBER = MAX_CLASS_SHIFT - MIN_CLASS_SHIFT + 1
+  };
+
+  struct FreeBlock
+  {
+    FreeBlock* next;
+  };
+
+  static int get_size_class(
+      std::size_t _bytes
+    );
+
+private:
+  FreeBlock* m_freeLists[CLASSES_NUMBER];
+  CMonotonicArena m_arena;
+};
+
+
+template <typename TData>
+class CArenaAllocator
+{
+  template <typename TOther>
+  friend class CArenaAllocator;
+
+public:
+  typedef TData value_type;
+
+  explicit CArenaAllocator(
+      CMonotonicArena& _arena
+    ) noexcept
+    : m_arena(&_arena)
+  {}
+
+  template <typename TOther>
+  CArenaAllocator(
+      const CArenaAllocator<TOther>& _other
+    ) noexcept
+    : m_arena(_other.m_arena)
+  {}
+
+  TData* allocate(
+      std::size_t _n
+    )
+  {
+    if (_n > std::size_t(-1) / sizeof(TData)) throw std::bad_alloc();
+    return static_cast<TData*>(m_arena->allocate(_n * sizeof(TData), alignof(TData)));
+  }
+
+  void deallocate(
+      TData* _ptr,
+      std::size_t _n
+    ) noexcept
+  {
+    m_arena->deallocate(_ptr, _n * sizeof(TData));
+  }
+
+  template <typename TOther>
+  bool operator==(
+      const CArenaAllocator<TOther>& _other
+    ) const
+  {
+    return m_arena == _other.m_arena;
+  }
+
+  template <typename TOther>
+  bool operator!=(
+      const CArenaAllocator<TOther>& _other
+    ) const
+  {
+    return m_arena != _other.m_arena;
+  }
+
+private:
+  CMonotonicArena* m_arena;
+};
+
+
+template <typename TData>
+class CPoolAllocator
+{
+  template <typename TOther>
+  friend class CPoolAllocator;
+
+public:
+  typedef TData value_type;
+
+  explicit CPoolAllocator(
+      CSizeClassPool& _pool
+    ) noexcept
+    : m_pool(&_pool)
+  {}
+
+  template <typename TOther>
+  CPoolAllocator(
+      const CPoolAllocator<TOther>& _other
+    ) noexcept
+    : m_pool(_other.m_pool)
+  {}
+
+  TData* allocate(
+      std::size_t _n
+    )
+  {
+    if (_n > std::size_t(-1) / sizeof(TData)) throw std::bad_alloc();
+    return static_cast<TData*>(m_pool->allocate(_n * sizeof(TData)));
+  }
+
+  void deallocate(
+      TData* _ptr,
+      std::size_t _n
+    ) noexcept
+  {
+    m_pool->deallocate(_ptr, _n * sizeof(TData));
+  }
+
+  template <typename TOther>
+  bool operator==(
+      const CPoolAllocator<TOther>& _other
+    ) const
+  {
+    return m_pool == _other.m_pool;
+  }
+
+  template <typename TOther>
+  bool operator!=(
+      const CPoolAllocator<TOther>& _other
+    ) const
+  {
+    return m_pool != _other.m_pool;
+  }
+
+private:
+  CSizeClassPool* m_pool;
+};
+
+
+// -----------------------------------------------------------------------------
+
+inline CMonotonicArena::CMonotonicArena(
+    std::size_t _chunkSize
+  )
+  : m_current(nullptr)
+  , m_end(nullptr)
+  , m_chunks(nullptr)
+  , m_initialBuffer(nullptr)
+  , m_initialSize(0)
+  , m_chunkSize(_chunkSize)
+  , m_nextChunkSize(_chunkSize)
+  , m_allocatedBytes(0)
+{}
+
+inline CMonotonicArena::CMonotonicArena(
+    void* _buffer,
+    std::size_t _bufferSize,
+    std::size_t _chunkSize
+  )
+  : m_current(static_cast<char*>(_buffer))
+  , m_end(static_cast<char*>(_buffer) + _bufferSize)
+  , m_chunks(nullptr)
+  , m_initialBuffer(static_cast<char*>(_buffer))
+  , m_initialSize(_bufferSize)
+  , m_chunkSize(_chunkSize)
+  , m_nextChunkSize(_chunkSize)
+  , m_allocatedBytes(0)
+{}
+
+inline CMonotonicArena::~CMonotonicArena()
+{
+  release();
+}
+
+inline void* CMonotonicArena::allocate(
+    std::size_t _bytes,
+    std::size_t _alignment
+  )
+{
+  assert(_alignment && !(_alignment & (_alignment - 1)));
+  // иначе проверка места и размер нового куска переполнятся
+  if (_bytes > std::size_t(-1) - _alignment) throw std::bad_alloc();
+
+  std::size_t padding = -reinterpret_cast<std::size_t>(m_current) & (_alignment - 1);
+  if (!m_current || std::size_t(m_end - m_current) < padding + _bytes)
+  {
+    add_chunk(_bytes + _alignment);
+    padding = -reinterpret_cast<std::size_t>(m_current) & (_alignment - 1);
+  }
+
+  char* result = m_current + padding;
+  m_current = result + _bytes;
+  m_allocatedBytes += _bytes;
+  return result;
+}
+
+inline void CMonotonicArena::deallocate(
+    void* _ptr,
+    std::size_t _bytes
+  )
+{
+  // последний выданный блок можно вернуть сдвигом указателя назад
+  if (static_cast<char*>(_ptr) + _bytes == m_current)
+  {
+    m_current = static_cast<char*>(_ptr);
+    m_allocatedBytes -= _bytes;
+  }
+}
+
+inline void CMonotonicArena::release()
+{
+  while (m_chunks)
+  {
+    Chunk* next = m_chunks->next;
+    ::operator delete(m_chunks);
+    m_chunks = next;
+  }
+  m_current = m_initialBuffer;
+  m_end = m_initialBuffer + m_initialSize;
+  m_nextChunkSize = m_chunkSize;
+  m_allocatedBytes = 0;
+}
+
+inline std::size_t CMonotonicArena::allocated_bytes() const
+{
+  return m_allocatedBytes;
+}
+
+inline void CMonotonicArena::add_chunk(
+    std::size_t _minSize
+  )
+{
+  std::size_t headerSize = (sizeof(Chunk) + alignof(std::max_align_t) - 1)
+                           & ~(alignof(std::max_align_t) - 1);
+  if (_minSize > std::size_t(-1) - headerSize) throw std::bad_alloc();
+  // нулевой размер куска из настроек удвоением не вырастет
+  std::size_t size = std::max<std::size_t>(m_nextChunkSize, 1);
+  while (size < _minSize) size = (size > std::size_t(-1) / 2) ? _minSize : size * 2;
+  // удвоение могло уйти за предел, при котором заголовок ещё помещается
+  if (size > std::size_t(-1) - headerSize) size = _minSize;
+
+  Chunk* chunk = static_cast<Chunk*>(::operator new(headerSize + size));
+  chunk->next = m_chunks;
+  m_chunks = chunk;
+  m_current = reinterpret_cast<char*>(chunk) + headerSize;
+  m_end = m_current + size;
+  m_nextChunkSize = (size > std::size_t(-1) / 2) ? size : size * 2;
+}
+
+
+inline CSizeClassPool::CSizeClassPool(
+    std::size_t _chunkSize
+  )
+  : m_arena(_chunkSize)
+{
+  for (int i = 0; i < CLASSES_NUMBER; ++i) m_freeLists[i] = nullptr;
+}
+
+inline void* CSizeClassPool::allocate(
+    std::size_t _bytes
+  )
+{
+  int sizeClass = get_size_class(_bytes);
+  if (sizeClass < 0) return ::operator new(_bytes);
+
+  FreeBlock*& freeList = m_freeLists[sizeClass];
+  if (freeList)
+  {
+    FreeBlock* block = freeList;
+    freeList = block->next;
+    return block;
+  }
+  return m_arena.allocate(std::size_t(1) << (sizeClass + MIN_CLASS_SHIFT));
+}
+
+inline void CSizeClassPool::deallocate(
+    void* _ptr,
+    std::size_t _bytes
+  )
+{
+  if (!_ptr) return;
+
+  int sizeClass = get_size_class(_bytes);
+  if (sizeClass < 0)
+  {
+    ::operator delete(_ptr);
+    return;
+  }
+
+  FreeBlock* block = static_cast<FreeBlock*>(_ptr);
+  block->next = m_freeLists[sizeClass];
+  m_freeLists[sizeClass] = block;
+}
+
+inline void CSizeClassPool::release()
+{
+  for (int i = 0; i < CLASSES_NUMBER; ++i) m_freeLists[i] = nullptr;
+  m_arena.release();
+}
+
+inline int CSizeClassPool::get_size_class(
+    std::size_t _bytes
+  )
+{
+  if (_bytes > (std::size_t(1) << MAX_CLASS_SHIFT)) return -1;
+
+  int sizeClass = 0;
+  while ((std::size_t(1) << (sizeClass + MIN_CLASS_SHIFT)) < _bytes) ++sizeClass;
+  return sizeClass;
+}
@@ -0,0 +1,831 @@
+#pragma once
+
+#include "CArray.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <assert.h>
+
+
+// Двоичный формат массива тривиально копируемых элементов: 64-байтный
+// заголовок и сразу за ним элементы как есть в памяти. Один формат у
+// потоковых carray_save/carray_load, у отображаемого CMappedArray и у
+// CPersistentArray, так что файл, записанный одним способом, читается любым.
+// Порядок байт и размер элемента - как у записавшей машины, при
+// несовпадении загрузка отказывает.
+struct CArrayFileHeader
+{
+  static const std::uint32_t Version = 1;
+  static const std::uint32_t ByteOrderMark = 0x01020304;
+
+  char magic[8];
+  std::uint32_t version;
+  std::uint32_t byteOrder;
+  std::uint64_t elementSize;
+  std::uint64_t count;
+  // контрольная сумма элементов (carray_checksum)
+  std::uint64_t checksum;
+  char reserved[24];
+};
+
+static_assert(sizeof(CArrayFileHeader) == 64, "CArrayFileHeader must stay 64 bytes");
+
+enum class CMapMode
+{
+  // только чтение, страницы общие с кешем файла
+  ReadOnly,
+  // запись разрешена, но изменения остаются в памяти процесса
+  Private
+};
+
+// Служебные функции формата файла
+struct CArrayFileFormat
+{
+  // по сколько байт carray_load наращивает массив у непозиционируемого потока
+  static const std::size_t LoadChunkBytes = std::size_t(1) << 20;
+
+  static void init_header(
+      CArrayFileHeader& _header,
+      std::size_t _elementSize,
+      std::size_t _count,
+      std::uint64_t _checksum
+    );
+  // проверяет заголовок и возвращает число элементов; _availableBytes -
+  // сколько байт данных есть после заголовка, если это известно
+  static std::size_t check_header(
+      const CArrayFileHeader& _header,
+      std::size_t _elementSize,
+      std::size_t _availableBytes = std::size_t(-1)
+    );
+  // сколько байт осталось до конца потока; size_t(-1), если поток не
+  // позиционируемый
+  static std::size_t remaining_bytes(
+      std::istream& _stream
+    );
+  static void throw_errno(
+      const char* _what
+    );
+  static std::size_t page_round(
+      std::size_t _bytes
+    );
+  static std::uint64_t rotate_left(
+      std::uint64_t _value,
+      int _shift
+    );
+};
+
+// Быстрая 64-битная контрольная сумма (не криптографическая): четыре
+// независимые цепочки по 8 байт, чтобы умножения шли параллельно.
+inline std::uint64_t carray_checksum(
+    const void* _data,
+    std::size_t _bytes
+  );
+
+// Массив пишется одним блоком после заголовка
+template <typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy>
+void carray_save(
+    std::ostream& _stream,
+    const CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>& _array
+  );
+// Прежнее содержимое _array заменяется; при ошибке формата или чтения
+// бросает std::runtime_error
+template <typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy>
+void carray_load(
+    std::istream& _stream,
+    CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>& _array
+  );
+
+
+// Массив, отображённый из файла без копирования: открытие стоит одного
+// mmap, данные подгружаются страницами при первом обращении. Контрольная
+// сумма при открытии не проверяется (это прочитало бы весь файл) - для этого
+// есть verify().
+template <typename TData>
+class CMappedArray
+{
+  static_assert(std::is_trivially_copyable<TData>::value,
+                "CMappedArray maps raw file bytes and needs trivially copyable data");
+  static_assert(alignof(TData) <= sizeof(CArrayFileHeader),
+                "elements follow the 64-byte header and cannot need stronger alignment");
+
+public:
+  typedef TData value_type;
+  typedef CArrayIterator<TData> iterator;
+  typedef CArrayIterator<const TData> const_iterator;
+
+  // запись через неконстантный доступ возможна только в CMapMode::Private,
+  // в ReadOnly-отображении она завершится SIGSEGV
+  iterator begin();
+  iterator end();
+
+  const_iterator begin() const;
+  const_iterator end() const;
+
+public:
+  explicit CMappedArray(
+      const std::string& _path,
+      CMapMode _mode = CMapMode::ReadOnly
+    );
+  CMappedArray(
+      CMappedArray&& _array
+    ) noexcept;
+  ~CMappedArray();
+
+  CMappedArray(const CMappedArray&) = delete;
+  CMappedArray& operator=(const CMappedArray&) = delete;
+
+public:
+  std::size_t size() const;
+  bool empty() const;
+  TData* data();
+  const TData* data() const;
+  TData& operator[](
+      std::size_t _index
+    );
+  const TData& operator[](
+      std::size_t _index
+    ) const;
+  // совпадает ли контрольная сумма элементов с записанной в заголовке
+  bool verify() const;
+  // скопировать в обычный массив
+  CArray<TData> to_array() const;
+
+private:
+  void* m_mapping;
+  std::size_t m_mappingSize;
+  TData* m_data;
+  std::size_t m_size;
+};
+
+
+// Растущий массив, живущий прямо в файле (MAP_SHARED): рост - ftruncate
+// файла и mremap отображения без копирования, число элементов хранится в
+// заголовке и переживает перезапуск. Ёмкость растёт геометрически; в
+// деструкторе файл обрезается по размеру. Контрольная сумма обновляется в
+// sync() и деструкторе, до этого файл с точки зрения verify() не закрыт.
+// Адреса элементов меняются при росте, как у CArray.
+template <typename TData>
+class CPersistentArray
+{
+  static_assert(std::is_trivially_copyable<TData>::value,
+                "CPersistentArray stores raw bytes in a file and needs trivially copyable data");
+  static_assert(alignof(TData) <= sizeof(CArrayFileHeader),
+                "elements follow the 64-byte header and cannot need stronger alignment");
+
+public:
+  typedef TData value_type;
+  typedef CArrayIterator<TData> iterator;
+  typedef CArrayIterator<const TData> const_iterator;
+
+  iterator begin();
+  iterator end();
+
+  const_iterator begin() const;
+  const_iterator end() const;
+
+public:
+  // открывает существующий файл или создаёт пустой
+  explicit CPersistentArray(
+      const std::string& _path
+    );
+  CPersistentArray(
+      CPersistentArray&& _array
+    ) noexcept;
+  ~CPersistentArray();
+
+  CPersistentArray(const CPersistentArray&) = delete;
+  CPersistentArray& operator=(const CPersistentArray&) = delete;
+
+public:
+  void push_back(
+      const TData& _value
+    );
+  template <typename TIterator>
+  void append(
+      TIterator _first,
+      TIterator _last
+    );
+  void pop_back();
+  void clear();
+  // новые элементы заполнены нулями (так их отдаёт ftruncate)
+  void resize(
+      std::size_t _size
+    );
+  void reserve(
+      std::size_t _size
+    );
+  std::size_t size() const;
+  bool empty() const;
+  std::size_t capacity() const;
+  TData* data();
+  const TData* data() const;
+  TData& operator[](
+      std::size_t _index
+    );
+  const TData& operator[](
+      std::size_t _index
+    ) const;
+  // пересчитать контрольную сумму и дождаться записи на диск
+  void sync();
+
+private:
+  CArrayFileHeader* header() const;
+  void remap(
+      std::size_t _capacity
+    );
+  void grow_for(
+      std::size_t _requiredSize
+    );
+
+private:
+  int m_fd;
+  void* m_mapping;
+  std::size_t m_mappingSize;
+  std::size_t m_capacity;
+};
+
+
+// -----------------------------------------------------------------------------
+
+inline std::uint64_t CArrayFileFormat::rotate_left(
+    std::uint64_t _value,
+    int _shift
+  )
+{
+  return (_value << _shift) | (_value >> (64 - _shift));
+}
+
+inline void CArrayFileFormat::init_header(
+    CArrayFileHeader& _header,
+    std::size_t _elementSize,
+    std::size_t _count,
+    std::uint64_t _checksum
+  )
+{
+  std::memset(&_header, 0, sizeof(_header));
+  std::memcpy(_header.magic, "CARRAY\0", sizeof(_header.magic));
+  _header.version = CArrayFileHeader::Version;
+  _header.byteOrder = CArrayFileHeader::ByteOrderMark;
+  _header.elementSize = _elementSize;
+  _header.count = _count;
+  _header.checksum = _checksum;
+}
+
+inline std::size_t CArrayFileFormat::check_header(
+    const CArrayFileHeader& _header,
+    std::size_t _elementSize,
+    std::size_t _availableBytes
+  )
+{
+  if (std::memcmp(_header.magic, "CARRAY\0", sizeof(_header.magic)) != 0)
+    throw std::runtime_error("CArray file: bad magic");
+  if (_header.version != CArrayFileHeader::Version)
+    throw std::runtime_error("CArray file: unsupported version");
+  if (_header.byteOrder != CArrayFileHeader::ByteOrderMark)
+    throw std::runtime_error("CArray file: byte order mismatch");
+  if (_header.elementSize != _elementSize)
+    throw std::runtime_error("CArray file: element size mismatch");
+  if (_header.count > _availableBytes / _elementSize)
+    throw std::runtime_error("CArray file: truncated data");
+  return std::size_t(_header.count);
+}
+
+inline std::size_t CArrayFileFormat::remaining_bytes(
+    std::istream& _stream
+  )
+{
+  const std::istream::pos_type position = _stream.tellg();
+  if (position == std::istream::pos_type(-1)) return std::size_t(-1);
+  _stream.seekg(0, std::ios_base::end);
+  const std::istream::pos_type end = _stream.tellg();
+  _stream.seekg(position);
+  if (!_stream || end == std::istream::pos_type(-1) || end < position)
+  {
+    _stream.clear();
+    _stream.seekg(position);
+    return std::size_t(-1);
+  }
+  return std::size_t(end - position);
+}
+
+inline void CArrayFileFormat::throw_errno(
+    const char* _what
+  )
+{
+  throw std::system_error(errno, std::generic_category(), _what);
+}
+
+inline std::size_t CArrayFileFormat::page_round(
+    std::size_t _bytes
+  )
+{
+  static const std::size_t pageSize = sysconf(_SC_PAGESIZE);
+  return (_bytes + pageSize - 1) & ~(pageSize - 1);
+}
+
+inline std::uint64_t carray_checksum(
+    const void* _data,
+    std::size_t _bytes
+  )
+{
+  static const std::uint64_t prime1 = 0x9E3779B185EBCA87ull;
+  static const std::uint64_t prime2 = 0xC2B2AE3D27D4EB4Full;
+
+  const unsigned char* bytes = static_cast<const unsigned char*>(_data);
+  std::uint64_t lanes[4] = {prime1, prime2, prime1 ^ prime2, ~prime1};
+  std::size_t pos = 0;
+  for (; pos + 32 <= _bytes; pos += 32)
+  {
+    for (int lane = 0; lane < 4; ++lane)
+    {
+      std::uint64_t word;
+      std::memcpy(&word, bytes + pos + lane * 8, 8);
+      lanes[lane] = CArrayFileFormat::rotate_left(lanes[lane] + word * prime2, 31) * prime1;
+    }
+  }
+
+  std::uint64_t hash = _bytes;
+  for (int lane = 0; lane < 4; ++lane)
+  {
+    hash = (hash ^ CArrayFileFormat::rotate_left(lanes[lane], 7 + lane * 11)) * prime1;
+  }
+  for (; pos < _bytes; ++pos) hash = (hash ^ bytes[pos]) * prime2;
+  return hash ^ (hash >> 29);
+}
+
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy>
+void carray_save(
+    std::ostream& _stream,
+    const CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>& _array
+  )
+{
+  static_assert(std::is_trivially_copyable<TData>::value, "carray_save writes raw bytes");
+
+  const std::size_t bytes = _array.size() * sizeof(TData);
+  CArrayFileHeader header;
+  CArrayFileFormat::init_header(header, sizeof(TData), _array.size(), carray_checksum(_array.data(), bytes));
+  _stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  _stream.write(reinterpret_cast<const char*>(_array.data()), std::streamsize(bytes));
+  if (!_stream) throw std::runtime_error("CArray file: write failed");
+}
+
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy>
+void carray_load(
+    std::istream& _stream,
+    CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>& _array
+  )
+{
+  static_assert(std::is_trivially_copyable<TData>::value, "carray_load reads raw bytes");
+
+  CArrayFileHeader header;
+  if (!_stream.read(reinterpret_cast<char*>(&header), sizeof(header)))
+    throw std::runtime_error("CArray file: truncated header");
+  // Счёту из заголовка верить нельзя: у повреждённого файла он может
+  // потребовать памяти больше, чем данных в потоке. Остаток позиционируемого
+  // потока известен заранее, остальные читаются кусками с ростом массива.
+  const std::size_t available = CArrayFileFormat::remaining_bytes(_stream);
+  const std::size_t count = CArrayFileFormat::check_header(header, sizeof(TData), available);
+  if (count > _array.max_size()) throw std::runtime_error("CArray file: too many elements");
+
+  // читаем во временный массив, чтобы при ошибке _array остался прежним
+  CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy> array(_array.get_allocator());
+  if (available != std::size_t(-1)) array.reserve(count);
+  const std::size_t chunk = std::max<std::size_t>(1, CArrayFileFormat::LoadChunkBytes / sizeof(TData));
+  while (array.size() < count)
+  {
+    const std::size_t offset = array.size();
+    array.resize(offset + std::min(chunk, count - offset));
+    const std::size_t bytes = (array.size() - offset) * sizeof(TData);
+    if (!_stream.read(reinterpret_cast<char*>(array.data() + offset), std::streamsize(bytes)))
+      throw std::runtime_error("CArray file: truncated data");
+  }
+  const std::size_t bytes = count * sizeof(TData);
+  if (carray_checksum(array.data(), bytes) != header.checksum)
+    throw std::runtime_error("CArray file: checksum mismatch");
+  _array = std::move(array);
+}
+
+// -----------------------------------------------------------------------------
+
+template<typename TData>
+typename CMappedArray<TData>::iterator CMappedArray<TData>::begin()
+{
+  return iterator(data(), m_data, m_data + m_size);
+}
+
+template<typename TData>
+typename CMappedArray<TData>::iterator CMappedArray<TData>::end()
+{
+  return iterator(data() + m_size, m_data, m_data + m_size);
+}
+
+template<typename TData>
+typename CMappedArray<TData>::const_iterator CMappedArray<TData>::begin() const
+{
+  return const_iterator(m_data, m_data, m_data + m_size);
+}
+
+template<typename TData>
+typename CMappedArray<TData>::const_iterator CMappedArray<TData>::end() const
+{
+  return const_iterator(m_data + m_size, m_data, m_data + m_size);
+}
+
+template<typename TData>
+CMappedArray<TData>::CMappedArray(
+    const std::string& _path,
+    CMapMode _mode
+  )
+  : m_mapping(nullptr)
+  , m_mappingSize(0)
+  , m_data(nullptr)
+  , m_size(0)
+{
+  const int fd = ::open(_path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) CArrayFileFormat::throw_errno("CMappedArray: open");
+
+  struct stat status;
+  if (fstat(fd, &status) != 0)
+  {
+    ::close(fd);
+    CArrayFileFormat::throw_errno("CMappedArray: fstat");
+  }
+  const std::size_t fileSize = std::size_t(status.st_size);
+  if (fileSize < sizeof(CArrayFileHeader))
+  {
+    ::close(fd);
+    throw std::runtime_error("CArray file: truncated header");
+  }
+
+  const int protection = _mode == CMapMode::ReadOnly ? PROT_READ : PROT_READ | PROT_WRITE;
+  void* mapping = mmap(nullptr, fileSize, protection, MAP_PRIVATE, fd, 0);
+  // отображение держит файл само, дескриптор больше не нужен
+  ::close(fd);
+  if (mapping == MAP_FAILED) CArrayFileFormat::throw_errno("CMappedArray: mmap");
+
+  try
+  {
+    m_size = CArrayFileFormat::check_header(*static_cast<const CArrayFileHeader*>(mapping),
+                                              sizeof(TData),
+                                              fileSize - sizeof(CArrayFileHeader));
+  }
+  catch (...)
+  {
+    munmap(mapping, fileSize);
+    throw;
+  }
+  m_mapping = mapping;
+  m_mappingSize = fileSize;
+  m_data = reinterpret_cast<TData*>(static_cast<char*>(mapping) + sizeof(CArrayFileHeader));
+}
+
+template<typename TData>
+CMappedArray<TData>::CMappedArray(
+    CMappedArray&& _array
+  ) noexcept
+  : m_mapping(_array.m_mapping)
+  , m_mappingSize(_array.m_mappingSize)
+  , m_data(_array.m_data)
+  , m_size(_array.m_size)
+{
+  _array.m_mapping = nullptr;
+  _array.m_mappingSize = 0;
+  _array.m_data = nullptr;
+  _array.m_size = 0;
+}
+
+template<typename TData>
+CMappedArray<TData>::~CMappedArray()
+{
+  if (m_mapping) munmap(m_mapping, m_mappingSize);
+}
+
+template<typename TData>
+std::size_t CMappedArray<TData>::size() const
+{
+  return m_size;
+}
+
+template<typename TData>
+bool CMappedArray<TData>::empty() const
+{
+  return m_size == 0;
+}
+
+template<typename TData>
+TData* CMappedArray<TData>::data()
+{
+  return m_data;
+}
+
+template<typename TData>
+const TData* CMappedArray<TData>::data() const
+{
+  return m_data;
+}
+
+template<typename TData>
+TData& CMappedArray<TData>::operator[](
+    std::size_t _index
+  )
+{
+  assert(_index < m_size);
+  return data()[_index];
+}
+
+template<typename TData>
+const TData& CMappedArray<TData>::operator[](
+    std::size_t _index
+  ) const
+{
+  assert(_index < m_size);
+  return m_data[_index];
+}
+
+template<typename TData>
+bool CMappedArray<TData>::verify() const
+{
+  const CArrayFileHeader* header = static_cast<const CArrayFileHeader*>(m_mapping);
+  return header && carray_checksum(m_data, m_size * sizeof(TData)) == header->checksum;
+}
+
+template<typename TData>
+CArray<TData> CMappedArray<TData>::to_array() const
+{
+  CArray<TData> array;
+  array.reserve(m_size);
+  array.append(m_data, m_data + m_size);
+  return array;
+}
+
+// -----------------------------------------------------------------------------
+
+template<typename TData>
+typename CPersistentArray<TData>::iterator CPersistentArray<TData>::begin()
+{
+  return iterator(data(), data(), data() + size());
+}
+
+template<typename TData>
+typename CPersistentArray<TData>::iterator CPersistentArray<TData>::end()
+{
+  return iterator(data() + size(), data(), data() + size());
+}
+
+template<typename TData>
+typename CPersistentArray<TData>::const_iterator CPersistentArray<TData>::begin() const
+{
+  return const_iterator(data(), data(), data() + size());
+}
+
+template<typename TData>
+typename CPersistentArray<TData>::const_iterator CPersistentArray<TData>::end() const
+{
+  return const_iterator(data() + size(), data(), data() + size());
+}
+
+template<typename TData>
+CPersistentArray<TData>::CPersistentArray(
+    const std::string& _path
+  )
+  : m_fd(-1)
+  , m_mapping(nullptr)
+  , m_mappingSize(0)
+  , m_capacity(0)
+{
+  m_fd = ::open(_path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+  if (m_fd < 0) CArrayFileFormat::throw_errno("CPersistentArray: open");
+
+  try
+  {
+    struct stat status;
+    if (fstat(m_fd, &status) != 0) CArrayFileFormat::throw_errno("CPersistentArray: fstat");
+    std::size_t fileSize = std::size_t(status.st_size);
+
+    CArrayFileHeader fresh;
+    if (fileSize == 0)
+    {
+      CArrayFileFormat::init_header(fresh, sizeof(TData), 0, carray_checksum(nullptr, 0));
+      if (pwrite(m_fd, &fresh, sizeof(fresh), 0) != ssize_t(sizeof(fresh)))
+        CArrayFileFormat::throw_errno("CPersistentArray: write");
+      fileSize = sizeof(fresh);
+    }
+    else if (fileSize < sizeof(CArrayFileHeader))
+    {
+      throw std::runtime_error("CArray file: truncated header");
+    }
+
+    // хвост файла после элементов - запас ёмкости от прошлого незакрытого запуска
+    const std::size_t capacity = (fileSize - sizeof(CArrayFileHeader)) / sizeof(TData);
+    m_mappingSize = CArrayFileFormat::page_round(fileSize);
+    m_mapping = mmap(nullptr, m_mappingSize, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+    if (m_mapping == MAP_FAILED)
+    {
+      m_mapping = nullptr;
+      CArrayFileFormat::throw_errno("CPersistentArray: mmap");
+    }
+    CArrayFileFormat::check_header(*header(), sizeof(TData), capacity * sizeof(TData));
+    m_capacity = capacity;
+  }
+  catch (...)
+  {
+    if (m_mapping) munmap(m_mapping, m_mappingSize);
+    ::close(m_fd);
+    throw;
+  }
+}
+
+template<typename TData>
+CPersistentArray<TData>::CPersistentArray(
+    CPersistentArray&& _array
+  ) noexcept
+  : m_fd(_array.m_fd)
+  , m_mapping(_array.m_mapping)
+  , m_mappingSize(_array.m_mappingSize)
+  , m_capacity(_array.m_capacity)
+{
+  _array.m_fd = -1;
+  _array.m_mapping = nullptr;
+  _array.m_mappingSize = 0;
+  _array.m_capacity = 0;
+}
+
+template<typename TData>
+CPersistentArray<TData>::~CPersistentArray()
+{
+  if (!m_mapping) return;
+
+  const std::size_t count = size();
+  header()->checksum = carray_checksum(data(), count * sizeof(TData));
+  munmap(m_mapping, m_mappingSize);
+  // запас ёмкости в файле не нужен: отрезаем по последнему элементу
+  // если обрезать не удалось, хвост при следующем открытии станет запасом ёмкости
+  if (ftruncate(m_fd, off_t(sizeof(CArrayFileHeader) + count * sizeof(TData))) != 0) {}
+  ::close(m_fd);
+}
+
+template<typename TData>
+void CPersistentArray<TData>::push_back(
+    const TData& _value
+  )
+{
+  const std::size_t count = size();
+  if (count == m_capacity)
+  {
+    // _value может лежать в самом массиве, а рост перенесёт отображение
+    const TData value = _value;
+    grow_for(count + 1);
+    data()[count] = value;
+  }
+  else data()[count] = _value;
+  header()->count = count + 1;
+}
+
+template<typename TData>
+template<typename TIterator>
+void CPersistentArray<TData>::append(
+    TIterator _first,
+    TIterator _last
+  )
+{
+  for (; _first != _last; ++_first) push_back(*_first);
+}
+
+template<typename TData>
+void CPersistentArray<TData>::pop_back()
+{
+  assert(size() > 0);
+  --header()->count;
+}
+
+template<typename TData>
+void CPersistentArray<TData>::clear()
+{
+  header()->count = 0;
+}
+
+template<typename TData>
+void CPersistentArray<TData>::resize(
+    std::size_t _size
+  )
+{
+  const std::size_t count = size();
+  if (_size > m_capacity) grow_for(_size);
+  // освободившееся при прошлом уменьшении место надо обнулить заново
+  if (_size > count) std::memset(static_cast<void*>(data() + count), 0, (_size - count) * sizeof(TData));
+  header()->count = _size;
+}
+
+template<typename TData>
+void CPersistentArray<TData>::reserve(
+    std::size_t _size
+  )
+{
+  if (_size > m_capacity) remap(_size);
+}
+
+template<typename TData>
+std::size_t CPersistentArray<TData>::size() const
+{
+  return std::size_t(header()->count);
+}
+
+template<typename TData>
+bool CPersistentArray<TData>::empty() const
+{
+  return size() == 0;
+}
+
+template<typename TData>
+std::size_t CPersistentArray<TData>::capacity() const
+{
+  return m_capacity;
+}
+
+template<typename TData>
+TData* CPersistentArray<TData>::data()
+{
+  return reinterpret_cast<TData*>(static_cast<char*>(m_mapping) + sizeof(CArrayFileHeader));
+}
+
+template<typename TData>
+const TData* CPersistentArray<TData>::data() const
+{
+  return reinterpret_cast<const TData*>(static_cast<const char*>(m_mapping) + sizeof(CArrayFileHeader));
+}
+
+template<typename TData>
+TData& CPersistentArray<TData>::operator[](
+    std::size_t _index
+  )
+{
+  assert(_index < size());
+  return data()[_index];
+}
+
+template<typename TData>
+const TData& CPersistentArray<TData>::operator[](
+    std::size_t _index
+  ) const
+{
+  assert(_index < size());
+  return data()[_index];
+}
+
+template<typename TData>
+void CPersistentArray<TData>::sync()
+{
+  header()->checksum = carray_checksum(data(), size() * sizeof(TData));
+  if (msync(m_mapping, m_mappingSize, MS_SYNC) != 0) CArrayFileFormat::throw_errno("CPersistentArray: msync");
+}
+
+template<typename TData>
+CArrayFileHeader* CPersistentArray<TData>::header() const
+{
+  return static_cast<CArrayFileHeader*>(m_mapping);
+}
+
+template<typename TData>
+void CPersistentArray<TData>::remap(
+    std::size_t _capacity
+  )
+{
+  if (_capacity > (std::size_t(-1) - 2 * sizeof(CArrayFileHeader)) / sizeof(TData))
+    throw std::length_error("CPersistentArray: too many elements");
+
+  const std::size_t fileSize = sizeof(CArrayFileHeader) + _capacity * sizeof(TData);
+  if (ftruncate(m_fd, off_t(fileSize)) != 0) CArrayFileFormat::throw_errno("CPersistentArray: ftruncate");
+
+  const std::size_t mappingSize = CArrayFileFormat::page_round(fileSize);
+  if (mappingSize != m_mappingSize)
+  {
+    void* mapping = mremap(m_mapping, m_mappingSize, mappingSize, MREMAP_MAYMOVE);
+    if (mapping == MAP_FAILED) CArrayFileFormat::throw_errno("CPersistentArray: mremap");
+    m_mapping = mapping;
+    m_mappingSize = mappingSize;
+  }
+  m_capacity = _capacity;
+}
+
+template<typename TData>
+void CPersistentArray<TData>::grow_for(
+    std::size_t _requiredSize
+  )
+{
+  remap(CGeometricGrowth::get_new_allocation_size(m_capacity, _requiredSize, sizeof(TData)));
+}
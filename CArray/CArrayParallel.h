@@ -0,0 +1,415 @@
+#pragma once
+
+#include "CArray.h"
+#include "CThreadPool.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <utility>
+
+
+// Параллельные алгоритмы над CArray поверх пула CThreadPool. Диапазон режется
+// на куски по числу потоков (с запасом для перехвата), куски мельче
+// CArrayParallelGrain не дробятся, и массив короче порога обрабатывается
+// последовательно в вызывающем потоке. Функции, переданные алгоритмам,
+// вызываются из разных потоков одновременно и не должны менять общих данных
+// без синхронизации.
+
+// меньше этого числа элементов запускать задачи дороже, чем работать самому
+const std::size_t CArrayParallelThreshold = 1 << 14;
+// минимальный кусок работы одной задачи
+const std::size_t CArrayParallelGrain = 1 << 12;
+
+
+// Вызывает _function(chunk, from, to) для _chunks равных кусков [0, _size),
+// кусок 0 выполняет вызывающий поток.
+template <typename TFunction>
+void parallel_chunks(
+    std::size_t _size,
+    std::size_t _chunks,
+    TFunction _function,
+    CThreadPool& _pool
+  );
+
+// Вызывает _function(from, to) для кусков [0, _size).
+template <typename TFunction>
+void parallel_for(
+    std::size_t _size,
+    TFunction _function,
+    CThreadPool& _pool = CThreadPool::global()
+  );
+
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy, typename TFunction>
+void parallel_for_each(
+    CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>& _array,
+    TFunction _function,
+    CThreadPool& _pool = CThreadPool::global()
+  );
+
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy, typename TFunction>
+void parallel_for_each(
+    const CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>& _array,
+    TFunction _function,
+    CThreadPool& _pool = CThreadPool::global()
+  );
+
+// _output получает размер _input (TOut должен создаваться по умолчанию),
+// _output[i] = _function(_input[i]); _output может совпадать с _input.
+template <
+    typename TIn, typename TInAllocator, std::size_t InInlineCapacity, typename TInGrowthPolicy,
+    typename TOut, typename TOutAllocator, std::size_t OutInlineCapacity, typename TOutGrowthPolicy,
+    typename TFunction
+  >
+void parallel_transform(
+    const CArray<TIn, TInAllocator, InInlineCapacity, TInGrowthPolicy>& _input,
+    CArray<TOut, TOutAllocator, OutInlineCapacity, TOutGrowthPolicy>& _output,
+    TFunction _function,
+    CThreadPool& _pool = CThreadPool::global()
+  );
+
+// Свёртка с нейтральным элементом _identity: каждый кусок сворачивается
+// _accumulate(TResult, const TData&) начиная с _identity, частичные итоги -
+// _combine(TResult, TResult) по порядку кусков. Операции должны быть
+// ассоциативными; коммутативность не требуется.
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy,
+         typename TResult, typename TAccumulate, typename TCombine>
+TResult parallel_reduce(
+    const CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>& _array,
+    TResult _identity,
+    TAccumulate _accumulate,
+    TCombine _combine,
+    CThreadPool& _pool = CThreadPool::global()
+  );
+
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy,
+         typename TResult, typename TReduce>
+TResult parallel_reduce(
+    const CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>& _array,
+    TResult _identity,
+    TReduce _reduce,
+    CThreadPool& _pool = CThreadPool::global()
+  );
+
+// Сортировка слиянием: куски сортируются std::sort параллельно, затем
+// попарно сливаются через буфер, причём каждое слияние тоже делится на
+// независимые части. Нужен буфер размером с массив (TData создаётся по
+// умолчанию); сортировка не стабильная, как и std::sort.
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy,
+         typename TCompare>
+void parallel_sort(
+    CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>& _array,
+    TCompare _compare,
+    CThreadPool& _pool = CThreadPool::global()
+  );
+
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy>
+void parallel_sort(
+    CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>& _array
+  );
+
+// Как CArray::erase_if, с сохранением порядка оставшихся элементов; возвращает
+// число удалённых. Предикат проверяется параллельно, сдвиг кусков к началу
+// последовательный. Если предикат бросил исключение, массив остаётся
+// корректным, но его содержимое не определено.
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy,
+         typename TPredicate>
+std::size_t parallel_erase_if(
+    CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>& _array,
+    TPredicate _predicate,
+    CThreadPool& _pool = CThreadPool::global()
+  );
+
+
+// -----------------------------------------------------------------------------
+
+// число кусков для _size элементов: по четыре на поток для перехвата работы
+inline std::size_t parallel_chunk_count(
+    std::size_t _size,
+    const CThreadPool& _pool
+  )
+{
+  if (_size < CArrayParallelThreshold || _pool.concurrency() == 1) return 1;
+  const std::size_t byGrain = (_size + CArrayParallelGrain - 1) / CArrayParallelGrain;
+  return std::min(byGrain, 4 * _pool.concurrency());
+}
+
+template<typename TFunction>
+void parallel_chunks(
+    std::size_t _size,
+    std::size_t _chunks,
+    TFunction _function,
+    CThreadPool& _pool
+  )
+{
+  if (_chunks == 1)
+  {
+    _function(std::size_t(0), std::size_t(0), _size);
+    return;
+  }
+
+  CTaskGroup group(_pool);
+  for (std::size_t chunk = 1; chunk < _chunks; ++chunk)
+  {
+    const std::size_t from = _size * chunk / _chunks;
+    const std::size_t to = _size * (chunk + 1) / _chunks;
+    group.run([&_function, chunk, from, to] { _function(chunk, from, to); });
+  }
+  _function(std::size_t(0), std::size_t(0), _size / _chunks);
+  group.wait();
+}
+
+template<typename TFunction>
+void parallel_for(
+    std::size_t _size,
+    TFunction _function,
+    CThreadPool& _pool
+  )
+{
+  parallel_chunks(_size, parallel_chunk_count(_size, _pool),
+      [&_function](std::size_t, std::size_t _from, std::size_t _to) { _function(_from, _to); },
+      _pool);
+}
+
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy, typename TFunction>
+void parallel_for_each(
+    CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>& _array,
+    TFunction _function,
+    CThreadPool& _pool
+  )
+{
+  TData* data = _array.data();
+  parallel_for(_array.size(), [data, &_function](std::size_t _from, std::size_t _to) {
+    for (std::size_t i = _from; i < _to; ++i) _function(data[i]);
+  }, _pool);
+}
+
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy, typename TFunction>
+void parallel_for_each(
+    const CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>& _array,
+    TFunction _function,
+    CThreadPool& _pool
+  )
+{
+  const TData* data = _array.data();
+  parallel_for(_array.size(), [data, &_function](std::size_t _from, std::size_t _to) {
+    for (std::size_t i = _from; i < _to; ++i) _function(data[i]);
+  }, _pool);
+}
+
+template <
+    typename TIn, typename TInAllocator, std::size_t InInlineCapacity, typename TInGrowthPolicy,
+    typename TOut, typename TOutAllocator, std::size_t OutInlineCapacity, typename TOutGrowthPolicy,
+    typename TFunction
+  >
+void parallel_transform(
+    const CArray<TIn, TInAllocator, InInlineCapacity, TInGrowthPolicy>& _input,
+    CArray<TOut, TOutAllocator, OutInlineCapacity, TOutGrowthPolicy>& _output,
+    TFunction _function,
+    CThreadPool& _pool
+  )
+{
+  _output.resize(_input.size());
+  const TIn* from = _input.data();
+  TOut* to = _output.data();
+  parallel_for(_input.size(), [from, to, &_function](std::size_t _from, std::size_t _to) {
+    for (std::size_t i = _from; i < _to; ++i) to[i] = _function(from[i]);
+  }, _pool);
+}
+
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy,
+         typename TResult, typename TAccumulate, typename TCombine>
+TResult parallel_reduce(
+    const CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>& _array,
+    TResult _identity,
+    TAccumulate _accumulate,
+    TCombine _combine,
+    CThreadPool& _pool
+  )
+{
+  const std::size_t size = _array.size();
+  const std::size_t chunks = parallel_chunk_count(size, _pool);
+  const TData* data = _array.data();
+
+  // итог каждого куска в своей ячейке, чтобы результат не зависел
+  // от порядка завершения задач
+  CArray<TResult> partials;
+  partials.resize(chunks, _identity);
+  TResult* results = partials.data();
+  parallel_chunks(size, chunks, [&](std::size_t _chunk, std::size_t _from, std::size_t _to) {
+    TResult result = _identity;
+    for (std::size_t i = _from; i < _to; ++i) result = _accumulate(std::move(result), data[i]);
+    results[_chunk] = std::move(result);
+  }, _pool);
+
+  TResult result = std::move(_identity);
+  for (std::size_t chunk = 0; chunk < chunks; ++chunk)
+  {
+    result = _combine(std::move(result), std::move(results[chunk]));
+  }
+  return result;
+}
+
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy,
+         typename TResult, typename TReduce>
+TResult parallel_reduce(
+    const CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>& _array,
+    TResult _identity,
+    TReduce _reduce,
+    CThreadPool& _pool
+  )
+{
+  return parallel_reduce(_array, std::move(_identity), _reduce, _reduce, _pool);
+}
+
+// Слияние [_first1, _last1) и [_first2, _last2) в _to перемещением. Большое
+// слияние делится медианой большей половины и её позицией в меньшей:
+// всё слева от точки раздела не больше всего справа, части независимы.
+template<typename TData, typename TCompare>
+void parallel_merge(
+    CTaskGroup& _group,
+    TData* _first1,
+    TData* _last1,
+    TData* _first2,
+    TData* _last2,
+    TData* _to,
+    const TCompare& _compare
+  )
+{
+  for (;;)
+  {
+    if (std::size_t(_last1 - _first1) < std::size_t(_last2 - _first2))
+    {
+      std::swap(_first1, _first2);
+      std::swap(_last1, _last2);
+    }
+    if (std::size_t(_last1 - _first1) + std::size_t(_last2 - _first2) <= CArrayParallelGrain
+        || _first2 == _last2)
+    {
+      std::merge(std::make_move_iterator(_first1), std::make_move_iterator(_last1),
+                 std::make_move_iterator(_first2), std::make_move_iterator(_last2),
+                 _to, _compare);
+      return;
+    }
+
+    TData* middle1 = _first1 + (_last1 - _first1) / 2;
+    TData* middle2 = std::lower_bound(_first2, _last2, *middle1, _compare);
+    TData* middleTo = _to + (middle1 - _first1) + (middle2 - _first2);
+    _group.run([&_group, _first1, middle1, _first2, middle2, _to, &_compare] {
+      parallel_merge(_group, _first1, middle1, _first2, middle2, _to, _compare);
+    });
+    _first1 = middle1;
+    _first2 = middle2;
+    _to = middleTo;
+  }
+}
+
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy,
+         typename TCompare>
+void parallel_sort(
+    CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>& _array,
+    TCompare _compare,
+    CThreadPool& _pool
+  )
+{
+  const std::size_t size = _array.size();
+  TData* data = _array.data();
+  if (size < CArrayParallelThreshold || _pool.concurrency() == 1)
+  {
+    std::sort(data, data + size, _compare);
+    return;
+  }
+
+  // степень двойки кусков, чтобы слияния шли ровными парами
+  std::size_t chunks = 1;
+  while (chunks < _pool.concurrency()) chunks *= 2;
+  CArray<std::size_t> bounds;
+  bounds.reserve(chunks + 1);
+  for (std::size_t chunk = 0; chunk <= chunks; ++chunk) bounds.push_back(size * chunk / chunks);
+
+  {
+    CTaskGroup group(_pool);
+    for (std::size_t chunk = 1; chunk < chunks; ++chunk)
+    {
+      TData* first = data + bounds[chunk];
+      TData* last = data + bounds[chunk + 1];
+      group.run([first, last, &_compare] { std::sort(first, last, _compare); });
+    }
+    std::sort(data, data + bounds[1], _compare);
+    group.wait();
+  }
+
+  CArray<TData, TAllocator> buffer(_array.get_allocator());
+  buffer.resize(size);
+  TData* from = data;
+  TData* to = buffer.data();
+  for (std::size_t width = 1; width < chunks; width *= 2)
+  {
+    CTaskGroup group(_pool);
+    for (std::size_t chunk = 0; chunk < chunks; chunk += 2 * width)
+    {
+      TData* first = from + bounds[chunk];
+      TData* middle = from + bounds[chunk + width];
+      TData* last = from + bounds[chunk + 2 * width];
+      TData* output = to + bounds[chunk];
+      group.run([&group, first, middle, last, output, &_compare] {
+        parallel_merge(group, first, middle, middle, last, output, _compare);
+      });
+    }
+    group.wait();
+    std::swap(from, to);
+  }
+
+  if (from != data)
+  {
+    parallel_for(size, [from, data](std::size_t _from, std::size_t _to) {
+      std::move(from + _from, from + _to, data + _from);
+    }, _pool);
+  }
+}
+
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy>
+void parallel_sort(
+    CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>& _array
+  )
+{
+  parallel_sort(_array, std::less<TData>());
+}
+
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy,
+         typename TPredicate>
+std::size_t parallel_erase_if(
+    CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>& _array,
+    TPredicate _predicate,
+    CThreadPool& _pool
+  )
+{
+  const std::size_t size = _array.size();
+  const std::size_t chunks = parallel_chunk_count(size, _pool);
+  if (chunks == 1) return _array.erase_if(_predicate);
+
+  // каждый кусок уплотняется на месте, оставшиеся элементы - в его начале
+  TData* data = _array.data();
+  CArray<std::size_t> kept;
+  kept.resize(chunks);
+  std::size_t* keptCounts = kept.data();
+  parallel_chunks(size, chunks, [data, keptCounts, &_predicate](std::size_t _chunk, std::size_t _from, std::size_t _to) {
+    TData* last = std::remove_if(data + _from, data + _to, [&_predicate](const TData& _value) {
+      return _predicate(_value);
+    });
+    keptCounts[_chunk] = std::size_t(last - (data + _from));
+  }, _pool);
+
+  // начала кусков сдвигаются к началу массива; цель всегда левее источника
+  std::size_t newSize = keptCounts[0];
+  for (std::size_t chunk = 1; chunk < chunks; ++chunk)
+  {
+    TData* first = data + size * chunk / chunks;
+    std::move(first, first + keptCounts[chunk], data + newSize);
+    newSize += keptCounts[chunk];
+  }
+
+  _array.erase(newSize, size);
+  return size - newSize;
+}
@@ -0,0 +1,965 @@
+#pragma once
+
+#include "CArray.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+#include <assert.h>
+
+// Векторные ядра есть только для x86 под GCC/Clang; CARRAY_NO_SIMD
+// оставляет одну скалярную реализацию.
+#if !defined(CARRAY_NO_SIMD) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CARRAY_SIMD_X86
+#include <immintrin.h>
+#define CARRAY_TARGET_SSE __attribute__((target("sse4.2")))
+#define CARRAY_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+
+// Набор инструкций, который выбран для векторных ядер на этом процессоре.
+enum class CSimdLevel
+{
+  Scalar,
+  Sse42,
+  Avx2
+};
+
+CSimdLevel carray_simd_level();
+
+
+// Тип суммы элементов: целые складываются в 64 бита, вещественные - в double.
+template <typename TData, typename = void>
+struct CArraySimdSum
+{
+  typedef typename std::conditional<
+      std::is_signed<TData>::value, long long, unsigned long long>::type type;
+};
+
+template <typename TData>
+struct CArraySimdSum<TData, typename std::enable_if<std::is_floating_point<TData>::value>::type>
+{
+  typedef typename std::conditional<
+      (sizeof(TData) > sizeof(double)), TData, double>::type type;
+};
+
+
+// Тип, по которому выбираются векторные операции: целые приводятся
+// к знаковому или беззнаковому типу той же ширины (int и long - к одним
+// и тем же ядрам), для неподдержанных типов - void.
+template <typename TData, typename = void>
+struct CSimdCanonical
+{
+  typedef void type;
+};
+
+template <typename TData>
+struct CSimdCanonical<TData, typename std::enable_if<
+    std::is_integral<TData>::value && !std::is_same<TData, bool>::value
+    && (sizeof(TData) == 4 || sizeof(TData) == 8)>::type>
+{
+  typedef typename std::conditional<sizeof(TData) == 4,
+      typename std::conditional<std::is_signed<TData>::value, std::int32_t, std::uint32_t>::type,
+      typename std::conditional<std::is_signed<TData>::value, std::int64_t, std::uint64_t>::type
+    >::type type;
+};
+
+template <>
+struct CSimdCanonical<float>
+{
+  typedef float type;
+};
+
+template <>
+struct CSimdCanonical<double>
+{
+  typedef double type;
+};
+
+
+// Скалярные ядра: запасной путь для старых процессоров, других архитектур
+// и типов без векторной реализации.
+template <typename TData>
+struct CSimdScalarKernels
+{
+  typedef typename CArraySimdSum<TData>::type Sum;
+
+  static std::size_t find(
+      const TData* _data,
+      std::size_t _size,
+      TData _value
+    )
+  {
+    for (std::size_t i = 0; i < _size; ++i) if (_data[i] == _value) return i;
+    return _size;
+  }
+
+  static std::size_t count(
+      const TData* _data,
+      std::size_t _size,
+      TData _value
+    )
+  {
+    std::size_t result = 0;
+    for (std::size_t i = 0; i < _size; ++i) result += _data[i] == _value;
+    return result;
+  }
+
+  static TData minimum(
+      const TData* _data,
+      std::size_t _size
+    )
+  {
+    TData result = _data[0];
+    for (std::size_t i = 1; i < _size; ++i) if (_data[i] < result) result = _data[i];
+    return result;
+  }
+
+  static TData maximum(
+      const TData* _data,
+      std::size_t _size
+    )
+  {
+    TData result = _data[0];
+    for (std::size_t i = 1; i < _size; ++i) if (result < _data[i]) result = _data[i];
+    return result;
+  }
+
+  static Sum sum(
+      const TData* _data,
+      std::size_t _size
+    )
+  {
+    Sum result = 0;
+    for (std::size_t i = 0; i < _size; ++i) result += _data[i];
+    return result;
+  }
+
+  static void fill(
+      TData* _data,
+      std::size_t _size,
+      TData _value
+    )
+  {
+    std::fill(_data, _data + _size, _value);
+  }
+};
+
+
+#ifdef CARRAY_SIMD_X86
+
+// Векторные операции над одним регистром. Специализации по каноническому
+// типу; ядра ниже написаны один раз поверх этого интерфейса:
+//   Vec, Acc            - регистр данных и регистр накопления суммы
+//   set1/load/store     - заполнение, невыровненные чтение и запись
+//   equal_mask          - битовая маска равных дорожек
+//   min/max             - поэлементные минимум и максимум
+//   zero/accumulate/add - накопление суммы с расширением типа
+//   total               - свёртка регистра суммы
+template <typename TCanonical>
+struct CSimdSseOps;
+
+template <typename TCanonical>
+struct CSimdAvx2Ops;
+
+template <typename TInt>
+struct CSimdSseOpsInt32
+{
+  typedef __m128i Vec;
+  typedef __m128i Acc;
+  typedef typename CArraySimdSum<TInt>::type Sum;
+
+  CARRAY_TARGET_SSE static Vec set1(TInt _value) { return _mm_set1_epi32(static_cast<int>(_value)); }
+  CARRAY_TARGET_SSE static Vec load(const void* _from) { return _mm_loadu_si128(static_cast<const __m128i*>(_from)); }
+  CARRAY_TARGET_SSE static void store(void* _to, Vec _value) { _mm_storeu_si128(static_cast<__m128i*>(_to), _value); }
+
+  CARRAY_TARGET_SSE static unsigned equal_mask(Vec _left, Vec _right)
+  {
+    return _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(_left, _right)));
+  }
+
+  CARRAY_TARGET_SSE static Vec min(Vec _left, Vec _right)
+  {
+    return std::is_signed<TInt>::value ? _mm_min_epi32(_left, _right) : _mm_min_epu32(_left, _right);
+  }
+
+  CARRAY_TARGET_SSE static Vec max(Vec _left, Vec _right)
+  {
+    return std::is_signed<TInt>::value ? _mm_max_epi32(_left, _right) : _mm_max_epu32(_left, _right);
+  }
+
+  CARRAY_TARGET_SSE static Acc zero() { return _mm_setzero_si128(); }
+  CARRAY_TARGET_SSE static Acc add(Acc _left, Acc _right) { return _mm_add_epi64(_left, _right); }
+
+  CARRAY_TARGET_SSE static Acc accumulate(Acc _sum, Vec _value)
+  {
+    const Vec high = _mm_unpackhi_epi64(_value, _value);
+    if (std::is_signed<TInt>::value)
+    {
+      _sum = _mm_add_epi64(_sum, _mm_cvtepi32_epi64(_value));
+      return _mm_add_epi64(_sum, _mm_cvtepi32_epi64(high));
+    }
+    _sum = _mm_add_epi64(_sum, _mm_cvtepu32_epi64(_value));
+    return _mm_add_epi64(_sum, _mm_cvtepu32_epi64(high));
+  }
+
+  CARRAY_TARGET_SSE static Sum total(Acc _sum)
+  {
+    std::uint64_t lanes[2];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), _sum);
+    return static_cast<Sum>(lanes[0] + lanes[1]);
+  }
+};
+
+template <typename TInt>
+struct CSimdSseOpsInt64
+{
+  typedef __m128i Vec;
+  typedef __m128i Acc;
+  typedef typename CArraySimdSum<TInt>::type Sum;
+
+  CARRAY_TARGET_SSE static Vec set1(TInt _value) { return _mm_set1_epi64x(static_cast<long long>(_value)); }
+  CARRAY_TARGET_SSE static Vec load(const void* _from) { return _mm_loadu_si128(static_cast<const __m128i*>(_from)); }
+  CARRAY_TARGET_SSE static void store(void* _to, Vec _value) { _mm_storeu_si128(static_cast<__m128i*>(_to), _value); }
+
+  CARRAY_TARGET_SSE static unsigned equal_mask(Vec _left, Vec _right)
+  {
+    return _mm_movemask_pd(_mm_castsi128_pd(_mm_cmpeq_epi64(_left, _right)));
+  }
+
+  // сравнения 64-битных целых только знаковые: беззнаковые сдвигаются на 2^63
+  CARRAY_TARGET_SSE static Vec greater(Vec _left, Vec _right)
+  {
+    if (std::is_signed<TInt>::value) return _mm_cmpgt_epi64(_left, _right);
+    const Vec bias = _mm_set1_epi64x(static_cast<long long>(0x8000000000000000ULL));
+    return _mm_cmpgt_epi64(_mm_xor_si128(_left, bias), _mm_xor_si128(_right, bias));
+  }
+
+  CARRAY_TARGET_SSE static Vec min(Vec _left, Vec _right)
+  {
+    return _mm_blendv_epi8(_left, _right, greater(_left, _right));
+  }
+
+  CARRAY_TARGET_SSE static Vec max(Vec _left, Vec _right)
+  {
+    return _mm_blendv_epi8(_right, _left, greater(_left, _right));
+  }
+
+  CARRAY_TARGET_SSE static Acc zero() { return _mm_setzero_si128(); }
+  CARRAY_TARGET_SSE static Acc add(Acc _left, Acc _right) { return _mm_add_epi64(_left, _right); }
+  CARRAY_TARGET_SSE static Acc accumulate(Acc _sum, Vec _value) { return _mm_add_epi64(_sum, _value); }
+
+  CARRAY_TARGET_SSE static Sum total(Acc _sum)
+  {
+    std::uint64_t lanes[2];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), _sum);
+    return static_cast<Sum>(lanes[0] + lanes[1]);
+  }
+};
+
+template <> struct CSimdSseOps<std::int32_t> : CSimdSseOpsInt32<std::int32_t> {};
+template <> struct CSimdSseOps<std::uint32_t> : CSimdSseOpsInt32<std::uint32_t> {};
+template <> struct CSimdSseOps<std::int64_t> : CSimdSseOpsInt64<std::int64_t> {};
+template <> struct CSimdSseOps<std::uint64_t> : CSimdSseOpsInt64<std::uint64_t> {};
+
+template <>
+struct CSimdSseOps<float>
+{
+  typedef __m128 Vec;
+  typedef __m128d Acc;
+  typedef double Sum;
+
+  CARRAY_TARGET_SSE static Vec set1(float _value) { return _mm_set1_ps(_value); }
+  CARRAY_TARGET_SSE static Vec load(const void* _from) { return _mm_loadu_ps(static_cast<const float*>(_from)); }
+  CARRAY_TARGET_SSE static void store(void* _to, Vec _value) { _mm_storeu_ps(static_cast<float*>(_to), _value); }
+  CARRAY_TARGET_SSE static unsigned equal_mask(Vec _left, Vec _right) { return _mm_movemask_ps(_mm_cmpeq_ps(_left, _right)); }
+  CARRAY_TARGET_SSE static Vec min(Vec _left, Vec _right) { return _mm_min_ps(_left, _right); }
+  CARRAY_TARGET_SSE static Vec max(Vec _left, Vec _right) { return _mm_max_ps(_left, _right); }
+  CARRAY_TARGET_SSE static Acc zero() { return _mm_setzero_pd(); }
+  CARRAY_TARGET_SSE static Acc add(Acc _left, Acc _right) { return _mm_add_pd(_left, _right); }
+
+  CARRAY_TARGET_SSE static Acc accumulate(Acc _sum, Vec _value)
+  {
+    _sum = _mm_add_pd(_sum, _mm_cvtps_pd(_value));
+    return _mm_add_pd(_sum, _mm_cvtps_pd(_mm_movehl_ps(_value, _value)));
+  }
+
+  CARRAY_TARGET_SSE static Sum total(Acc _sum)
+  {
+    double lanes[2];
+    _mm_storeu_pd(lanes, _sum);
+    return lanes[0] + lanes[1];
+  }
+};
+
+template <>
+struct CSimdSseOps<double>
+{
+  typedef __m128d Vec;
+  typedef __m128d Acc;
+  typedef double Sum;
+
+  CARRAY_TARGET_SSE static Vec set1(double _value) { return _mm_set1_pd(_value); }
+  CARRAY_TARGET_SSE static Vec load(const void* _from) { return _mm_loadu_pd(static_cast<const double*>(_from)); }
+  CARRAY_TARGET_SSE static void store(void* _to, Vec _value) { _mm_storeu_pd(static_cast<double*>(_to), _value); }
+  CARRAY_TARGET_SSE static unsigned equal_mask(Vec _left, Vec _right) { return _mm_movemask_pd(_mm_cmpeq_pd(_left, _right)); }
+  CARRAY_TARGET_SSE static Vec min(Vec _left, Vec _right) { return _mm_min_pd(_left, _right); }
+  CARRAY_TARGET_SSE static Vec max(Vec _left, Vec _right) { return _mm_max_pd(_left, _right); }
+  CARRAY_TARGET_SSE static Acc zero() { return _mm_setzero_pd(); }
+  CARRAY_TARGET_SSE static Acc add(Acc _left, Acc _right) { return _mm_add_pd(_left, _right); }
+  CARRAY_TARGET_SSE static Acc accumulate(Acc _sum, Vec _value) { return _mm_add_pd(_sum, _value); }
+
+  CARRAY_TARGET_SSE static Sum total(Acc _sum)
+  {
+    double lanes[2];
+    _mm_storeu_pd(lanes, _sum);
+    return lanes[0] + lanes[1];
+  }
+};
+
+template <typename TInt>
+struct CSimdAvx2OpsInt32
+{
+  typedef __m256i Vec;
+  typedef __m256i Acc;
+  typedef typename CArraySimdSum<TInt>::type Sum;
+
+  CARRAY_TARGET_AVX2 static Vec set1(TInt _value) { return _mm256_set1_epi32(static_cast<int>(_value)); }
+  CARRAY_TARGET_AVX2 static Vec load(const void* _from) { return _mm256_loadu_si256(static_cast<const __m256i*>(_from)); }
+  CARRAY_TARGET_AVX2 static void store(void* _to, Vec _value) { _mm256_storeu_si256(static_cast<__m256i*>(_to), _value); }
+
+  CARRAY_TARGET_AVX2 static unsigned equal_mask(Vec _left, Vec _right)
+  {
+    return _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(_left, _right)));
+  }
+
+  CARRAY_TARGET_AVX2 static Vec min(Vec _left, Vec _right)
+  {
+    return std::is_signed<TInt>::value ? _mm256_min_epi32(_left, _right) : _mm256_min_epu32(_left, _right);
+  }
+
+  CARRAY_TARGET_AVX2 static Vec max(Vec _left, Vec _right)
+  {
+    return std::is_signed<TInt>::value ? _mm256_max_epi32(_left, _right) : _mm256_max_epu32(_left, _right);
+  }
+
+  CARRAY_TARGET_AVX2 static Acc zero() { return _mm256_setzero_si256(); }
+  CARRAY_TARGET_AVX2 static Acc add(Acc _left, Acc _right) { return _mm256_add_epi64(_left, _right); }
+
+  CARRAY_TARGET_AVX2 static Acc accumulate(Acc _sum, Vec _value)
+  {
+    const __m128i low = _mm256_castsi256_si128(_value);
+    const __m128i high = _mm256_extracti128_si256(_value, 1);
+    if (std::is_signed<TInt>::value)
+    {
+      _sum = _mm256_add_epi64(_sum, _mm256_cvtepi32_epi64(low));
+      return _mm256_add_epi64(_sum, _mm256_cvtepi32_epi64(high));
+    }
+    _sum = _mm256_add_epi64(_sum, _mm256_cvtepu32_epi64(low));
+    return _mm256_add_epi64(_sum, _mm256_cvtepu32_epi64(high));
+  }
+
+  CARRAY_TARGET_AVX2 static Sum total(Acc _sum)
+  {
+    std::uint64_t lanes[4];
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), _sum);
+    return static_cast<Sum>(lanes[0] + lanes[1] + lanes[2] + lanes[3]);
+  }
+};
+
+template <typename TInt>
+struct CSimdAvx2OpsInt64
+{
+  typedef __m256i Vec;
+  typedef __m256i Acc;
+  typedef typename CArraySimdSum<TInt>::type Sum;
+
+  CARRAY_TARGET_AVX2 static Vec set1(TInt _value) { return _mm256_set1_epi64x(static_cast<long long>(_value)); }
+  CARRAY_TARGET_AVX2 static Vec load(const void* _from) { return _mm256_loadu_si256(static_cast<const __m256i*>(_from)); }
+  CARRAY_TARGET_AVX2 static void store(void* _to, Vec _value) { _mm256_storeu_si256(static_cast<__m256i*>(_to), _value); }
+
+  CARRAY_TARGET_AVX2 static unsigned equal_mask(Vec _left, Vec _right)
+  {
+    return _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(_left, _right)));
+  }
+
+  CARRAY_TARGET_AVX2 static Vec greater(Vec _left, Vec _right)
+  {
+    if (std::is_signed<TInt>::value) return _mm256_cmpgt_epi64(_left, _right);
+    const Vec bias = _mm256_set1_epi64x(static_cast<long long>(0x8000000000000000ULL));
+    return _mm256_cmpgt_epi64(_mm256_xor_si256(_left, bias), _mm256_xor_si256(_right, bias));
+  }
+
+  CARRAY_TARGET_AVX2 static Vec min(Vec _left, Vec _right)
+  {
+    return _mm256_blendv_epi8(_left, _right, greater(_left, _right));
+  }
+
+  CARRAY_TARGET_AVX2 static Vec max(Vec _left, Vec _right)
+  {
+    return _mm256_blendv_epi8(_right, _left, greater(_left, _right));
+  }
+
+  CARRAY_TARGET_AVX2 static Acc zero() { return _mm256_setzero_si256(); }
+  CARRAY_TARGET_AVX2 static Acc add(Acc _left, Acc _right) { return _mm256_add_epi64(_left, _right); }
+  CARRAY_TARGET_AVX2 static Acc accumulate(Acc _sum, Vec _value) { return _mm256_add_epi64(_sum, _value); }
+
+  CARRAY_TARGET_AVX2 static Sum total(Acc _sum)
+  {
+    std::uint64_t lanes[4];
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), _sum);
+    return static_cast<Sum>(lanes[0] + lanes[1] + lanes[2] + lanes[3]);
+  }
+};
+
+template <> struct CSimdAvx2Ops<std::int32_t> : CSimdAvx2OpsInt32<std::int32_t> {};
+template <> struct CSimdAvx2Ops<std::uint32_t> : CSimdAvx2OpsInt32<std::uint32_t> {};
+template <> struct CSimdAvx2Ops<std::int64_t> : CSimdAvx2OpsInt64<std::int64_t> {};
+template <> struct CSimdAvx2Ops<std::uint64_t> : CSimdAvx2OpsInt64<std::uint64_t> {};
+
+template <>
+struct CSimdAvx2Ops<float>
+{
+  typedef __m256 Vec;
+  typedef __m256d Acc;
+  typedef double Sum;
+
+  CARRAY_TARGET_AVX2 static Vec set1(float _value) { return _mm256_set1_ps(_value); }
+  CARRAY_TARGET_AVX2 static Vec load(const void* _from) { return _mm256_loadu_ps(static_cast<const float*>(_from)); }
+  CARRAY_TARGET_AVX2 static void store(void* _to, Vec _value) { _mm256_storeu_ps(static_cast<float*>(_to), _value); }
+
+  CARRAY_TARGET_AVX2 static unsigned equal_mask(Vec _left, Vec _right)
+  {
+    return _mm256_movemask_ps(_mm256_cmp_ps(_left, _right, _CMP_EQ_OQ));
+  }
+
+  CARRAY_TARGET_AVX2 static Vec min(Vec _left, Vec _right) { return _mm256_min_ps(_left, _right); }
+  CARRAY_TARGET_AVX2 static Vec max(Vec _left, Vec _right) { return _mm256_max_ps(_left, _right); }
+  CARRAY_TARGET_AVX2 static Acc zero() { return _mm256_setzero_pd(); }
+  CARRAY_TARGET_AVX2 static Acc add(Acc _left, Acc _right) { return _mm256_add_pd(_left, _right); }
+
+  CARRAY_TARGET_AVX2 static Acc accumulate(Acc _sum, Vec _value)
+  {
+    _sum = _mm256_add_pd(_sum, _mm256_cvtps_pd(_mm256_castps256_ps128(_value)));
+    return _mm256_add_pd(_sum, _mm256_cvtps_pd(_mm256_extractf128_ps(_value, 1)));
+  }
+
+  CARRAY_TARGET_AVX2 static Sum total(Acc _sum)
+  {
+    double lanes[4];
+    _mm256_storeu_pd(lanes, _sum);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3];
+  }
+};
+
+template <>
+struct CSimdAvx2Ops<double>
+{
+  typedef __m256d Vec;
+  typedef __m256d Acc;
+  typedef double Sum;
+
+  CARRAY_TARGET_AVX2 static Vec set1(double _value) { return _mm256_set1_pd(_value); }
+  CARRAY_TARGET_AVX2 static Vec load(const void* _from) { return _mm256_loadu_pd(static_cast<const double*>(_from)); }
+  CARRAY_TARGET_AVX2 static void store(void* _to, Vec _value) { _mm256_storeu_pd(static_cast<double*>(_to), _value); }
+
+  CARRAY_TARGET_AVX2 static unsigned equal_mask(Vec _left, Vec _right)
+  {
+    return _mm256_movemask_pd(_mm256_cmp_pd(_left, _right, _CMP_EQ_OQ));
+  }
+
+  CARRAY_TARGET_AVX2 static Vec min(Vec _left, Vec _right) { return _mm256_min_pd(_left, _right); }
+  CARRAY_TARGET_AVX2 static Vec max(Vec _left, Vec _right) { return _mm256_max_pd(_left, _right); }
+  CARRAY_TARGET_AVX2 static Acc zero() { return _mm256_setzero_pd(); }
+  CARRAY_TARGET_AVX2 static Acc add(Acc _left, Acc _right) { return _mm256_add_pd(_left, _right); }
+  CARRAY_TARGET_AVX2 static Acc accumulate(Acc _sum, Vec _value) { return _mm256_add_pd(_sum, _value); }
+
+  CARRAY_TARGET_AVX2 static Sum total(Acc _sum)
+  {
+    double lanes[4];
+    _mm256_storeu_pd(lanes, _sum);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3];
+  }
+};
+
+
+// Ядра пишутся один раз и штампуются для каждого набора инструкций:
+// атрибут target нельзя передать параметром шаблона, а вызов операций
+// с AVX2 из функции без него не компилируется. Минимум, максимум и сумма
+// ведут по четыре независимых регистра, чтобы не упираться в задержку
+// сложения. Для данных с NaN минимум и максимум не определены, как и
+// у std::min_element; сумма вещественных складывается в другом порядке
+// и может отличаться от последовательной в последних разрядах.
+#define CARRAY_SIMD_KERNELS(Name, Target)                                             \
+template <typename TData, typename TOps>                                             \
+struct Name                                                                          \
+{                                                                                    \
+  typedef typename TOps::Vec Vec;                                                    \
+  typedef typename TOps::Acc Acc;                                                    \
+  typedef typename CArraySimdSum<TData>::type Sum;                                   \
+  enum { Lanes = sizeof(Vec) / sizeof(TData) };                                      \
+                                                                                     \
+  Target static std::size_t find(const TData* _data, std::size_t _size, TData _value) \
+  {                                                                                  \
+    const Vec key = TOps::set1(_value);                                              \
+    std::size_t i = 0;                                                               \
+    for (; i + Lanes <= _size; i += Lanes)                                           \
+    {                                                                                \
+      const unsigned mask = TOps::equal_mask(TOps::load(_data + i), key);            \
+      if (mask) return i + __builtin_ctz(mask);                                      \
+    }                                                                                \
+    for (; i < _size; ++i) if (_data[i] == _value) return i;                         \
+    return _size;                                                                    \
+  }                                                                                  \
+                                                                                     \
+  Target static std::size_t count(const TData* _data, std::size_t _size, TData _value) \
+  {                                                                                  \
+    const Vec key = TOps::set1(_value);                                              \
+    std::size_t result = 0;                                                          \
+    std::size_t i = 0;                                                               \
+    for (; i + Lanes <= _size; i += Lanes)                                           \
+      result += __builtin_popcount(TOps::equal_mask(TOps::load(_data + i), key));    \
+    for (; i < _size; ++i) result += _data[i] == _value;                             \
+    return result;                                                                   \
+  }                                                                                  \
+                                                                                     \
+  Target static TData minimum(const TData* _data, std::size_t _size)                 \
+  {                                                                                  \
+    TData result = _data[0];                                                         \
+    std::size_t i = 0;                                                               \
+    if (_size >= 4 * Lanes)                                                          \
+    {                                                                                \
+      Vec a0 = TOps::load(_data), a1 = TOps::load(_data + Lanes);                    \
+      Vec a2 = TOps::load(_data + 2 * Lanes), a3 = TOps::load(_data + 3 * Lanes);    \
+      for (i = 4 * Lanes; i + 4 * Lanes <= _size; i += 4 * Lanes)                    \
+      {                                                                              \
+        a0 = TOps::min(a0, TOps::load(_data + i));                                   \
+        a1 = TOps::min(a1, TOps::load(_data + i + Lanes));                           \
+        a2 = TOps::min(a2, TOps::load(_data + i + 2 * Lanes));                       \
+        a3 = TOps::min(a3, TOps::load(_data + i + 3 * Lanes));                       \
+      }                                                                              \
+      TData lanes[Lanes];                                                            \
+      TOps::store(lanes, TOps::min(TOps::min(a0, a1), TOps::min(a2, a3)));           \
+      for (std::size_t lane = 0; lane < Lanes; ++lane)                               \
+        if (lanes[lane] < result) result = lanes[lane];                              \
+    }                                                                                \
+    for (; i < _size; ++i) if (_data[i] < result) result = _data[i];                 \
+    return result;                                                                   \
+  }                                                                                  \
+                                                                                     \
+  Target static TData maximum(const TData* _data, std::size_t _size)                 \
+  {                                                                                  \
+    TData result = _data[0];                                                         \
+    std::size_t i = 0;                                                               \
+    if (_size >= 4 * Lanes)                                                          \
+    {                                                                                \
+      Vec a0 = TOps::load(_data), a1 = TOps::load(_data + Lanes);                    \
+      Vec a2 = TOps::load(_data + 2 * Lanes), a3 = TOps::load(_data + 3 * Lanes);    \
+      for (i = 4 * Lanes; i + 4 * Lanes <= _size; i += 4 * Lanes)                    \
+      {                                                                              \
+        a0 = TOps::max(a0, TOps::load(_data + i));                                   \
+        a1 = TOps::max(a1, TOps::load(_data + i + Lanes));                           \
+        a2 = TOps::max(a2, TOps::load(_data + i + 2 * Lanes));                       \
+        a3 = TOps::max(a3, TOps::load(_data + i + 3 * Lanes));                       \
+      }                                                                              \
+      TData lanes[Lanes];                                                            \
+      TOps::store(lanes, TOps::max(TOps::max(a0, a1), TOps::max(a2, a3)));           \
+      for (std::size_t lane = 0; lane < Lanes; ++lane)                               \
+        if (result < lanes[lane]) result = lanes[lane];                              \
+    }                                                                                \
+    for (; i < _size; ++i) if (result < _data[i]) result = _data[i];                 \
+    return result;                                                                   \
+  }                                                                                  \
+                                                                                     \
+  Target static Sum sum(const TData* _data, std::size_t _size)                       \
+  {                                                                                  \
+    Acc a0 = TOps::zero(), a1 = TOps::zero(), a2 = TOps::zero(), a3 = TOps::zero();  \
+    std::size_t i = 0;                                                               \
+    for (; i + 4 * Lanes <= _size; i += 4 * Lanes)                                   \
+    {                                                                                \
+      a0 = TOps::accumulate(a0, TOps::load(_data + i));                              \
+      a1 = TOps::accumulate(a1, TOps::load(_data + i + Lanes));                      \
+      a2 = TOps::accumulate(a2, TOps::load(_data + i + 2 * Lanes));                  \
+      a3 = TOps::accumulate(a3, TOps::load(_data + i + 3 * Lanes));                  \
+    }                                                                                \
+    Sum result = TOps::total(TOps::add(TOps::add(a0, a1), TOps::add(a2, a3)));       \
+    for (; i < _size; ++i) result += _data[i];                                       \
+    return result;                                                                   \
+  }                                                                                  \
+                                                                                     \
+  Target static void fill(TData* _data, std::size_t _size, TData _value)             \
+  {                                                                                  \
+    const Vec value = TOps::set1(_value);                                            \
+    std::size_t i = 0;                                                               \
+    for (; i + Lanes <= _size; i += Lanes) TOps::store(_data + i, value);            \
+    for (; i < _size; ++i) _data[i] = _value;                                        \
+  }                                                                                  \
+};
+
+CARRAY_SIMD_KERNELS(CSimdSseKernels, CARRAY_TARGET_SSE)
+CARRAY_SIMD_KERNELS(CSimdAvx2Kernels, CARRAY_TARGET_AVX2)
+
+#undef CARRAY_SIMD_KERNELS
+
+#endif // CARRAY_SIMD_X86
+
+
+// Массовые операции над непрерывным блоком арифметических данных с выбором
+// ядра по процессору во время выполнения. Выбор делается один раз за
+// процесс (carray_simd_level), дальше каждый вызов стоит одного ветвления.
+template <typename TData>
+class CArraySimd
+{
+  static_assert(std::is_arithmetic<TData>::value, "CArraySimd works with arithmetic types only");
+
+  typedef typename CSimdCanonical<TData>::type Canonical;
+  typedef CSimdScalarKernels<TData> Scalar;
+#ifdef CARRAY_SIMD_X86
+  static const bool Vectorized = !std::is_void<Canonical>::value;
+  typedef typename std::conditional<Vectorized,
+      CSimdSseKernels<TData, CSimdSseOps<Canonical>>, Scalar>::type Sse;
+  typedef typename std::conditional<Vectorized,
+      CSimdAvx2Kernels<TData, CSimdAvx2Ops<Canonical>>, Scalar>::type Avx2;
+#endif
+
+public:
+  typedef typename CArraySimdSum<TData>::type sum_type;
+
+  // индекс первого равного _value элемента или _size
+  static std::size_t find(
+      const TData* _data,
+      std::size_t _size,
+      TData _value
+    );
+  static std::size_t count(
+      const TData* _data,
+      std::size_t _size,
+      TData _value
+    );
+  // минимум и максимум непустого блока
+  static TData min(
+      const TData* _data,
+      std::size_t _size
+    );
+  static TData max(
+      const TData* _data,
+      std::size_t _size
+    );
+  static sum_type sum(
+      const TData* _data,
+      std::size_t _size
+    );
+  static void fill(
+      TData* _data,
+      std::size_t _size,
+      TData _value
+    );
+  static void radix_sort(
+      TData* _data,
+      std::size_t _size
+    );
+
+private:
+  static CSimdLevel level();
+
+  // поразрядная сортировка идёт по беззнаковому ключу той же ширины
+  typedef typename std::conditional<sizeof(TData) == 1, std::uint8_t,
+          typename std::conditional<sizeof(TData) == 2, std::uint16_t,
+          typename std::conditional<sizeof(TData) == 4, std::uint32_t,
+          std::uint64_t>::type>::type>::type Key;
+
+  // ниже этого размера std::sort быстрее, чем проходы по 256 корзинам
+  static const std::size_t RadixThreshold = 256;
+
+  static Key to_key(
+      TData _value
+    );
+  static TData from_key(
+      Key _key
+    );
+  static void radix_sort(
+      TData* _data,
+      std::size_t _size,
+      std::true_type
+    );
+  static void radix_sort(
+      TData* _data,
+      std::size_t _size,
+      std::false_type
+    );
+};
+
+
+// Обёртки для CArray любых распределителя, встроенной ёмкости и политики роста.
+
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy>
+std::size_t carray_find(
+    const CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>& _array,
+    typename CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>::value_type _value
+  )
+{
+  return CArraySimd<TData>::find(_array.data(), _array.size(), _value);
+}
+
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy>
+std::size_t carray_count(
+    const CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>& _array,
+    typename CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>::value_type _value
+  )
+{
+  return CArraySimd<TData>::count(_array.data(), _array.size(), _value);
+}
+
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy>
+TData carray_min(
+    const CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>& _array
+  )
+{
+  return CArraySimd<TData>::min(_array.data(), _array.size());
+}
+
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy>
+TData carray_max(
+    const CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>& _array
+  )
+{
+  return CArraySimd<TData>::max(_array.data(), _array.size());
+}
+
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy>
+typename CArraySimd<TData>::sum_type carray_sum(
+    const CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>& _array
+  )
+{
+  return CArraySimd<TData>::sum(_array.data(), _array.size());
+}
+
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy>
+void carray_fill(
+    CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>& _array,
+    typename CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>::value_type _value
+  )
+{
+  CArraySimd<TData>::fill(_array.data(), _array.size(), _value);
+}
+
+template<typename TData, typename TAllocator, std::size_t InlineCapacity, typename TGrowthPolicy>
+void carray_radix_sort(
+    CArray<TData, TAllocator, InlineCapacity, TGrowthPolicy>& _array
+  )
+{
+  CArraySimd<TData>::radix_sort(_array.data(), _array.size());
+}
+
+
+// -----------------------------------------------------------------------------
+
+inline CSimdLevel carray_simd_level()
+{
+#ifdef CARRAY_SIMD_X86
+  static const CSimdLevel level = [] {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return CSimdLevel::Avx2;
+    if (__builtin_cpu_supports("sse4.2")) return CSimdLevel::Sse42;
+    return CSimdLevel::Scalar;
+  }();
+  return level;
+#else
+  return CSimdLevel::Scalar;
+#endif
+}
+
+// -----------------------------------------------------------------------------
+
+template<typename TData>
+CSimdLevel CArraySimd<TData>::level()
+{
+  return std::is_void<Canonical>::value ? CSimdLevel::Scalar : carray_simd_level();
+}
+
+#ifdef CARRAY_SIMD_X86
+#define CARRAY_SIMD_DISPATCH(call)                        \
+  switch (level())                                        \
+  {                                                       \
+    case CSimdLevel::Avx2: return Avx2::call;             \
+    case CSimdLevel::Sse42: return Sse::call;             \
+    case CSimdLevel::Scalar: break;                       \
+  }                                                       \
+  return Scalar::call
+#else
+#define CARRAY_SIMD_DISPATCH(call) return Scalar::call
+#endif
+
+template<typename TData>
+std::size_t CArraySimd<TData>::find(
+    const TData* _data,
+    std::size_t _size,
+    TData _value
+  )
+{
+  CARRAY_SIMD_DISPATCH(find(_data, _size, _value));
+}
+
+template<typename TData>
+std::size_t CArraySimd<TData>::count(
+    const TData* _data,
+    std::size_t _size,
+    TData _value
+  )
+{
+  CARRAY_SIMD_DISPATCH(count(_data, _size, _value));
+}
+
+template<typename TData>
+TData CArraySimd<TData>::min(
+    const TData* _data,
+    std::size_t _size
+  )
+{
+  assert(_size > 0);
+  CARRAY_SIMD_DISPATCH(minimum(_data, _size));
+}
+
+template<typename TData>
+TData CArraySimd<TData>::max(
+    const TData* _data,
+    std::size_t _size
+  )
+{
+  assert(_size > 0);
+  CARRAY_SIMD_DISPATCH(maximum(_data, _size));
+}
+
+template<typename TData>
+typename CArraySimd<TData>::sum_type CArraySimd<TData>::sum(
+    const TData* _data,
+    std::size_t _size
+  )
+{
+  CARRAY_SIMD_DISPATCH(sum(_data, _size));
+}
+
+template<typename TData>
+void CArraySimd<TData>::fill(
+    TData* _data,
+    std::size_t _size,
+    TData _value
+  )
+{
+  CARRAY_SIMD_DISPATCH(fill(_data, _size, _value));
+}
+
+#undef CARRAY_SIMD_DISPATCH
+
+template<typename TData>
+void CArraySimd<TData>::radix_sort(
+    TData* _data,
+    std::size_t _size
+  )
+{
+  // long double и bool сортируются как обычно
+  radix_sort(_data, _size, std::integral_constant<bool,
+      sizeof(TData) <= sizeof(std::uint64_t) && !std::is_same<TData, bool>::value>());
+}
+
+template<typename TData>
+void CArraySimd<TData>::radix_sort(
+    TData* _data,
+    std::size_t _size,
+    std::false_type
+  )
+{
+  std::sort(_data, _data + _size);
+}
+
+// Поразрядная сортировка LSD по байтам. Все гистограммы считаются за один
+// проход вместе с переводом в ключи; проход по байту, одинаковому у всех
+// элементов (старшие байты небольших чисел), пропускается. Раскладка по
+// корзинам - разрозненная запись, у AVX2 для неё нет инструкций, поэтому
+// векторизуются только преобразования ключей.
+template<typename TData>
+void CArraySimd<TData>::radix_sort(
+    TData* _data,
+    std::size_t _size,
+    std::true_type
+  )
+{
+  if (_size < RadixThreshold)
+  {
+    std::sort(_data, _data + _size);
+    return;
+  }
+
+  const std::size_t passes = sizeof(Key);
+  std::unique_ptr<Key[]> buffer(new Key[2 * _size]);
+  Key* from = buffer.get();
+  Key* to = from + _size;
+
+  std::size_t histogram[passes][256] = {};
+  for (std::size_t i = 0; i < _size; ++i)
+  {
+    const Key key = to_key(_data[i]);
+    from[i] = key;
+    for (std::size_t pass = 0; pass < passes; ++pass) ++histogram[pass][(key >> (8 * pass)) & 0xFF];
+  }
+
+  for (std::size_t pass = 0; pass < passes; ++pass)
+  {
+    const unsigned shift = 8 * pass;
+    std::size_t* counts = histogram[pass];
+    if (counts[(from[0] >> shift) & 0xFF] == _size) continue;
+
+    std::size_t offset = 0;
+    for (std::size_t digit = 0; digit < 256; ++digit)
+    {
+      const std::size_t digitCount = counts[digit];
+      counts[digit] = offset;
+      offset += digitCount;
+    }
+    for (std::size_t i = 0; i < _size; ++i) to[counts[(from[i] >> shift) & 0xFF]++] = from[i];
+    std::swap(from, to);
+  }
+
+  for (std::size_t i = 0; i < _size; ++i) _data[i] = from_key(from[i]);
+}
+
+// Ключ упорядочен как беззнаковое число: у знаковых целых инвертируется
+// знаковый бит, у вещественных отрицательные инвертируются целиком.
+template<typename TData>
+typename CArraySimd<TData>::Key CArraySimd<TData>::to_key(
+    TData _value
+  )
+{
+  const Key signBit = static_cast<Key>(Key(1) << (8 * sizeof(Key) - 1));
+  Key key;
+  std::memcpy(&key, &_value, sizeof(key));
+  if (std::is_floating_point<TData>::value)
+  {
+    const Key negative = static_cast<Key>(key >> (8 * sizeof(Key) - 1));
+    return static_cast<Key>(key ^ (static_cast<Key>(Key(0) - negative) | signBit));
+  }
+  return std::is_signed<TData>::value ? static_cast<Key>(key ^ signBit) : key;
+}
+
+template<typename TData>
+TData CArraySimd<TData>::from_key(
+    Key _key
+  )
+{
+  const Key signBit = static_cast<Key>(Key(1) << (8 * sizeof(Key) - 1));
+  if (std::is_floating_point<TData>::value)
+  {
+    const Key positive = static_cast<Key>(_key >> (8 * sizeof(Key) - 1));
+    _key = static_cast<Key>(_key ^ (static_cast<Key>(positive - Key(1)) | signBit));
+  }
+  else if (std::is_signed<TData>::value)
+  {
+    _key = static_cast<Key>(_key ^ signBit);
+  }
+  TData value;
+  std::memcpy(&value, &_key, sizeof(value));
+  return value;
+}
@@ -0,0 +1,383 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <typeinfo>
+#if defined(__GNUC__)
+#include <cxxabi.h>
+#endif
+
+
+// Счётчики работы CArray для одного типа массива. CArray ведёт их только при
+// сборке с CARRAY_STATISTICS; без него этот заголовок в CArray.h не
+// подключается и код учёта не генерируется вовсе. Счётчики атомарные
+// (relaxed), поэтому массивы одного типа можно менять из разных потоков.
+class CArrayStats
+{
+public:
+  explicit CArrayStats(
+      std::string _name
+    );
+
+  CArrayStats(const CArrayStats&) = delete;
+  CArrayStats& operator=(const CArrayStats&) = delete;
+
+  // новый блок памяти на _elements элементов
+  void on_allocate(
+      std::size_t _elements,
+      std::size_t _bytes
+    );
+  // перенос содержимого в блок ёмкостью _capacity: _relocated - сколько
+  // элементов пришлось переместить или скопировать, _grownBytes - на сколько
+  // вырос блок, если распределитель расширил его на месте
+  void on_reallocate(
+      std::size_t _capacity,
+      std::size_t _relocated,
+      std::size_t _grownBytes
+    );
+  // освобождение блока ёмкостью _capacity, в котором было занято _size
+  void on_release(
+      std::size_t _capacity,
+      std::size_t _size
+    );
+  // сдвиг хвоста при вставке или удалении в середине
+  void on_shift_insert(
+      std::size_t _shifted
+    );
+  void on_shift_erase(
+      std::size_t _shifted
+    );
+
+  const std::string& name() const;
+  std::uint64_t allocations() const;
+  std::uint64_t reallocations() const;
+  std::uint64_t bytes_allocated() const;
+  std::uint64_t relocated_elements() const;
+  std::uint64_t shifted_on_insert() const;
+  std::uint64_t shifted_on_erase() const;
+  // наибольшая ёмкость одного массива, в элементах
+  std::uint64_t peak_capacity() const;
+  // Сумма ёмкостей освобождённых блоков (включая встроенный буфер) и
+  // сколько из неё так и не было занято к моменту освобождения
+  std::uint64_t released_capacity() const;
+  std::uint64_t wasted_capacity() const;
+  void reset();
+
+private:
+  friend class CArrayStatsRegistry;
+
+  static void add(
+      std::atomic<std::uint64_t>& _counter,
+      std::size_t _value
+    );
+  void update_peak(
+      std::size_t _capacity
+    );
+
+private:
+  std::string m_name;
+  std::atomic<std::uint64_t> m_allocations;
+  std::atomic<std::uint64_t> m_reallocations;
+  std::atomic<std::uint64_t> m_bytesAllocated;
+  std::atomic<std::uint64_t> m_relocated;
+  std::atomic<std::uint64_t> m_shiftedInsert;
+  std::atomic<std::uint64_t> m_shiftedErase;
+  std::atomic<std::uint64_t> m_peakCapacity;
+  std::atomic<std::uint64_t> m_releasedCapacity;
+  std::atomic<std::uint64_t> m_wastedCapacity;
+  // следующий в списке реестра
+  CArrayStats* m_next;
+};
+
+
+// Глобальный реестр счётчиков: каждый CArrayStats встаёт в него при
+// создании (первое использование типа массива) и живёт до конца программы.
+class CArrayStatsRegistry
+{
+public:
+  static CArrayStatsRegistry& instance();
+
+  CArrayStatsRegistry(const CArrayStatsRegistry&) = delete;
+  CArrayStatsRegistry& operator=(const CArrayStatsRegistry&) = delete;
+
+  // таблица по всем типам массивов, в которых что-то происходило
+  void report(
+      std::ostream& _stream
+    ) const;
+  void reset();
+
+  template <typename TFunction>
+  void for_each(
+      TFunction _function
+    ) const;
+
+  // читаемое имя типа для отчёта
+  template <typename TType>
+  static std::string type_name();
+
+private:
+  friend class CArrayStats;
+
+  CArrayStatsRegistry();
+
+  void add(
+      CArrayStats* _stats
+    );
+
+private:
+  mutable std::mutex m_mutex;
+  CArrayStats* m_first;
+};
+
+
+// -----------------------------------------------------------------------------
+
+inline CArrayStats::CArrayStats(
+    std::string _name
+  )
+  : m_name(std::move(_name))
+  , m_allocations(0)
+  , m_reallocations(0)
+  , m_bytesAllocated(0)
+  , m_relocated(0)
+  , m_shiftedInsert(0)
+  , m_shiftedErase(0)
+  , m_peakCapacity(0)
+  , m_releasedCapacity(0)
+  , m_wastedCapacity(0)
+  , m_next(nullptr)
+{
+  CArrayStatsRegistry::instance().add(this);
+}
+
+inline void CArrayStats::on_allocate(
+    std::size_t _elements,
+    std::size_t _bytes
+  )
+{
+  add(m_allocations, 1);
+  add(m_bytesAllocated, _bytes);
+  update_peak(_elements);
+}
+
+inline void CArrayStats::on_reallocate(
+    std::size_t _capacity,
+    std::size_t _relocated,
+    std::size_t _grownBytes
+  )
+{
+  add(m_reallocations, 1);
+  add(m_relocated, _relocated);
+  add(m_bytesAllocated, _grownBytes);
+  update_peak(_capacity);
+}
+
+inline void CArrayStats::on_release(
+    std::size_t _capacity,
+    std::size_t _size
+  )
+{
+  add(m_releasedCapacity, _capacity);
+  add(m_wastedCapacity, _capacity - _size);
+}
+
+inline void CArrayStats::on_shift_insert(
+    std::size_t _shifted
+  )
+{
+  add(m_shiftedInsert, _shifted);
+}
+
+inline void CArrayStats::on_shift_erase(
+    std::size_t _shifted
+  )
+{
+  add(m_shiftedErase, _shifted);
+}
+
+inline const std::string& CArrayStats::name() const
+{
+  return m_name;
+}
+
+inline std::uint64_t CArrayStats::allocations() const
+{
+  return m_allocations.load(std::memory_order_relaxed);
+}
+
+inline std::uint64_t CArrayStats::reallocations() const
+{
+  return m_reallocations.load(std::memory_order_relaxed);
+}
+
+inline std::uint64_t CArrayStats::bytes_allocated() const
+{
+  return m_bytesAllocated.load(std::memory_order_relaxed);
+}
+
+inline std::uint64_t CArrayStats::relocated_elements() const
+{
+  return m_relocated.load(std::memory_order_relaxed);
+}
+
+inline std::uint64_t CArrayStats::shifted_on_insert() const
+{
+  return m_shiftedInsert.load(std::memory_order_relaxed);
+}
+
+inline std::uint64_t CArrayStats::shifted_on_erase() const
+{
+  return m_shiftedErase.load(std::memory_order_relaxed);
+}
+
+inline std::uint64_t CArrayStats::peak_capacity() const
+{
+  return m_peakCapacity.load(std::memory_order_relaxed);
+}
+
+inline std::uint64_t CArrayStats::released_capacity() const
+{
+  return m_releasedCapacity.load(std::memory_order_relaxed);
+}
+
+inline std::uint64_t CArrayStats::wasted_capacity() const
+{
+  return m_wastedCapacity.load(std::memory_order_relaxed);
+}
+
+inline void CArrayStats::reset()
+{
+  m_allocations.store(0, std::memory_order_relaxed);
+  m_reallocations.store(0, std::memory_order_relaxed);
+  m_bytesAllocated.store(0, std::memory_order_relaxed);
+  m_relocated.store(0, std::memory_order_relaxed);
+  m_shiftedInsert.store(0, std::memory_order_relaxed);
+  m_shiftedErase.store(0, std::memory_order_relaxed);
+  m_peakCapacity.store(0, std::memory_order_relaxed);
+  m_releasedCapacity.store(0, std::memory_order_relaxed);
+  m_wastedCapacity.store(0, std::memory_order_relaxed);
+}
+
+inline void CArrayStats::add(
+    std::atomic<std::uint64_t>& _counter,
+    std::size_t _value
+  )
+{
+  _counter.fetch_add(_value, std::memory_order_relaxed);
+}
+
+inline void CArrayStats::update_peak(
+    std::size_t _capacity
+  )
+{
+  std::uint64_t peak = m_peakCapacity.load(std::memory_order_relaxed);
+  while (peak < _capacity
+         && !m_peakCapacity.compare_exchange_weak(peak, _capacity, std::memory_order_relaxed))
+  {}
+}
+
+// -----------------------------------------------------------------------------
+
+inline CArrayStatsRegistry::CArrayStatsRegistry()
+  : m_first(nullptr)
+{}
+
+inline CArrayStatsRegistry& CArrayStatsRegistry::instance()
+{
+  static CArrayStatsRegistry registry;
+  return registry;
+}
+
+inline void CArrayStatsRegistry::report(
+    std::ostream& _stream
+  ) const
+{
+  // форматирование вызывающего восстанавливается в конце
+  const std::ios_base::fmtflags flags = _stream.flags();
+  const std::streamsize precision = _stream.precision();
+
+  std::size_t nameWidth = 8;
+  for_each([&nameWidth](const CArrayStats& _stats) {
+    if (_stats.name().size() + 2 > nameWidth) nameWidth = _stats.name().size() + 2;
+  });
+
+  _stream << std::left << std::setw(int(nameWidth)) << "array"
+          << std::right
+          << std::setw(10) << "allocs"
+          << std::setw(10) << "reallocs"
+          << std::setw(14) << "bytes"
+          << std::setw(14) << "relocated"
+          << std::setw(14) << "shift ins"
+          << std::setw(14) << "shift del"
+          << std::setw(12) << "peak cap"
+          << std::setw(9) << "wasted"
+          << '\n';
+
+  for_each([&_stream, nameWidth](const CArrayStats& _stats) {
+    if (_stats.allocations() == 0 && _stats.shifted_on_insert() == 0 && _stats.shifted_on_erase() == 0) return;
+
+    const std::uint64_t released = _stats.released_capacity();
+    const double wasted = released ? 100.0 * double(_stats.wasted_capacity()) / double(released) : 0.0;
+    _stream << std::left << std::setw(int(nameWidth)) << _stats.name()
+            << std::right
+            << std::setw(10) << _stats.allocations()
+            << std::setw(10) << _stats.reallocations()
+            << std::setw(14) << _stats.bytes_allocated()
+            << std::setw(14) << _stats.relocated_elements()
+            << std::setw(14) << _stats.shifted_on_insert()
+            << std::setw(14) << _stats.shifted_on_erase()
+            << std::setw(12) << _stats.peak_capacity()
+            << std::setw(8) << std::fixed << std::setprecision(1) << wasted << '%'
+            << '\n';
+  });
+
+  _stream.flags(flags);
+  _stream.precision(precision);
+}
+
+inline void CArrayStatsRegistry::reset()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  for (CArrayStats* stats = m_first; stats; stats = stats->m_next) stats->reset();
+}
+
+template<typename TFunction>
+void CArrayStatsRegistry::for_each(
+    TFunction _function
+  ) const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  for (const CArrayStats* stats = m_first; stats; stats = stats->m_next) _function(*stats);
+}
+
+template<typename TType>
+std::string CArrayStatsRegistry::type_name()
+{
+  const char* mangled = typeid(TType).name();
+#if defined(__GNUC__)
+  int status = 0;
+  char* demangled = abi::__cxa_demangle(mangled, nullptr, nullptr, &status);
+  if (demangled)
+  {
+    std::string name(demangled);
+    std::free(demangled);
+    return name;
+  }
+#endif
+  return mangled;
+}
+
+inline void CArrayStatsRegistry::add(
+    CArrayStats* _stats
+  )
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  _stats->m_next = m_first;
+  m_first = _stats;
+}
@@ -0,0 +1,1050 @@
+#pragma once
+
+#include "CArray.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <assert.h>
+
+// Массив из цепочки блоков ограниченного размера для нагрузок с частыми
+// вставками в середину. Размер блока растёт как корень из числа элементов,
+// поэтому вставка и удаление по произвольному индексу стоят O(sqrt(n)).
+// Массив помнит последний использованный блок (курсор), и операции рядом
+// с предыдущей позицией находят блок за O(1) без поиска по каталогу. Свободное
+// место блока держится разрывом там, куда вставляли в последний раз, поэтому
+// вставка на расстоянии d от предыдущей сдвигает только d элементов: при
+// курсоре, который движется понемногу, вставка в среднем стоит O(1).
+// Ссылки на элементы, в отличие от CArray, переживают вставки в другие блоки.
+
+template <typename TArray, typename TData>
+class CChunkedArrayIterator
+{
+  template <typename TOtherArray, typename TOther>
+  friend class CChunkedArrayIterator;
+
+public:
+  typedef std::random_access_iterator_tag iterator_category;
+  typedef typename std::remove_const<TData>::type value_type;
+  typedef std::ptrdiff_t difference_type;
+  typedef TData* pointer;
+  typedef TData& reference;
+
+  CChunkedArrayIterator()
+    : m_pos(0)
+    , m_array(nullptr)
+  {}
+
+  CChunkedArrayIterator(
+      TArray* _array,
+      std::size_t _pos
+    )
+    : m_pos(_pos)
+    , m_array(_array)
+  {}
+
+  template <
+      typename TOtherArray,
+      typename TOther,
+      typename = typename std::enable_if<std::is_convertible<TOther*, TData*>::value>::type
+    >
+  CChunkedArrayIterator(
+      const CChunkedArrayIterator<TOtherArray, TOther>& _other
+    )
+    : m_pos(_other.m_pos)
+    , m_array(_other.m_array)
+  {}
+
+  CChunkedArrayIterator(const CChunkedArrayIterator&) = default;
+  CChunkedArrayIterator& operator=(const CChunkedArrayIterator&) = default;
+  ~CChunkedArrayIterator() = default;
+
+public:
+  template <typename TOtherArray, typename TOther>
+  bool operator==(
+      const CChunkedArrayIterator<TOtherArray, TOther>& _other
+    ) const
+  {
+    assert(m_array == _other.m_array);
+    return m_pos == _other.m_pos;
+  }
+
+  template <typename TOtherArray, typename TOther>
+  bool operator!=(
+      const CChunkedArrayIterator<TOtherArray, TOther>& _other
+    ) const
+  {
+    return !(*this == _other);
+  }
+
+  template <typename TOtherArray, typename TOther>
+  bool operator<(
+      const CChunkedArrayIterator<TOtherArray, TOther>& _other
+    ) const
+  {
+    assert(m_array == _other.m_array);
+    return m_pos < _other.m_pos;
+  }
+
+  template <typename TOtherArray, typename TOther>
+  bool operator>(
+      const CChunkedArrayIterator<TOtherArray, TOther>& _other
+    ) const
+  {
+    return _other < *this;
+  }
+
+  template <typename TOtherArray, typename TOther>
+  bool operator<=(
+      const CChunkedArrayIterator<TOtherArray, TOther>& _other
+    ) const
+  {
+    return !(_other < *this);
+  }
+
+  template <typename TOtherArray, typename TOther>
+  bool operator>=(
+      const CChunkedArrayIterator<TOtherArray, TOther>& _other
+    ) const
+  {
+    return !(*this < _other);
+  }
+
+  TData& operator*() const
+  {
+    return (*m_array)[m_pos];
+  }
+
+  TData* operator->() const
+  {
+    return &(*m_array)[m_pos];
+  }
+
+  CChunkedArrayIterator& operator++()
+  {
+    ++m_pos;
+    return *this;
+  }
+
+  CChunkedArrayIterator operator++(int)
+  {
+    CChunkedArrayIterator old(*this);
+    ++(*this);
+    return old;
+  }
+
+  CChunkedArrayIterator& operator--()
+  {
+    --m_pos;
+    return *this;
+  }
+
+  CChunkedArrayIterator operator--(int)
+  {
+    CChunkedArrayIterator old(*this);
+    --(*this);
+    return old;
+  }
+
+  TData& operator[](
+      difference_type _n
+    ) const
+  {
+    return (*m_array)[m_pos + _n];
+  }
+
+  CChunkedArrayIterator& operator+=(
+      difference_type _n
+    )
+  {
+    m_pos += _n;
+    return *this;
+  }
+
+  CChunkedArrayIterator& operator-=(
+      difference_type _n
+    )
+  {
+    m_pos -= _n;
+    return *this;
+  }
+
+  CChunkedArrayIterator operator+(
+      difference_type _n
+    ) const
+  {
+    return CChunkedArrayIterator(m_array, m_pos + _n);
+  }
+
+  friend CChunkedArrayIterator operator+(
+      difference_type _n,
+      const CChunkedArrayIterator& _it
+    )
+  {
+    return _it + _n;
+  }
+
+  template <typename TOtherArray, typename TOther>
+  difference_type operator-(
+      const CChunkedArrayIterator<TOtherArray, TOther>& _other
+    ) const
+  {
+    assert(m_array == _other.m_array);
+    return difference_type(m_pos) - difference_type(_other.m_pos);
+  }
+
+  CChunkedArrayIterator operator-(
+      difference_type _n
+    ) const
+  {
+    return CChunkedArrayIterator(m_array, m_pos - _n);
+  }
+
+private:
+  std::size_t m_pos;
+  TArray* m_array;
+};
+
+// Блок CChunkedArray: буфер с разрывом. Элементы лежат по краям буфера, а
+// свободное место между ними стоит в позиции последней вставки или удаления.
+template <typename TData, typename TAllocator>
+class CChunkedArrayBlock : private TAllocator
+{
+public:
+  explicit CChunkedArrayBlock(
+      const TAllocator& _allocator,
+      std::size_t _capacity = 0
+    );
+  CChunkedArrayBlock(
+      const CChunkedArrayBlock& _block
+    );
+  CChunkedArrayBlock(
+      CChunkedArrayBlock&& _block
+    ) noexcept;
+  ~CChunkedArrayBlock();
+
+  CChunkedArrayBlock& operator=(
+      CChunkedArrayBlock&& _block
+    ) noexcept;
+
+public:
+  template <typename... TArgs>
+  void emplace(
+      std::size_t _index,
+      TArgs&&... _args
+    );
+  void erase(
+      std::size_t _index
+    );
+  void erase(
+      std::size_t _first,
+      std::size_t _last
+    );
+  // переносит элементы начиная с _from в конец блока _to
+  void move_tail(
+      std::size_t _from,
+      CChunkedArrayBlock& _to
+    );
+  std::size_t size() const;
+  TData& operator[](
+      std::size_t _index
+    );
+  const TData& operator[](
+      std::size_t _index
+    ) const;
+
+private:
+  typedef std::allocator_traits<TAllocator> allocator_traits;
+
+  // объекты, которые можно перемещать по памяти побайтово
+  typedef std::integral_constant<
+      bool,
+      std::is_trivially_copyable<TData>::value
+    > trivially_relocatable;
+
+  TAllocator& data_allocator();
+  void move_gap(
+      std::size_t _index
+    );
+  void move_gap(
+      std::size_t _index,
+      std::true_type
+    );
+  void move_gap(
+      std::size_t _index,
+      std::false_type
+    );
+  void reallocate(
+      std::size_t _capacity
+    );
+  void destroy_objects(
+      TData* _data,
+      std::size_t _count
+    );
+  void release();
+
+private:
+  TData* m_data;
+  std::size_t m_capacity;
+
+  // разрыв [m_gapBegin, m_gapEnd) в координатах буфера
+  std::size_t m_gapBegin;
+  std::size_t m_gapEnd;
+};
+
+template <typename TData, typename TAllocator = std::allocator<TData>>
+class CChunkedArray
+{
+public:
+  typedef TData value_type;
+  typedef TAllocator allocator_type;
+  typedef std::size_t size_type;
+  typedef CChunkedArrayIterator<CChunkedArray, TData> iterator;
+  typedef CChunkedArrayIterator<const CChunkedArray, const TData> const_iterator;
+
+  iterator begin();
+  iterator end();
+
+  const_iterator begin() const;
+  const_iterator end() const;
+
+  const_iterator cbegin() const;
+  const_iterator cend() const;
+
+public:
+  CChunkedArray();
+  explicit CChunkedArray(
+      const TAllocator& _allocator
+    );
+  CChunkedArray(
+      std::initializer_list<TData> _values,
+      const TAllocator& _allocator = TAllocator()
+    );
+  CChunkedArray(
+      const CChunkedArray& _array
+    );
+  CChunkedArray(
+      CChunkedArray&& _array
+    ) noexcept;
+  ~CChunkedArray() = default;
+
+  CChunkedArray& operator=(
+      CChunkedArray&& _array
+    ) noexcept;
+
+public:
+  void push_back(
+      const TData& _value
+    );
+  void push_back(
+      TData&& _value
+    );
+  template <typename... TArgs>
+  void emplace_back(
+      TArgs&&... _args
+    );
+  void pop_back();
+  void insert(
+      std::size_t _index,
+      const TData& _value
+    );
+  void insert(
+      std::size_t _index,
+      TData&& _value
+    );
+  template <typename... TArgs>
+  void emplace(
+      std::size_t _index,
+      TArgs&&... _args
+    );
+  void erase(
+      std::size_t _index
+    );
+  void erase(
+      std::size_t _first,
+      std::size_t _last
+    );
+  void clear();
+  std::size_t size() const;
+  TData& operator[](
+      std::size_t _index
+    );
+  const TData& operator[](
+      std::size_t _index
+    ) const;
+
+private:
+  typedef CChunkedArrayBlock<TData, TAllocator> Chunk;
+  typedef typename std::allocator_traits<TAllocator>::template rebind_alloc<Chunk> ChunkAllocator;
+
+  std::size_t get_max_chunk_size() const;
+  void locate(
+      std::size_t _index
+    ) const;
+  void split_chunk(
+      std::size_t _chunk
+    );
+  void merge_chunk(
+      std::size_t _chunk
+    );
+
+private:
+  CArray<Chunk, ChunkAllocator> m_chunks;
+  std::size_t m_size;
+  TAllocator m_allocator;
+
+  // курсор: последний блок, к которому обращались, и индекс его первого элемента
+  mutable std::size_t m_cursorChunk;
+  mutable std::size_t m_cursorStart;
+};
+
+
+// -----------------------------------------------------------------------------
+
+template<typename TData, typename TAllocator>
+CChunkedArrayBlock<TData, TAllocator>::CChunkedArrayBlock(
+    const TAllocator& _allocator,
+    std::size_t _capacity
+  )
+  : TAllocator(_allocator)
+  , m_data(nullptr)
+  , m_capacity(0)
+  , m_gapBegin(0)
+  , m_gapEnd(0)
+{
+  if (_capacity == 0) return;
+
+  m_data = allocator_traits::allocate(data_allocator(), _capacity);
+  m_capacity = m_gapEnd = _capacity;
+}
+
+template<typename TData, typename TAllocator>
+CChunkedArrayBlock<TData, TAllocator>::CChunkedArrayBlock(
+    const CChunkedArrayBlock& _block
+  )
+  : TAllocator(allocator_traits::select_on_container_copy_construction(_block))
+  , m_data(nullptr)
+  , m_capacity(0)
+  , m_gapBegin(0)
+  , m_gapEnd(0)
+{
+  std::size_t size = _block.size();
+  if (size == 0) return;
+
+  m_data = allocator_traits::allocate(data_allocator(), size);
+  m_capacity = size;
+
+  // копия плотная, разрыв остаётся пустым в конце
+  std::size_t i;
+  try
+  {
+    for (i = 0; i < size; ++i) allocator_traits::construct(data_allocator(), m_data + i, _block[i]);
+  }
+  catch (...)
+  {
+    m_gapBegin = i;
+    m_gapEnd = size;
+    release();
+    throw;
+  }
+  m_gapBegin = m_gapEnd = size;
+}
+
+template<typename TData, typename TAllocator>
+CChunkedArrayBlock<TData, TAllocator>::CChunkedArrayBlock(
+    CChunkedArrayBlock&& _block
+  ) noexcept
+  : TAllocator(std::move(_block.data_allocator()))
+  , m_data(_block.m_data)
+  , m_capacity(_block.m_capacity)
+  , m_gapBegin(_block.m_gapBegin)
+  , m_gapEnd(_block.m_gapEnd)
+{
+  _block.m_data = nullptr;
+  _block.m_capacity = _block.m_gapBegin = _block.m_gapEnd = 0;
+}
+
+template<typename TData, typename TAllocator>
+CChunkedArrayBlock<TData, TAllocator>::~CChunkedArrayBlock()
+{
+  release();
+}
+
+template<typename TData, typename TAllocator>
+CChunkedArrayBlock<TData, TAllocator>& CChunkedArrayBlock<TData, TAllocator>::operator=(
+    CChunkedArrayBlock&& _block
+  ) noexcept
+{
+  // распределитель принадлежит буферу и уходит вместе с ним
+  using std::swap;
+  swap(data_allocator(), _block.data_allocator());
+  swap(m_data, _block.m_data);
+  swap(m_capacity, _block.m_capacity);
+  swap(m_gapBegin, _block.m_gapBegin);
+  swap(m_gapEnd, _block.m_gapEnd);
+  return *this;
+}
+
+template<typename TData, typename TAllocator>
+template<typename... TArgs>
+void CChunkedArrayBlock<TData, TAllocator>::emplace(
+    std::size_t _index,
+    TArgs&&... _args
+  )
+{
+  assert(_index <= size());
+
+  if (m_gapBegin == _index && m_gapBegin < m_gapEnd)
+  {
+    // разрыв уже на месте: элементы не двигаются, и аргументы могут
+    // ссылаться на элементы блока
+    allocator_traits::construct(data_allocator(), m_data + m_gapBegin, std::forward<TArgs>(_args)...);
+    ++m_gapBegin;
+    return;
+  }
+
+  TData value(std::forward<TArgs>(_args)...);
+  move_gap(_index);
+  if (m_gapBegin == m_gapEnd) reallocate(m_capacity * 2 > 16 ? m_capacity * 2 : 16);
+  allocator_traits::construct(data_allocator(), m_data + m_gapBegin, std::move(value));
+  ++m_gapBegin;
+}
+
+template<typename TData, typename TAllocator>
+void CChunkedArrayBlock<TData, TAllocator>::erase(
+    std::size_t _index
+  )
+{
+  erase(_index, _index + 1);
+}
+
+template<typename TData, typename TAllocator>
+void CChunkedArrayBlock<TData, TAllocator>::erase(
+    std::size_t _first,
+    std::size_t _last
+  )
+{
+  assert(_first <= _last && _last <= size());
+
+  // удалённые элементы просто становятся частью разрыва
+  move_gap(_first);
+  destroy_objects(m_data + m_gapEnd, _last - _first);
+  m_gapEnd += _last - _first;
+}
+
+template<typename TData, typename TAllocator>
+void CChunkedArrayBlock<TData, TAllocator>::move_tail(
+    std::size_t _from,
+    CChunkedArrayBlock& _to
+  )
+{
+  assert(_from <= size() && &_to != this);
+
+  move_gap(_from);
+  std::size_t count = m_capacity - m_gapEnd;
+  _to.move_gap(_to.size());
+  if (_to.m_gapEnd - _to.m_gapBegin < count) _to.reallocate(_to.size() + count);
+
+  std::size_t i;
+  try
+  {
+    for (i = 0; i < count; ++i)
+    {
+      allocator_traits::construct(_to.data_allocator(), _to.m_data + _to.m_gapBegin + i,
+                                  std::move_if_noexcept(m_data[m_gapEnd + i]));
+    }
+  }
+  catch (...)
+  {
+    _to.destroy_objects(_to.m_data + _to.m_gapBegin, i);
+    throw;
+  }
+
+  _to.m_gapBegin += count;
+  destroy_objects(m_data + m_gapEnd, count);
+  m_gapEnd = m_capacity;
+}
+
+template<typename TData, typename TAllocator>
+std::size_t CChunkedArrayBlock<TData, TAllocator>::size() const
+{
+  return m_capacity - (m_gapEnd - m_gapBegin);
+}
+
+template<typename TData, typename TAllocator>
+TData& CChunkedArrayBlock<TData, TAllocator>::operator[](
+    std::size_t _index
+  )
+{
+  return m_data[_index < m_gapBegin ? _index : _index + (m_gapEnd - m_gapBegin)];
+}
+
+template<typename TData, typename TAllocator>
+const TData& CChunkedArrayBlock<TData, TAllocator>::operator[](
+    std::size_t _index
+  ) const
+{
+  return m_data[_index < m_gapBegin ? _index : _index + (m_gapEnd - m_gapBegin)];
+}
+
+template<typename TData, typename TAllocator>
+TAllocator& CChunkedArrayBlock<TData, TAllocator>::data_allocator()
+{
+  return *this;
+}
+
+template<typename TData, typename TAllocator>
+void CChunkedArrayBlock<TData, TAllocator>::move_gap(
+    std::size_t _index
+  )
+{
+  // пустой разрыв можно поставить куда угодно, ничего не сдвигая
+  if (m_gapBegin == m_gapEnd)
+  {
+    m_gapBegin = m_gapEnd = _index;
+    return;
+  }
+
+  move_gap(_index, trivially_relocatable());
+}
+
+template<typename TData, typename TAllocator>
+void CChunkedArrayBlock<TData, TAllocator>::move_gap(
+    std::size_t _index,
+    std::true_type
+  )
+{
+  if (_index < m_gapBegin)
+  {
+    std::size_t count = m_gapBegin - _index;
+    memmove(m_data + m_gapEnd - count, m_data + _index, count * sizeof(TData));
+    m_gapBegin -= count;
+    m_gapEnd -= count;
+  }
+  else if (_index > m_gapBegin)
+  {
+    std::size_t count = _index - m_gapBegin;
+    memmove(m_data + m_gapBegin, m_data + m_gapEnd, count * sizeof(TData));
+    m_gapBegin += count;
+    m_gapEnd += count;
+  }
+}
+
+template<typename TData, typename TAllocator>
+void CChunkedArrayBlock<TData, TAllocator>::move_gap(
+    std::size_t _index,
+    std::false_type
+  )
+{
+  // по одному элементу через разрыв: при исключении блок остаётся целым
+  while (_index < m_gapBegin)
+  {
+    allocator_traits::construct(data_allocator(), m_data + m_gapEnd - 1, std::move(m_data[m_gapBegin - 1]));
+    allocator_traits::destroy(data_allocator(), m_data + m_gapBegin - 1);
+    --m_gapBegin;
+    --m_gapEnd;
+  }
+  while (_index > m_gapBegin)
+  {
+    allocator_traits::construct(data_allocator(), m_data + m_gapBegin, std::move(m_data[m_gapEnd]));
+    allocator_traits::destroy(data_allocator(), m_data + m_gapEnd);
+    ++m_gapBegin;
+    ++m_gapEnd;
+  }
+}
+
+template<typename TData, typename TAllocator>
+void CChunkedArrayBlock<TData, TAllocator>::reallocate(
+    std::size_t _capacity
+  )
+{
+  assert(_capacity >= size());
+
+  // разрыв остаётся на прежней позиции и забирает всё новое место
+  std::size_t tail = m_capacity - m_gapEnd;
+  std::size_t newGapEnd = _capacity - tail;
+  TData* data = allocator_traits::allocate(data_allocator(), _capacity);
+
+  std::size_t head = 0, moved = 0;
+  try
+  {
+    for (; head < m_gapBegin; ++head)
+    {
+      allocator_traits::construct(data_allocator(), data + head, std::move_if_noexcept(m_data[head]));
+    }
+    for (; moved < tail; ++moved)
+    {
+      allocator_traits::construct(data_allocator(), data + newGapEnd + moved,
+                                  std::move_if_noexcept(m_data[m_gapEnd + moved]));
+    }
+  }
+  catch (...)
+  {
+    destroy_objects(data, head);
+    destroy_objects(data + newGapEnd, moved);
+    allocator_traits::deallocate(data_allocator(), data, _capacity);
+    throw;
+  }
+
+  release();
+  m_data = data;
+  m_capacity = _capacity;
+  m_gapEnd = newGapEnd;
+}
+
+template<typename TData, typename TAllocator>
+void CChunkedArrayBlock<TData, TAllocator>::destroy_objects(
+    TData* _data,
+    std::size_t _count
+  )
+{
+  for (std::size_t i = 0; i < _count; ++i) allocator_traits::destroy(data_allocator(), _data + i);
+}
+
+template<typename TData, typename TAllocator>
+void CChunkedArrayBlock<TData, TAllocator>::release()
+{
+  if (!m_data) return;
+
+  destroy_objects(m_data, m_gapBegin);
+  destroy_objects(m_data + m_gapEnd, m_capacity - m_gapEnd);
+  allocator_traits::deallocate(data_allocator(), m_data, m_capacity);
+}
+
+template<typename TData, typename TAllocator>
+typename CChunkedArray<TData, TAllocator>::iterator CChunkedArray<TData, TAllocator>::begin()
+{
+  return iterator(this, 0);
+}
+
+template<typename TData, typename TAllocator>
+typename CChunkedArray<TData, TAllocator>::iterator CChunkedArray<TData, TAllocator>::end()
+{
+  return iterator(this, m_size);
+}
+
+template<typename TData, typename TAllocator>
+typename CChunkedArray<TData, TAllocator>::const_iterator CChunkedArray<TData, TAllocator>::begin() const
+{
+  return const_iterator(this, 0);
+}
+
+template<typename TData, typename TAllocator>
+typename CChunkedArray<TData, TAllocator>::const_iterator CChunkedArray<TData, TAllocator>::end() const
+{
+  return const_iterator(this, m_size);
+}
+
+template<typename TData, typename TAllocator>
+typename CChunkedArray<TData, TAllocator>::const_iterator CChunkedArray<TData, TAllocator>::cbegin() const
+{
+  return begin();
+}
+
+template<typename TData, typename TAllocator>
+typename CChunkedArray<TData, TAllocator>::const_iterator CChunkedArray<TData, TAllocator>::cend() const
+{
+  return end();
+}
+
+template<typename TData, typename TAllocator>
+CChunkedArray<TData, TAllocator>::CChunkedArray()
+  : m_size(0)
+  , m_cursorChunk(0)
+  , m_cursorStart(0)
+{}
+
+template<typename TData, typename TAllocator>
+CChunkedArray<TData, TAllocator>::CChunkedArray(
+    const TAllocator& _allocator
+  )
+  : m_chunks(ChunkAllocator(_allocator))
+  , m_size(0)
+  , m_allocator(_allocator)
+  , m_cursorChunk(0)
+  , m_cursorStart(0)
+{}
+
+template<typename TData, typename TAllocator>
+CChunkedArray<TData, TAllocator>::CChunkedArray(
+    std::initializer_list<TData> _values,
+    const TAllocator& _allocator
+  )
+  : CChunkedArray(_allocator)
+{
+  for (const TData& value: _values) push_back(value);
+}
+
+template<typename TData, typename TAllocator>
+CChunkedArray<TData, TAllocator>::CChunkedArray(
+    const CChunkedArray& _array
+  )
+  : m_chunks(_array.m_chunks)
+  , m_size(_array.m_size)
+  , m_allocator(_array.m_allocator)
+  , m_cursorChunk(0)
+  , m_cursorStart(0)
+{}
+
+template<typename TData, typename TAllocator>
+CChunkedArray<TData, TAllocator>::CChunkedArray(
+    CChunkedArray&& _array
+  ) noexcept
+  : m_chunks(std::move(_array.m_chunks))
+  , m_size(_array.m_size)
+  , m_allocator(_array.m_allocator)
+  , m_cursorChunk(0)
+  , m_cursorStart(0)
+{
+  _array.m_size = 0;
+  _array.m_cursorChunk = _array.m_cursorStart = 0;
+}
+
+template<typename TData, typename TAllocator>
+CChunkedArray<TData, TAllocator>& CChunkedArray<TData, TAllocator>::operator=(
+    CChunkedArray&& _array
+  ) noexcept
+{
+  if (this == &_array) return *this;
+
+  m_chunks = std::move(_array.m_chunks);
+  m_size = _array.m_size;
+  m_allocator = _array.m_allocator;
+  m_cursorChunk = m_cursorStart = 0;
+  _array.m_size = 0;
+  _array.m_cursorChunk = _array.m_cursorStart = 0;
+  return *this;
+}
+
+template<typename TData, typename TAllocator>
+void CChunkedArray<TData, TAllocator>::push_back(
+    const TData& _value
+  )
+{
+  emplace(m_size, _value);
+}
+
+template<typename TData, typename TAllocator>
+void CChunkedArray<TData, TAllocator>::push_back(
+    TData&& _value
+  )
+{
+  emplace(m_size, std::move(_value));
+}
+
+template<typename TData, typename TAllocator>
+template<typename... TArgs>
+void CChunkedArray<TData, TAllocator>::emplace_back(
+    TArgs&&... _args
+  )
+{
+  emplace(m_size, std::forward<TArgs>(_args)...);
+}
+
+template<typename TData, typename TAllocator>
+void CChunkedArray<TData, TAllocator>::pop_back()
+{
+  erase(m_size - 1);
+}
+
+template<typename TData, typename TAllocator>
+void CChunkedArray<TData, TAllocator>::insert(
+    std::size_t _index,
+    const TData& _value
+  )
+{
+  emplace(_index, _value);
+}
+
+template<typename TData, typename TAllocator>
+void CChunkedArray<TData, TAllocator>::insert(
+    std::size_t _index,
+    TData&& _value
+  )
+{
+  emplace(_index, std::move(_value));
+}
+
+template<typename TData, typename TAllocator>
+template<typename... TArgs>
+void CChunkedArray<TData, TAllocator>::emplace(
+    std::size_t _index,
+    TArgs&&... _args
+  )
+{
+  if (m_chunks.size() == 0)
+  {
+    m_chunks.emplace_back(m_allocator);
+    m_cursorChunk = m_cursorStart = 0;
+  }
+
+  locate(_index);
+  m_chunks[m_cursorChunk].emplace(_index - m_cursorStart, std::forward<TArgs>(_args)...);
+  ++m_size;
+
+  // делим уже после вставки: элементы блоков при перестройке каталога
+  // не двигаются, и аргументы до этого момента остаются действительными
+  if (m_chunks[m_cursorChunk].size() > get_max_chunk_size()) split_chunk(m_cursorChunk);
+}
+
+template<typename TData, typename TAllocator>
+void CChunkedArray<TData, TAllocator>::erase(
+    std::size_t _index
+  )
+{
+  locate(_index);
+  Chunk& chunk = m_chunks[m_cursorChunk];
+  chunk.erase(_index - m_cursorStart);
+  --m_size;
+
+  if (chunk.size() == 0)
+  {
+    m_chunks.erase(m_cursorChunk);
+    if (m_cursorChunk == m_chunks.size() && m_cursorChunk > 0)
+    {
+      --m_cursorChunk;
+      m_cursorStart -= m_chunks[m_cursorChunk].size();
+    }
+  }
+  else merge_chunk(m_cursorChunk);
+}
+
+template<typename TData, typename TAllocator>
+void CChunkedArray<TData, TAllocator>::erase(
+    std::size_t _first,
+    std::size_t _last
+  )
+{
+  while (_first < _last)
+  {
+    locate(_first);
+    Chunk& chunk = m_chunks[m_cursorChunk];
+    std::size_t offset = _first - m_cursorStart;
+    std::size_t count = std::min(chunk.size() - offset, _last - _first);
+    if (count == chunk.size())
+    {
+      m_chunks.erase(m_cursorChunk);
+      m_size -= count;
+      if (m_cursorChunk == m_chunks.size() && m_cursorChunk > 0)
+      {
+        --m_cursorChunk;
+        m_cursorStart -= m_chunks[m_cursorChunk].size();
+      }
+    }
+    else
+    {
+      chunk.erase(offset, offset + count);
+      m_size -= count;
+      merge_chunk(m_cursorChunk);
+    }
+    _last -= count;
+  }
+}
+
+template<typename TData, typename TAllocator>
+void CChunkedArray<TData, TAllocator>::clear()
+{
+  m_chunks.clear();
+  m_size = 0;
+  m_cursorChunk = m_cursorStart = 0;
+}
+
+template<typename TData, typename TAllocator>
+std::size_t CChunkedArray<TData, TAllocator>::size() const
+{
+  return m_size;
+}
+
+template<typename TData, typename TAllocator>
+TData& CChunkedArray<TData, TAllocator>::operator[](
+    std::size_t _index
+  )
+{
+  locate(_index);
+  return m_chunks[m_cursorChunk][_index - m_cursorStart];
+}
+
+template<typename TData, typename TAllocator>
+const TData& CChunkedArray<TData, TAllocator>::operator[](
+    std::size_t _index
+  ) const
+{
+  locate(_index);
+  return m_chunks[m_cursorChunk][_index - m_cursorStart];
+}
+
+template<typename TData, typename TAllocator>
+std::size_t CChunkedArray<TData, TAllocator>::get_max_chunk_size() const
+{
+  // не меньше пары килобайт, чтобы на малых размерах не дробить массив
+  const std::size_t minChunkSize = 2048 / sizeof(TData) > 16 ? 2048 / sizeof(TData) : 16;
+  std::size_t chunkSize = 2 * static_cast<std::size_t>(std::sqrt(static_cast<double>(m_size)));
+  return chunkSize > minChunkSize ? chunkSize : minChunkSize;
+}
+
+template<typename TData, typename TAllocator>
+void CChunkedArray<TData, TAllocator>::locate(
+    std::size_t _index
+  ) const
+{
+  assert(m_chunks.size() > 0 && _index <= m_size);
+
+  // с дальнего конца быстрее начать заново, чем идти от курсора
+  if (_index < m_cursorStart / 2)
+  {
+    m_cursorChunk = m_cursorStart = 0;
+  }
+  else if (_index > m_cursorStart + (m_size - m_cursorStart) / 2 + m_chunks[m_cursorChunk].size())
+  {
+    m_cursorChunk = m_chunks.size() - 1;
+    m_cursorStart = m_size - m_chunks[m_cursorChunk].size();
+  }
+
+  while (_index < m_cursorStart)
+  {
+    --m_cursorChunk;
+    m_cursorStart -= m_chunks[m_cursorChunk].size();
+  }
+  while (_index >= m_cursorStart + m_chunks[m_cursorChunk].size()
+         && m_cursorChunk + 1 < m_chunks.size())
+  {
+    m_cursorStart += m_chunks[m_cursorChunk].size();
+    ++m_cursorChunk;
+  }
+}
+
+template<typename TData, typename TAllocator>
+void CChunkedArray<TData, TAllocator>::split_chunk(
+    std::size_t _chunk
+  )
+{
+  Chunk& chunk = m_chunks[_chunk];
+  std::size_t half = chunk.size() / 2;
+
+  // место под все вставки до следующего деления, включая ту, что его вызовет
+  Chunk tail(m_allocator, get_max_chunk_size() + 1);
+  chunk.move_tail(half, tail);
+  m_chunks.emplace(_chunk + 1, std::move(tail));
+}
+
+template<typename TData, typename TAllocator>
+void CChunkedArray<TData, TAllocator>::merge_chunk(
+    std::size_t _chunk
+  )
+{
+  // слишком маленький блок сливается со следующим, чтобы каталог не разрастался
+  if (_chunk + 1 >= m_chunks.size()) return;
+
+  std::size_t maxChunkSize = get_max_chunk_size();
+  Chunk& chunk = m_chunks[_chunk];
+  Chunk& next = m_chunks[_chunk + 1];
+  if (chunk.size() >= maxChunkSize / 4 || chunk.size() + next.size() > maxChunkSize / 2) return;
+
+  next.move_tail(0, chunk);
+  m_chunks.erase(_chunk + 1);
+}
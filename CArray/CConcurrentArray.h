@@ -0,0 +1,459 @@
+#pragma once
+
+#include "CArray.h"
+#include "CChunkedArray.h"
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <assert.h>
+
+
+// Массив только на добавление для многих потоков. Элементы лежат в сегментах
+// геометрически растущего размера (32, 64, 128, ...), которые никогда не
+// переносятся, поэтому ссылки и указатели на элементы живут до разрушения
+// массива. Добавление без блокировок: индекс резервируется атомарным
+// счётчиком, сегмент при необходимости выделяет тот, кто первым в него
+// попал (проигравший в гонке освобождает свой), затем элемент создаётся
+// на месте и публикуется флагом готовности.
+//
+// Чтение опубликованного элемента по индексу wait-free. Индекс, который
+// вернул push_back, уже опубликован; published_size() - длина префикса, где
+// опубликованы все элементы, и итераторы обходят именно его. Разрушать
+// массив можно только после завершения всех добавлений.
+//
+// Элемент создаётся уже после резервирования индекса, и исключение в этот
+// момент оставило бы в массиве дыру, поэтому конструктор, который может
+// бросить, выполняется заранее во временный объект, а в ячейку тот
+// переносится перемещением без исключений. Нехватка памяти при выделении
+// сегмента всё же оставляет неопубликованный индекс, и префикс
+// published_size() за него уже не продвинется.
+template <typename TData, typename TAllocator = std::allocator<TData>>
+class CConcurrentArray
+{
+  static_assert(std::is_nothrow_move_constructible<TData>::value,
+                "CConcurrentArray constructs reserved slots by move and needs a noexcept move constructor");
+
+public:
+  typedef TData value_type;
+  typedef TAllocator allocator_type;
+  typedef std::size_t size_type;
+  typedef CChunkedArrayIterator<CConcurrentArray, TData> iterator;
+  typedef CChunkedArrayIterator<const CConcurrentArray, const TData> const_iterator;
+
+  iterator begin();
+  iterator end();
+
+  const_iterator begin() const;
+  const_iterator end() const;
+
+  const_iterator cbegin() const;
+  const_iterator cend() const;
+
+public:
+  CConcurrentArray();
+  explicit CConcurrentArray(
+      const TAllocator& _allocator
+    );
+  CConcurrentArray(
+      const CConcurrentArray&
+    ) = delete;
+  ~CConcurrentArray();
+
+  CConcurrentArray& operator=(
+      const CConcurrentArray&
+    ) = delete;
+
+public:
+  // возвращают индекс добавленного элемента
+  std::size_t push_back(
+      const TData& _value
+    );
+  std::size_t push_back(
+      TData&& _value
+    );
+  template <typename... TArgs>
+  std::size_t emplace_back(
+      TArgs&&... _args
+    );
+
+  // выделяет сегменты под _size элементов заранее
+  void reserve(
+      std::size_t _size
+    );
+
+  // число зарезервированных индексов, включая ещё не опубликованные
+  std::size_t size() const;
+  std::size_t published_size() const;
+  bool is_published(
+      std::size_t _index
+    ) const;
+
+  TData& operator[](
+      std::size_t _index
+    );
+  const TData& operator[](
+      std::size_t _index
+    ) const;
+
+  // копия опубликованного префикса в обычный непрерывный CArray
+  CArray<TData, TAllocator> snapshot() const;
+
+  TAllocator get_allocator() const;
+
+private:
+  struct Slot
+  {
+    Slot()
+      : ready(false)
+    {}
+
+    typename std::aligned_storage<sizeof(TData), alignof(TData)>::type storage;
+    std::atomic<bool> ready;
+  };
+
+  typedef typename std::allocator_traits<TAllocator>::template rebind_alloc<Slot> SlotAllocator;
+  typedef std::allocator_traits<SlotAllocator> SlotTraits;
+
+  // первый сегмент - 2^FirstSegmentBits элементов, каждый следующий вдвое больше
+  static const std::size_t FirstSegmentBits = 5;
+  static const std::size_t FirstSegmentSize = std::size_t(1) << FirstSegmentBits;
+  static const std::size_t MaxSegments = sizeof(std::size_t) * 8 - FirstSegmentBits;
+
+  static std::size_t segment_of(
+      std::size_t _index
+    );
+  static std::size_t segment_start(
+      std::size_t _segment
+    );
+  static std::size_t segment_size(
+      std::size_t _segment
+    );
+
+  Slot& slot(
+      std::size_t _index
+    ) const;
+  Slot* get_segment(
+      std::size_t _segment
+    );
+  std::size_t reserve_slot();
+  void publish(
+      std::size_t _index
+    );
+  template <typename... TArgs>
+  std::size_t emplace_nothrow(
+      TArgs&&... _args
+    );
+  template <typename... TArgs>
+  std::size_t emplace_back(
+      std::true_type,
+      TArgs&&... _args
+    );
+  template <typename... TArgs>
+  std::size_t emplace_back(
+      std::false_type,
+      TArgs&&... _args
+    );
+
+private:
+  std::atomic<Slot*> m_segments[MaxSegments];
+  std::atomic<std::size_t> m_size;
+  std::atomic<std::size_t> m_published;
+  TAllocator m_allocator;
+};
+
+
+// -----------------------------------------------------------------------------
+
+template<typename TData, typename TAllocator>
+typename CConcurrentArray<TData, TAllocator>::iterator CConcurrentArray<TData, TAllocator>::begin()
+{
+  return iterator(this, 0);
+}
+
+template<typename TData, typename TAllocator>
+typename CConcurrentArray<TData, TAllocator>::iterator CConcurrentArray<TData, TAllocator>::end()
+{
+  return iterator(this, published_size());
+}
+
+template<typename TData, typename TAllocator>
+typename CConcurrentArray<TData, TAllocator>::const_iterator CConcurrentArray<TData, TAllocator>::begin() const
+{
+  return const_iterator(this, 0);
+}
+
+template<typename TData, typename TAllocator>
+typename CConcurrentArray<TData, TAllocator>::const_iterator CConcurrentArray<TData, TAllocator>::end() const
+{
+  return const_iterator(this, published_size());
+}
+
+template<typename TData, typename TAllocator>
+typename CConcurrentArray<TData, TAllocator>::const_iterator CConcurrentArray<TData, TAllocator>::cbegin() const
+{
+  return begin();
+}
+
+template<typename TData, typename TAllocator>
+typename CConcurrentArray<TData, TAllocator>::const_iterator CConcurrentArray<TData, TAllocator>::cend() const
+{
+  return end();
+}
+
+template<typename TData, typename TAllocator>
+CConcurrentArray<TData, TAllocator>::CConcurrentArray()
+  : CConcurrentArray(TAllocator())
+{}
+
+template<typename TData, typename TAllocator>
+CConcurrentArray<TData, TAllocator>::CConcurrentArray(
+    const TAllocator& _allocator
+  )
+  : m_size(0)
+  , m_published(0)
+  , m_allocator(_allocator)
+{
+  for (std::size_t segment = 0; segment < MaxSegments; ++segment) m_segments[segment].store(nullptr);
+}
+
+template<typename TData, typename TAllocator>
+CConcurrentArray<TData, TAllocator>::~CConcurrentArray()
+{
+  SlotAllocator slotAllocator(m_allocator);
+  for (std::size_t segment = 0; segment < MaxSegments; ++segment)
+  {
+    Slot* slots = m_segments[segment].load(std::memory_order_acquire);
+    if (!slots) continue;
+
+    const std::size_t count = segment_size(segment);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+      if (slots[i].ready.load(std::memory_order_relaxed))
+      {
+        std::allocator_traits<TAllocator>::destroy(m_allocator, reinterpret_cast<TData*>(&slots[i].storage));
+      }
+      SlotTraits::destroy(slotAllocator, slots + i);
+    }
+    SlotTraits::deallocate(slotAllocator, slots, count);
+  }
+}
+
+template<typename TData, typename TAllocator>
+std::size_t CConcurrentArray<TData, TAllocator>::push_back(
+    const TData& _value
+  )
+{
+  return emplace_back(_value);
+}
+
+template<typename TData, typename TAllocator>
+std::size_t CConcurrentArray<TData, TAllocator>::push_back(
+    TData&& _value
+  )
+{
+  return emplace_back(std::move(_value));
+}
+
+template<typename TData, typename TAllocator>
+template<typename... TArgs>
+std::size_t CConcurrentArray<TData, TAllocator>::emplace_back(
+    TArgs&&... _args
+  )
+{
+  return emplace_back(std::integral_constant<bool, std::is_nothrow_constructible<TData, TArgs&&...>::value>(),
+                      std::forward<TArgs>(_args)...);
+}
+
+template<typename TData, typename TAllocator>
+template<typename... TArgs>
+std::size_t CConcurrentArray<TData, TAllocator>::emplace_back(
+    std::true_type,
+    TArgs&&... _args
+  )
+{
+  return emplace_nothrow(std::forward<TArgs>(_args)...);
+}
+
+template<typename TData, typename TAllocator>
+template<typename... TArgs>
+std::size_t CConcurrentArray<TData, TAllocator>::emplace_back(
+    std::false_type,
+    TArgs&&... _args
+  )
+{
+  TData value(std::forward<TArgs>(_args)...);
+  return emplace_nothrow(std::move(value));
+}
+
+template<typename TData, typename TAllocator>
+template<typename... TArgs>
+std::size_t CConcurrentArray<TData, TAllocator>::emplace_nothrow(
+    TArgs&&... _args
+  )
+{
+  const std::size_t index = reserve_slot();
+  Slot& target = slot(index);
+  std::allocator_traits<TAllocator>::construct(
+      m_allocator, reinterpret_cast<TData*>(&target.storage), std::forward<TArgs>(_args)...);
+  publish(index);
+  return index;
+}
+
+template<typename TData, typename TAllocator>
+void CConcurrentArray<TData, TAllocator>::reserve(
+    std::size_t _size
+  )
+{
+  if (_size == 0) return;
+  const std::size_t last = segment_of(_size - 1);
+  for (std::size_t segment = 0; segment <= last; ++segment) get_segment(segment);
+}
+
+template<typename TData, typename TAllocator>
+std::size_t CConcurrentArray<TData, TAllocator>::size() const
+{
+  return m_size.load(std::memory_order_acquire);
+}
+
+template<typename TData, typename TAllocator>
+std::size_t CConcurrentArray<TData, TAllocator>::published_size() const
+{
+  return m_published.load(std::memory_order_acquire);
+}
+
+template<typename TData, typename TAllocator>
+bool CConcurrentArray<TData, TAllocator>::is_published(
+    std::size_t _index
+  ) const
+{
+  if (_index >= size()) return false;
+  Slot* slots = m_segments[segment_of(_index)].load(std::memory_order_acquire);
+  return slots && slots[_index - segment_start(segment_of(_index))].ready.load(std::memory_order_acquire);
+}
+
+template<typename TData, typename TAllocator>
+TData& CConcurrentArray<TData, TAllocator>::operator[](
+    std::size_t _index
+  )
+{
+  assert(is_published(_index));
+  return *reinterpret_cast<TData*>(&slot(_index).storage);
+}
+
+template<typename TData, typename TAllocator>
+const TData& CConcurrentArray<TData, TAllocator>::operator[](
+    std::size_t _index
+  ) const
+{
+  assert(is_published(_index));
+  return *reinterpret_cast<const TData*>(&slot(_index).storage);
+}
+
+template<typename TData, typename TAllocator>
+CArray<TData, TAllocator> CConcurrentArray<TData, TAllocator>::snapshot() const
+{
+  const std::size_t count = published_size();
+  CArray<TData, TAllocator> result(m_allocator);
+  result.reserve(count);
+  for (std::size_t i = 0; i < count; ++i) result.push_back((*this)[i]);
+  return result;
+}
+
+template<typename TData, typename TAllocator>
+TAllocator CConcurrentArray<TData, TAllocator>::get_allocator() const
+{
+  return m_allocator;
+}
+
+template<typename TData, typename TAllocator>
+std::size_t CConcurrentArray<TData, TAllocator>::segment_of(
+    std::size_t _index
+  )
+{
+  // сегмент k начинается с индекса FirstSegmentSize * (2^k - 1), поэтому
+  // его номер - старший бит (index + FirstSegmentSize) минус FirstSegmentBits
+  const std::size_t shifted = _index + FirstSegmentSize;
+#ifdef __GNUC__
+  const std::size_t highBit = sizeof(unsigned long long) * 8 - 1 - __builtin_clzll(shifted);
+#else
+  std::size_t highBit = 0;
+  while (shifted >> (highBit + 1)) ++highBit;
+#endif
+  return highBit - FirstSegmentBits;
+}
+
+template<typename TData, typename TAllocator>
+std::size_t CConcurrentArray<TData, TAllocator>::segment_start(
+    std::size_t _segment
+  )
+{
+  return FirstSegmentSize * ((std::size_t(1) << _segment) - 1);
+}
+
+template<typename TData, typename TAllocator>
+std::size_t CConcurrentArray<TData, TAllocator>::segment_size(
+    std::size_t _segment
+  )
+{
+  return FirstSegmentSize << _segment;
+}
+
+template<typename TData, typename TAllocator>
+typename CConcurrentArray<TData, TAllocator>::Slot& CConcurrentArray<TData, TAllocator>::slot(
+    std::size_t _index
+  ) const
+{
+  const std::size_t segment = segment_of(_index);
+  return m_segments[segment].load(std::memory_order_acquire)[_index - segment_start(segment)];
+}
+
+template<typename TData, typename TAllocator>
+typename CConcurrentArray<TData, TAllocator>::Slot* CConcurrentArray<TData, TAllocator>::get_segment(
+    std::size_t _segment
+  )
+{
+  Slot* slots = m_segments[_segment].load(std::memory_order_acquire);
+  if (slots) return slots;
+
+  SlotAllocator slotAllocator(m_allocator);
+  const std::size_t count = segment_size(_segment);
+  Slot* created = SlotTraits::allocate(slotAllocator, count);
+  for (std::size_t i = 0; i < count; ++i) SlotTraits::construct(slotAllocator, created + i);
+
+  if (m_segments[_segment].compare_exchange_strong(slots, created, std::memory_order_acq_rel)) return created;
+
+  // сегмент уже выделил другой поток
+  for (std::size_t i = 0; i < count; ++i) SlotTraits::destroy(slotAllocator, created + i);
+  SlotTraits::deallocate(slotAllocator, created, count);
+  return slots;
+}
+
+template<typename TData, typename TAllocator>
+std::size_t CConcurrentArray<TData, TAllocator>::reserve_slot()
+{
+  const std::size_t index = m_size.fetch_add(1, std::memory_order_acq_rel);
+  get_segment(segment_of(index));
+  return index;
+}
+
+// Флаг готовности отпускает элемент читателям, затем опубликованный префикс
+// продвигается через все подряд готовые элементы. Продвигать может любой
+// производитель, поэтому префикс не ждёт медленного потока дольше, чем
+// тот создаёт свой элемент.
+template<typename TData, typename TAllocator>
+void CConcurrentArray<TData, TAllocator>::publish(
+    std::size_t _index
+  )
+{
+  slot(_index).ready.store(true, std::memory_order_release);
+
+  std::size_t published = m_published.load(std::memory_order_acquire);
+  while (is_published(published))
+  {
+    if (m_published.compare_exchange_weak(published, published + 1, std::memory_order_acq_rel)) ++published;
+  }
+}
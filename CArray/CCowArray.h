@@ -0,0 +1,635 @@
+#pragma once
+
+#include "CArray.h"
+
+#include <atomic>
+#include <cstddef>
+#include <initializer_list>
+#include <memory>
+#include <utility>
+#include <assert.h>
+
+
+// Массив с неявным разделением данных (как QVector): копия только
+// увеличивает счётчик ссылок общего буфера, а отдельный буфер появляется при
+// первом изменяющем вызове. Так массив, который в основном читают, можно
+// передавать по значению за O(1).
+//
+// Чтение - только через константные методы: неконстантные operator[],
+// data() и begin() отделяют буфер, даже если затем ничего не пишут. Ссылки и
+// итераторы, полученные неконстантным доступом, нельзя использовать после
+// копирования массива - запись через них попадёт в общий буфер.
+//
+// Счётчик ссылок атомарный, поэтому разные копии можно читать и менять из
+// разных потоков; один и тот же объект - как обычный контейнер. Распределитель
+// принадлежит буферу и переходит вместе с ним при копировании и обмене.
+template <typename TData, typename TAllocator = std::allocator<TData>>
+class CCowArray : private TAllocator
+{
+public:
+  typedef CArray<TData, TAllocator> array_type;
+  typedef TData value_type;
+  typedef typename array_type::iterator iterator;
+  typedef typename array_type::const_iterator const_iterator;
+
+  // неконстантные begin/end отделяют буфер
+  iterator begin();
+  iterator end();
+
+  const_iterator begin() const;
+  const_iterator end() const;
+
+  const_iterator cbegin() const;
+  const_iterator cend() const;
+
+public:
+  CCowArray();
+  explicit CCowArray(
+      const TAllocator& _allocator
+    );
+  CCowArray(
+      std::initializer_list<TData> _values,
+      const TAllocator& _allocator = TAllocator()
+    );
+  // забирает готовый массив без копирования элементов
+  explicit CCowArray(
+      array_type&& _array
+    );
+  CCowArray(
+      const CCowArray& _array
+    ) noexcept;
+  CCowArray(
+      CCowArray&& _array
+    ) noexcept;
+  ~CCowArray();
+
+  CCowArray& operator=(
+      const CCowArray& _array
+    ) noexcept;
+  CCowArray& operator=(
+      CCowArray&& _array
+    ) noexcept;
+
+public:
+  // Общий массив только для чтения. У массива без буфера (пустого или
+  // перемещённого) это общий статический пустой массив, поэтому вызов
+  // требует распределителя с конструктором по умолчанию; остальные
+  // константные методы обходятся без него.
+  const array_type& array() const;
+  // Собственный буфер: если он разделён с другими копиями, элементы
+  // копируются. Через результат доступен весь интерфейс CArray.
+  array_type& detach();
+  bool is_shared() const;
+  std::size_t use_count() const;
+
+  void push_back(
+      const TData& _value
+    );
+  void push_back(
+      TData&& _value
+    );
+  template <typename... TArgs>
+  void emplace_back(
+      TArgs&&... _args
+    );
+  void pop_back();
+  void insert(
+      std::size_t _index,
+      const TData& _value
+    );
+  void insert(
+      std::size_t _index,
+      TData&& _value
+    );
+  template <typename... TArgs>
+  void emplace(
+      std::size_t _index,
+      TArgs&&... _args
+    );
+  template <typename TIterator>
+  void insert(
+      std::size_t _index,
+      TIterator _first,
+      TIterator _last
+    );
+  template <typename TIterator>
+  void append(
+      TIterator _first,
+      TIterator _last
+    );
+  template <typename TIterator>
+  void assign(
+      TIterator _first,
+      TIterator _last
+    );
+  void erase(
+      std::size_t _index
+    );
+  void erase(
+      std::size_t _first,
+      std::size_t _last
+    );
+  template <typename TPredicate>
+  std::size_t erase_if(
+      TPredicate _predicate
+    );
+  void clear();
+  void swap(
+      CCowArray& _array
+    ) noexcept;
+  std::size_t size() const;
+  bool empty() const;
+  std::size_t capacity() const;
+  void reserve(
+      std::size_t _size
+    );
+  void resize(
+      std::size_t _size
+    );
+  void resize(
+      std::size_t _size,
+      const TData& _value
+    );
+  void shrink_to_fit();
+  TData* data();
+  const TData* data() const;
+  TData& operator[](
+      std::size_t _index
+    );
+  const TData& operator[](
+      std::size_t _index
+    ) const;
+  TAllocator get_allocator() const;
+
+private:
+  struct Block
+  {
+    explicit Block(
+        array_type&& _array
+      )
+      : refs(1)
+      , array(std::move(_array))
+    {}
+
+    std::atomic<std::size_t> refs;
+    array_type array;
+  };
+
+  typedef typename std::allocator_traits<TAllocator>::template rebind_alloc<Block> block_allocator;
+  typedef std::allocator_traits<block_allocator> block_traits;
+
+  // пустой массив без буфера, общий для всех пустых копий
+  static const array_type& empty_array();
+
+  Block* create_block(
+      array_type&& _array
+    );
+  void release();
+
+private:
+  Block* m_block;
+};
+
+
+// -----------------------------------------------------------------------------
+
+template<typename TData, typename TAllocator>
+typename CCowArray<TData, TAllocator>::iterator CCowArray<TData, TAllocator>::begin()
+{
+  return detach().begin();
+}
+
+template<typename TData, typename TAllocator>
+typename CCowArray<TData, TAllocator>::iterator CCowArray<TData, TAllocator>::end()
+{
+  return detach().end();
+}
+
+template<typename TData, typename TAllocator>
+typename CCowArray<TData, TAllocator>::const_iterator CCowArray<TData, TAllocator>::begin() const
+{
+  return m_block ? m_block->array.begin() : const_iterator();
+}
+
+template<typename TData, typename TAllocator>
+typename CCowArray<TData, TAllocator>::const_iterator CCowArray<TData, TAllocator>::end() const
+{
+  return m_block ? m_block->array.end() : const_iterator();
+}
+
+template<typename TData, typename TAllocator>
+typename CCowArray<TData, TAllocator>::const_iterator CCowArray<TData, TAllocator>::cbegin() const
+{
+  return begin();
+}
+
+template<typename TData, typename TAllocator>
+typename CCowArray<TData, TAllocator>::const_iterator CCowArray<TData, TAllocator>::cend() const
+{
+  return end();
+}
+
+template<typename TData, typename TAllocator>
+CCowArray<TData, TAllocator>::CCowArray()
+  : m_block(nullptr)
+{}
+
+template<typename TData, typename TAllocator>
+CCowArray<TData, TAllocator>::CCowArray(
+    const TAllocator& _allocator
+  )
+  : TAllocator(_allocator)
+  , m_block(nullptr)
+{}
+
+template<typename TData, typename TAllocator>
+CCowArray<TData, TAllocator>::CCowArray(
+    std::initializer_list<TData> _values,
+    const TAllocator& _allocator
+  )
+  : TAllocator(_allocator)
+  , m_block(nullptr)
+{
+  if (_values.size()) m_block = create_block(array_type(_values, _allocator));
+}
+
+template<typename TData, typename TAllocator>
+CCowArray<TData, TAllocator>::CCowArray(
+    array_type&& _array
+  )
+  : TAllocator(_array.get_allocator())
+  , m_block(nullptr)
+{
+  if (_array.size()) m_block = create_block(std::move(_array));
+}
+
+template<typename TData, typename TAllocator>
+CCowArray<TData, TAllocator>::CCowArray(
+    const CCowArray& _array
+  ) noexcept
+  : TAllocator(static_cast<const TAllocator&>(_array))
+  , m_block(_array.m_block)
+{
+  if (m_block) m_block->refs.fetch_add(1, std::memory_order_relaxed);
+}
+
+template<typename TData, typename TAllocator>
+CCowArray<TData, TAllocator>::CCowArray(
+    CCowArray&& _array
+  ) noexcept
+  : TAllocator(static_cast<const TAllocator&>(_array))
+  , m_block(_array.m_block)
+{
+  _array.m_block = nullptr;
+}
+
+template<typename TData, typename TAllocator>
+CCowArray<TData, TAllocator>::~CCowArray()
+{
+  release();
+}
+
+template<typename TData, typename TAllocator>
+CCowArray<TData, TAllocator>& CCowArray<TData, TAllocator>::operator=(
+    const CCowArray& _array
+  ) noexcept
+{
+  CCowArray array(_array);
+  swap(array);
+  return *this;
+}
+
+template<typename TData, typename TAllocator>
+CCowArray<TData, TAllocator>& CCowArray<TData, TAllocator>::operator=(
+    CCowArray&& _array
+  ) noexcept
+{
+  CCowArray array(std::move(_array));
+  swap(array);
+  return *this;
+}
+
+template<typename TData, typename TAllocator>
+const typename CCowArray<TData, TAllocator>::array_type& CCowArray<TData, TAllocator>::array() const
+{
+  return m_block ? m_block->array : empty_array();
+}
+
+template<typename TData, typename TAllocator>
+typename CCowArray<TData, TAllocator>::array_type& CCowArray<TData, TAllocator>::detach()
+{
+  if (!m_block)
+  {
+    m_block = create_block(array_type(static_cast<const TAllocator&>(*this)));
+  }
+  else if (m_block->refs.load(std::memory_order_acquire) != 1)
+  {
+    // копия делается до отпускания общего буфера: при исключении массив
+    // остаётся прежним
+    Block* block = create_block(array_type(m_block->array));
+    release();
+    m_block = block;
+  }
+  return m_block->array;
+}
+
+template<typename TData, typename TAllocator>
+bool CCowArray<TData, TAllocator>::is_shared() const
+{
+  return use_count() > 1;
+}
+
+template<typename TData, typename TAllocator>
+std::size_t CCowArray<TData, TAllocator>::use_count() const
+{
+  return m_block ? m_block->refs.load(std::memory_order_acquire) : 0;
+}
+
+template<typename TData, typename TAllocator>
+void CCowArray<TData, TAllocator>::push_back(
+    const TData& _value
+  )
+{
+  // _value может лежать в общем буфере, который detach отпустит, поэтому
+  // при разделении буфера сначала делается копия значения
+  if (is_shared())
+  {
+    TData value(_value);
+    detach().push_back(std::move(value));
+  }
+  else detach().push_back(_value);
+}
+
+template<typename TData, typename TAllocator>
+void CCowArray<TData, TAllocator>::push_back(
+    TData&& _value
+  )
+{
+  detach().push_back(std::move(_value));
+}
+
+template<typename TData, typename TAllocator>
+template<typename... TArgs>
+void CCowArray<TData, TAllocator>::emplace_back(
+    TArgs&&... _args
+  )
+{
+  detach().emplace_back(std::forward<TArgs>(_args)...);
+}
+
+template<typename TData, typename TAllocator>
+void CCowArray<TData, TAllocator>::pop_back()
+{
+  detach().pop_back();
+}
+
+template<typename TData, typename TAllocator>
+void CCowArray<TData, TAllocator>::insert(
+    std::size_t _index,
+    const TData& _value
+  )
+{
+  if (is_shared())
+  {
+    TData value(_value);
+    detach().insert(_index, std::move(value));
+  }
+  else detach().insert(_index, _value);
+}
+
+template<typename TData, typename TAllocator>
+void CCowArray<TData, TAllocator>::insert(
+    std::size_t _index,
+    TData&& _value
+  )
+{
+  detach().insert(_index, std::move(_value));
+}
+
+template<typename TData, typename TAllocator>
+template<typename... TArgs>
+void CCowArray<TData, TAllocator>::emplace(
+    std::size_t _index,
+    TArgs&&... _args
+  )
+{
+  detach().emplace(_index, std::forward<TArgs>(_args)...);
+}
+
+template<typename TData, typename TAllocator>
+template<typename TIterator>
+void CCowArray<TData, TAllocator>::insert(
+    std::size_t _index,
+    TIterator _first,
+    TIterator _last
+  )
+{
+  detach().insert(_index, _first, _last);
+}
+
+template<typename TData, typename TAllocator>
+template<typename TIterator>
+void CCowArray<TData, TAllocator>::append(
+    TIterator _first,
+    TIterator _last
+  )
+{
+  detach().append(_first, _last);
+}
+
+template<typename TData, typename TAllocator>
+template<typename TIterator>
+void CCowArray<TData, TAllocator>::assign(
+    TIterator _first,
+    TIterator _last
+  )
+{
+  // старое содержимое не нужно, копировать его при отделении незачем;
+  // диапазон может указывать в общий буфер, поэтому он отпускается последним
+  if (is_shared())
+  {
+    array_type array(get_allocator());
+    array.append(_first, _last);
+    *this = CCowArray(std::move(array));
+  }
+  else detach().assign(_first, _last);
+}
+
+template<typename TData, typename TAllocator>
+void CCowArray<TData, TAllocator>::erase(
+    std::size_t _index
+  )
+{
+  detach().erase(_index);
+}
+
+template<typename TData, typename TAllocator>
+void CCowArray<TData, TAllocator>::erase(
+    std::size_t _first,
+    std::size_t _last
+  )
+{
+  detach().erase(_first, _last);
+}
+
+template<typename TData, typename TAllocator>
+template<typename TPredicate>
+std::size_t CCowArray<TData, TAllocator>::erase_if(
+    TPredicate _predicate
+  )
+{
+  if (!is_shared()) return m_block ? m_block->array.erase_if(_predicate) : 0;
+
+  // из общего буфера копируются только оставшиеся элементы
+  const array_type& shared = m_block->array;
+  array_type array(get_allocator());
+  array.reserve(shared.size());
+  for (const TData& value: shared)
+  {
+    if (!_predicate(value)) array.push_back(value);
+  }
+  const std::size_t erased = shared.size() - array.size();
+  if (erased) *this = CCowArray(std::move(array));
+  return erased;
+}
+
+template<typename TData, typename TAllocator>
+void CCowArray<TData, TAllocator>::clear()
+{
+  if (is_shared()) release();
+  else if (m_block) m_block->array.clear();
+}
+
+template<typename TData, typename TAllocator>
+void CCowArray<TData, TAllocator>::swap(
+    CCowArray& _array
+  ) noexcept
+{
+  // распределитель меняется вместе с буфером, который он выделил
+  std::swap(static_cast<TAllocator&>(*this), static_cast<TAllocator&>(_array));
+  std::swap(m_block, _array.m_block);
+}
+
+template<typename TData, typename TAllocator>
+std::size_t CCowArray<TData, TAllocator>::size() const
+{
+  return m_block ? m_block->array.size() : 0;
+}
+
+template<typename TData, typename TAllocator>
+bool CCowArray<TData, TAllocator>::empty() const
+{
+  return size() == 0;
+}
+
+template<typename TData, typename TAllocator>
+std::size_t CCowArray<TData, TAllocator>::capacity() const
+{
+  return m_block ? m_block->array.capacity() : 0;
+}
+
+template<typename TData, typename TAllocator>
+void CCowArray<TData, TAllocator>::reserve(
+    std::size_t _size
+  )
+{
+  detach().reserve(_size);
+}
+
+template<typename TData, typename TAllocator>
+void CCowArray<TData, TAllocator>::resize(
+    std::size_t _size
+  )
+{
+  detach().resize(_size);
+}
+
+template<typename TData, typename TAllocator>
+void CCowArray<TData, TAllocator>::resize(
+    std::size_t _size,
+    const TData& _value
+  )
+{
+  if (is_shared())
+  {
+    TData value(_value);
+    detach().resize(_size, value);
+  }
+  else detach().resize(_size, _value);
+}
+
+template<typename TData, typename TAllocator>
+void CCowArray<TData, TAllocator>::shrink_to_fit()
+{
+  if (m_block) detach().shrink_to_fit();
+}
+
+template<typename TData, typename TAllocator>
+TData* CCowArray<TData, TAllocator>::data()
+{
+  return detach().data();
+}
+
+template<typename TData, typename TAllocator>
+const TData* CCowArray<TData, TAllocator>::data() const
+{
+  return m_block ? m_block->array.data() : nullptr;
+}
+
+template<typename TData, typename TAllocator>
+TData& CCowArray<TData, TAllocator>::operator[](
+    std::size_t _index
+  )
+{
+  assert(_index < size());
+  return detach()[_index];
+}
+
+template<typename TData, typename TAllocator>
+const TData& CCowArray<TData, TAllocator>::operator[](
+    std::size_t _index
+  ) const
+{
+  assert(_index < size());
+  return m_block->array[_index];
+}
+
+template<typename TData, typename TAllocator>
+TAllocator CCowArray<TData, TAllocator>::get_allocator() const
+{
+  return static_cast<const TAllocator&>(*this);
+}
+
+template<typename TData, typename TAllocator>
+const typename CCowArray<TData, TAllocator>::array_type& CCowArray<TData, TAllocator>::empty_array()
+{
+  static const array_type array;
+  return array;
+}
+
+template<typename TData, typename TAllocator>
+typename CCowArray<TData, TAllocator>::Block* CCowArray<TData, TAllocator>::create_block(
+    array_type&& _array
+  )
+{
+  block_allocator allocator(static_cast<const TAllocator&>(*this));
+  Block* block = block_traits::allocate(allocator, 1);
+  block_traits::construct(allocator, block, std::move(_array));
+  return block;
+}
+
+template<typename TData, typename TAllocator>
+void CCowArray<TData, TAllocator>::release()
+{
+  if (!m_block) return;
+
+  // последняя ссылка разрушает буфер; acq_rel упорядочивает записи прочих
+  // владельцев перед разрушением
+  if (m_block->refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+  {
+    block_allocator allocator(static_cast<const TAllocator&>(*this));
+    block_traits::destroy(allocator, m_block);
+    block_traits::deallocate(allocator, m_block, 1);
+  }
+  m_block = nullptr;
+}
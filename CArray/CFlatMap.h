@@ -0,0 +1,402 @@
+#pragma once
+
+#include "CSortedArray.h"
+
+#include <cstddef>
+#include <iterator>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+
+// Изменяемый итератор CFlatMap. Пары хранятся как std::pair<TKey, TValue>,
+// поэтому ссылка на элемент - пара ссылок, в которой ключ константный:
+// поменять ключ и сломать порядок через итератор нельзя. Как и у
+// std::flat_map, *it привязывается к auto или const auto&, но не к auto&.
+template <typename TKey, typename TValue>
+class CFlatMapIterator
+{
+  typedef CArrayIterator<std::pair<TKey, TValue>> Base;
+
+public:
+  typedef std::random_access_iterator_tag iterator_category;
+  typedef std::pair<TKey, TValue> value_type;
+  typedef std::ptrdiff_t difference_type;
+  typedef std::pair<const TKey&, TValue&> reference;
+
+  // it->second: пара ссылок живёт в самом указателе
+  class pointer
+  {
+  public:
+    explicit pointer(
+        const reference& _reference
+      )
+      : m_reference(_reference)
+    {}
+
+    const reference* operator->() const
+    {
+      return &m_reference;
+    }
+
+  private:
+    reference m_reference;
+  };
+
+  CFlatMapIterator() {}
+
+  explicit CFlatMapIterator(
+      const Base& _it
+    )
+    : m_it(_it)
+  {}
+
+  // для erase и сравнения с константными итераторами
+  operator CArrayIterator<const value_type>() const
+  {
+    return m_it;
+  }
+
+public:
+  bool operator==(
+      const CFlatMapIterator& _other
+    ) const
+  {
+    return m_it == _other.m_it;
+  }
+
+  bool operator!=(
+      const CFlatMapIterator& _other
+    ) const
+  {
+    return m_it != _other.m_it;
+  }
+
+  bool operator<(
+      const CFlatMapIterator& _other
+    ) const
+  {
+    return m_it < _other.m_it;
+  }
+
+  bool operator>(
+      const CFlatMapIterator& _other
+    ) const
+  {
+    return _other < *this;
+  }
+
+  bool operator<=(
+      const CFlatMapIterator& _other
+    ) const
+  {
+    return !(_other < *this);
+  }
+
+  bool operator>=(
+      const CFlatMapIterator& _other
+    ) const
+  {
+    return !(*this < _other);
+  }
+
+  reference operator*() const
+  {
+    return reference(m_it->first, m_it->second);
+  }
+
+  pointer operator->() const
+  {
+    return pointer(**this);
+  }
+
+  reference operator[](
+      difference_type _n
+    ) const
+  {
+    return *(*this + _n);
+  }
+
+  CFlatMapIterator& operator++()
+  {
+    ++m_it;
+    return *this;
+  }
+
+  CFlatMapIterator operator++(int)
+  {
+    CFlatMapIterator old(*this);
+    ++m_it;
+    return old;
+  }
+
+  CFlatMapIterator& operator--()
+  {
+    --m_it;
+    return *this;
+  }
+
+  CFlatMapIterator operator--(int)
+  {
+    CFlatMapIterator old(*this);
+    --m_it;
+    return old;
+  }
+
+  CFlatMapIterator& operator+=(
+      difference_type _n
+    )
+  {
+    m_it += _n;
+    return *this;
+  }
+
+  CFlatMapIterator& operator-=(
+      difference_type _n
+    )
+  {
+    m_it -= _n;
+    return *this;
+  }
+
+  CFlatMapIterator operator+(
+      difference_type _n
+    ) const
+  {
+    return CFlatMapIterator(m_it + _n);
+  }
+
+  friend CFlatMapIterator operator+(
+      difference_type _n,
+      const CFlatMapIterator& _it
+    )
+  {
+    return _it + _n;
+  }
+
+  CFlatMapIterator operator-(
+      difference_type _n
+    ) const
+  {
+    return CFlatMapIterator(m_it - _n);
+  }
+
+  difference_type operator-(
+      const CFlatMapIterator& _other
+    ) const
+  {
+    return m_it - _other.m_it;
+  }
+
+private:
+  Base m_it;
+};
+
+// Упорядоченное отображение поверх CArray: пары ключ-значение лежат подряд
+// в порядке ключей. Ключ пары менять нельзя, значение - можно.
+template <
+    typename TKey,
+    typename TValue,
+    typename TCompare = std::less<TKey>,
+    typename TAllocator = std::allocator<std::pair<TKey, TValue>>
+  >
+class CFlatMap
+  : public CSortedArray<std::pair<TKey, TValue>, TKey, CPairFirstKey, TCompare, TAllocator>
+{
+  typedef CSortedArray<std::pair<TKey, TValue>, TKey, CPairFirstKey, TCompare, TAllocator> Base;
+
+public:
+  typedef TValue mapped_type;
+  typedef CFlatMapIterator<TKey, TValue> iterator;
+  typedef typename Base::const_iterator const_iterator;
+
+  using Base::begin;
+  using Base::end;
+  iterator begin();
+  iterator end();
+
+public:
+  explicit CFlatMap(
+      const TCompare& _compare = TCompare(),
+      const TAllocator& _allocator = TAllocator()
+    );
+  CFlatMap(
+      std::initializer_list<std::pair<TKey, TValue>> _values,
+      const TCompare& _compare = TCompare(),
+      const TAllocator& _allocator = TAllocator()
+    );
+  template <typename TIterator>
+  CFlatMap(
+      TIterator _first,
+      TIterator _last,
+      const TCompare& _compare = TCompare(),
+      const TAllocator& _allocator = TAllocator()
+    );
+
+public:
+  using Base::insert;
+  std::pair<iterator, bool> insert(
+      const std::pair<TKey, TValue>& _value
+    );
+  std::pair<iterator, bool> insert(
+      std::pair<TKey, TValue>&& _value
+    );
+  template <typename... TArgs>
+  std::pair<iterator, bool> try_emplace(
+      const TKey& _key,
+      TArgs&&... _args
+    );
+  template <typename TArgument>
+  std::pair<iterator, bool> insert_or_assign(
+      const TKey& _key,
+      TArgument&& _value
+    );
+
+  using Base::find;
+  iterator find(
+      const TKey& _key
+    );
+  TValue& operator[](
+      const TKey& _key
+    );
+  TValue& at(
+      const TKey& _key
+    );
+  const TValue& at(
+      const TKey& _key
+    ) const;
+};
+
+
+// -----------------------------------------------------------------------------
+
+template<typename TKey, typename TValue, typename TCompare, typename TAllocator>
+typename CFlatMap<TKey, TValue, TCompare, TAllocator>::iterator
+CFlatMap<TKey, TValue, TCompare, TAllocator>::begin()
+{
+  return iterator(this->m_data.begin());
+}
+
+template<typename TKey, typename TValue, typename TCompare, typename TAllocator>
+typename CFlatMap<TKey, TValue, TCompare, TAllocator>::iterator
+CFlatMap<TKey, TValue, TCompare, TAllocator>::end()
+{
+  return iterator(this->m_data.end());
+}
+
+template<typename TKey, typename TValue, typename TCompare, typename TAllocator>
+CFlatMap<TKey, TValue, TCompare, TAllocator>::CFlatMap(
+    const TCompare& _compare,
+    const TAllocator& _allocator
+  )
+  : Base(_compare, _allocator)
+{}
+
+template<typename TKey, typename TValue, typename TCompare, typename TAllocator>
+CFlatMap<TKey, TValue, TCompare, TAllocator>::CFlatMap(
+    std::initializer_list<std::pair<TKey, TValue>> _values,
+    const TCompare& _compare,
+    const TAllocator& _allocator
+  )
+  : Base(_compare, _allocator)
+{
+  Base::insert(_values.begin(), _values.end());
+}
+
+template<typename TKey, typename TValue, typename TCompare, typename TAllocator>
+template<typename TIterator>
+CFlatMap<TKey, TValue, TCompare, TAllocator>::CFlatMap(
+    TIterator _first,
+    TIterator _last,
+    const TCompare& _compare,
+    const TAllocator& _allocator
+  )
+  : Base(_compare, _allocator)
+{
+  Base::insert(_first, _last);
+}
+
+template<typename TKey, typename TValue, typename TCompare, typename TAllocator>
+std::pair<typename CFlatMap<TKey, TValue, TCompare, TAllocator>::iterator, bool>
+CFlatMap<TKey, TValue, TCompare, TAllocator>::insert(
+    const std::pair<TKey, TValue>& _value
+  )
+{
+  std::pair<std::size_t, bool> result = this->insert_value(_value);
+  return std::make_pair(begin() + result.first, result.second);
+}
+
+template<typename TKey, typename TValue, typename TCompare, typename TAllocator>
+std::pair<typename CFlatMap<TKey, TValue, TCompare, TAllocator>::iterator, bool>
+CFlatMap<TKey, TValue, TCompare, TAllocator>::insert(
+    std::pair<TKey, TValue>&& _value
+  )
+{
+  std::pair<std::size_t, bool> result = this->insert_value(std::move(_value));
+  return std::make_pair(begin() + result.first, result.second);
+}
+
+template<typename TKey, typename TValue, typename TCompare, typename TAllocator>
+template<typename... TArgs>
+std::pair<typename CFlatMap<TKey, TValue, TCompare, TAllocator>::iterator, bool>
+CFlatMap<TKey, TValue, TCompare, TAllocator>::try_emplace(
+    const TKey& _key,
+    TArgs&&... _args
+  )
+{
+  std::pair<std::size_t, bool> result = this->emplace_value(
+      _key,
+      std::piecewise_construct,
+      std::forward_as_tuple(_key),
+      std::forward_as_tuple(std::forward<TArgs>(_args)...));
+  return std::make_pair(begin() + result.first, result.second);
+}
+
+template<typename TKey, typename TValue, typename TCompare, typename TAllocator>
+template<typename TArgument>
+std::pair<typename CFlatMap<TKey, TValue, TCompare, TAllocator>::iterator, bool>
+CFlatMap<TKey, TValue, TCompare, TAllocator>::insert_or_assign(
+    const TKey& _key,
+    TArgument&& _value
+  )
+{
+  std::pair<iterator, bool> result = try_emplace(_key, std::forward<TArgument>(_value));
+  if (!result.second) result.first->second = std::forward<TArgument>(_value);
+  return result;
+}
+
+template<typename TKey, typename TValue, typename TCompare, typename TAllocator>
+typename CFlatMap<TKey, TValue, TCompare, TAllocator>::iterator
+CFlatMap<TKey, TValue, TCompare, TAllocator>::find(
+    const TKey& _key
+  )
+{
+  return begin() + this->find_index(_key);
+}
+
+template<typename TKey, typename TValue, typename TCompare, typename TAllocator>
+TValue& CFlatMap<TKey, TValue, TCompare, TAllocator>::operator[](
+    const TKey& _key
+  )
+{
+  return try_emplace(_key).first->second;
+}
+
+template<typename TKey, typename TValue, typename TCompare, typename TAllocator>
+TValue& CFlatMap<TKey, TValue, TCompare, TAllocator>::at(
+    const TKey& _key
+  )
+{
+  std::size_t index = this->find_index(_key);
+  if (index == this->m_data.size()) throw std::out_of_range("CFlatMap::at: no such key");
+  return this->m_data[index].second;
+}
+
+template<typename TKey, typename TValue, typename TCompare, typename TAllocator>
+const TValue& CFlatMap<TKey, TValue, TCompare, TAllocator>::at(
+    const TKey& _key
+  ) const
+{
+  std::size_t index = this->find_index(_key);
+  if (index == this->m_data.size()) throw std::out_of_range("CFlatMap::at: no such key");
+  return this->m_data[index].second;
+}
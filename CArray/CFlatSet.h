@@ -0,0 +1,101 @@
+#pragma once
+
+#include "CSortedArray.h"
+
+// Упорядоченное множество поверх CArray. Итераторы константные: изменение
+// элемента на месте нарушило бы порядок.
+template <
+    typename TKey,
+    typename TCompare = std::less<TKey>,
+    typename TAllocator = std::allocator<TKey>
+  >
+class CFlatSet : public CSortedArray<TKey, TKey, CIdentityKey, TCompare, TAllocator>
+{
+  typedef CSortedArray<TKey, TKey, CIdentityKey, TCompare, TAllocator> Base;
+
+public:
+  typedef typename Base::const_iterator iterator;
+  typedef typename Base::const_iterator const_iterator;
+
+public:
+  explicit CFlatSet(
+      const TCompare& _compare = TCompare(),
+      const TAllocator& _allocator = TAllocator()
+    );
+  CFlatSet(
+      std::initializer_list<TKey> _values,
+      const TCompare& _compare = TCompare(),
+      const TAllocator& _allocator = TAllocator()
+    );
+  template <typename TIterator>
+  CFlatSet(
+      TIterator _first,
+      TIterator _last,
+      const TCompare& _compare = TCompare(),
+      const TAllocator& _allocator = TAllocator()
+    );
+
+public:
+  using Base::insert;
+  std::pair<const_iterator, bool> insert(
+      const TKey& _value
+    );
+  std::pair<const_iterator, bool> insert(
+      TKey&& _value
+    );
+};
+
+
+// -----------------------------------------------------------------------------
+
+template<typename TKey, typename TCompare, typename TAllocator>
+CFlatSet<TKey, TCompare, TAllocator>::CFlatSet(
+    const TCompare& _compare,
+    const TAllocator& _allocator
+  )
+  : Base(_compare, _allocator)
+{}
+
+template<typename TKey, typename TCompare, typename TAllocator>
+CFlatSet<TKey, TCompare, TAllocator>::CFlatSet(
+    std::initializer_list<TKey> _values,
+    const TCompare& _compare,
+    const TAllocator& _allocator
+  )
+  : Base(_compare, _allocator)
+{
+  Base::insert(_values.begin(), _values.end());
+}
+
+template<typename TKey, typename TCompare, typename TAllocator>
+template<typename TIterator>
+CFlatSet<TKey, TCompare, TAllocator>::CFlatSet(
+    TIterator _first,
+    TIterator _last,
+    const TCompare& _compare,
+    const TAllocator& _allocator
+  )
+  : Base(_compare, _allocator)
+{
+  Base::insert(_first, _last);
+}
+
+template<typename TKey, typename TCompare, typename TAllocator>
+std::pair<typename CFlatSet<TKey, TCompare, TAllocator>::const_iterator, bool>
+CFlatSet<TKey, TCompare, TAllocator>::insert(
+    const TKey& _value
+  )
+{
+  std::pair<std::size_t, bool> result = this->insert_value(_value);
+  return std::make_pair(this->m_data.cbegin() + result.first, result.second);
+}
+
+template<typename TKey, typename TCompare, typename TAllocator>
+std::pair<typename CFlatSet<TKey, TCompare, TAllocator>::const_iterator, bool>
+CFlatSet<TKey, TCompare, TAllocator>::insert(
+    TKey&& _value
+  )
+{
+  std::pair<std::size_t, bool> result = this->insert_value(std::move(_value));
+  return std::make_pair(this->m_data.cbegin() + result.first, result.second);
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+#include "CArray.h"
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+
+
+// Распределитель для многогигабайтных массивов тривиально копируемых данных:
+// каждый блок - отдельное анонимное отображение, которое растёт через mremap
+// без копирования содержимого. По запросу отображения помечаются для
+// прозрачных огромных страниц (MADV_HUGEPAGE). Только для Linux.
+template <typename TData>
+class CMmapAllocator
+{
+  static_assert(std::is_trivially_copyable<TData>::value,
+                "CMmapAllocator relocates memory with mremap and needs trivially copyable data");
+
+  template <typename TOther>
+  friend class CMmapAllocator;
+
+public:
+  typedef TData value_type;
+
+  explicit CMmapAllocator(
+      bool _hugePages = false
+    ) noexcept
+    : m_hugePages(_hugePages)
+  {}
+
+  template <typename TOther>
+  CMmapAllocator(
+      const CMmapAllocator<TOther>& _other
+    ) noexcept
+    : m_hugePages(_other.m_hugePages)
+  {}
+
+  TData* allocate(
+      std::size_t _n
+    )
+  {
+    std::size_t bytes = get_mapping_size(_n);
+    void* ptr = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ptr == MAP_FAILED) throw std::bad_alloc();
+    advise(ptr, bytes);
+    return static_cast<TData*>(ptr);
+  }
+
+  void deallocate(
+      TData* _ptr,
+      std::size_t _n
+    ) noexcept
+  {
+    munmap(_ptr, get_mapping_size(_n));
+  }
+
+  TData* reallocate(
+      TData* _ptr,
+      std::size_t _oldSize,
+      std::size_t _newSize
+    )
+  {
+    std::size_t oldBytes = get_mapping_size(_oldSize);
+    std::size_t newBytes = get_mapping_size(_newSize);
+    if (oldBytes == newBytes) return _ptr;
+
+    void* ptr = mremap(_ptr, oldBytes, newBytes, MREMAP_MAYMOVE);
+    if (ptr == MAP_FAILED) throw std::bad_alloc();
+    advise(ptr, newBytes);
+    return static_cast<TData*>(ptr);
+  }
+
+  template <typename TOther>
+  bool operator==(
+      const CMmapAllocator<TOther>&
+    ) const
+  {
+    return true;
+  }
+
+  template <typename TOther>
+  bool operator!=(
+      const CMmapAllocator<TOther>&
+    ) const
+  {
+    return false;
+  }
+
+private:
+  static std::size_t get_mapping_size(
+      std::size_t _n
+    )
+  {
+    static const std::size_t pageSize = sysconf(_SC_PAGESIZE);
+
+    if (_n > (std::size_t(-1) - pageSize) / sizeof(TData)) throw std::bad_alloc();
+    std::size_t bytes = _n ? _n * sizeof(TData) : 1;
+    return (bytes + pageSize - 1) & ~(pageSize - 1);
+  }
+
+  void advise(
+      void* _ptr,
+      std::size_t _bytes
+    ) const
+  {
+#ifdef MADV_HUGEPAGE
+    if (m_hugePages) madvise(_ptr, _bytes, MADV_HUGEPAGE);
+#else
+    (void)_ptr;
+    (void)_bytes;
+#endif
+  }
+
+private:
+  bool m_hugePages;
+};
+
+
+// Массив для больших объёмов тривиально копируемых данных: рост без полного
+// копирования, ёмкость округляется до целых страниц.
+template <typename TData, typename TGrowthPolicy = CPageAlignedGrowth<>>
+using CLargeArray = CArray<TData, CMmapAllocator<TData>, 0, TGrowthPolicy>;
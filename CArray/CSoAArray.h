@@ -0,0 +1,657 @@
+#pragma once
+
+#include "CArray.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <assert.h>
+
+
+// Последовательность индексов 0..N-1 для раскрытия по столбцам (в C++11
+// нет std::index_sequence).
+template <std::size_t... Indices>
+struct CSoAIndices
+{};
+
+template <std::size_t Count, std::size_t... Indices>
+struct CSoAMakeIndices : CSoAMakeIndices<Count - 1, Count - 1, Indices...>
+{};
+
+template <std::size_t... Indices>
+struct CSoAMakeIndices<0, Indices...>
+{
+  typedef CSoAIndices<Indices...> type;
+};
+
+
+// Итератор CSoAArray: разыменование возвращает кортеж ссылок на поля
+// элемента по значению (прокси), поэтому operator-> нет.
+template <typename TArray, typename TReference, typename TValue>
+class CSoAArrayIterator
+{
+  template <typename TOtherArray, typename TOtherReference, typename TOtherValue>
+  friend class CSoAArrayIterator;
+
+public:
+  typedef std::random_access_iterator_tag iterator_category;
+  typedef TValue value_type;
+  typedef std::ptrdiff_t difference_type;
+  typedef void pointer;
+  typedef TReference reference;
+
+  CSoAArrayIterator()
+    : m_pos(0)
+    , m_array(nullptr)
+  {}
+
+  CSoAArrayIterator(
+      TArray* _array,
+      std::size_t _pos
+    )
+    : m_pos(_pos)
+    , m_array(_array)
+  {}
+
+  template <
+      typename TOtherArray,
+      typename TOtherReference,
+      typename = typename std::enable_if<std::is_convertible<TOtherArray*, TArray*>::value>::type
+    >
+  CSoAArrayIterator(
+      const CSoAArrayIterator<TOtherArray, TOtherReference, TValue>& _other
+    )
+    : m_pos(_other.m_pos)
+    , m_array(_other.m_array)
+  {}
+
+public:
+  bool operator==(const CSoAArrayIterator& _other) const { return m_pos == _other.m_pos; }
+  bool operator!=(const CSoAArrayIterator& _other) const { return m_pos != _other.m_pos; }
+  bool operator<(const CSoAArrayIterator& _other) const { return m_pos < _other.m_pos; }
+  bool operator>(const CSoAArrayIterator& _other) const { return m_pos > _other.m_pos; }
+  bool operator<=(const CSoAArrayIterator& _other) const { return m_pos <= _other.m_pos; }
+  bool operator>=(const CSoAArrayIterator& _other) const { return m_pos >= _other.m_pos; }
+
+  TReference operator*() const { return (*m_array)[m_pos]; }
+  TReference operator[](difference_type _n) const { return (*m_array)[m_pos + _n]; }
+
+  CSoAArrayIterator& operator++() { ++m_pos; return *this; }
+  CSoAArrayIterator& operator--() { --m_pos; return *this; }
+  CSoAArrayIterator operator++(int) { CSoAArrayIterator it(*this); ++m_pos; return it; }
+  CSoAArrayIterator operator--(int) { CSoAArrayIterator it(*this); --m_pos; return it; }
+  CSoAArrayIterator& operator+=(difference_type _n) { m_pos += _n; return *this; }
+  CSoAArrayIterator& operator-=(difference_type _n) { m_pos -= _n; return *this; }
+  CSoAArrayIterator operator+(difference_type _n) const { return CSoAArrayIterator(m_array, m_pos + _n); }
+  CSoAArrayIterator operator-(difference_type _n) const { return CSoAArrayIterator(m_array, m_pos - _n); }
+
+  difference_type operator-(
+      const CSoAArrayIterator& _other
+    ) const
+  {
+    return difference_type(m_pos) - difference_type(_other.m_pos);
+  }
+
+private:
+  std::size_t m_pos;
+  TArray* m_array;
+};
+
+
+// Массив записей, разложенный по столбцам: каждое поле хранится в своём
+// CArray, и проход по одному полю (column<I>()) читает только его байты и
+// векторизуется компилятором. Элемент снаружи выглядит как кортеж: operator[]
+// и итераторы возвращают std::tuple ссылок на поля, push_back и insert
+// принимают значения всех полей.
+//
+// Изменения затрагивают все столбцы: если вставка в очередной столбец
+// бросила исключение, уже вставленные поля удаляются, и размеры столбцов
+// остаются равными. std::sort через прокси-итератор не работает, для
+// сортировки есть sort(), переставляющий столбцы по общему порядку.
+template <typename... Fields>
+class CSoAArray
+{
+  static_assert(sizeof...(Fields) > 0, "CSoAArray needs at least one field");
+
+  typedef typename CSoAMakeIndices<sizeof...(Fields)>::type Indices;
+
+public:
+  typedef std::tuple<Fields...> value_type;
+  typedef std::tuple<Fields&...> reference;
+  typedef std::tuple<const Fields&...> const_reference;
+  typedef std::size_t size_type;
+  typedef CSoAArrayIterator<CSoAArray, reference, value_type> iterator;
+  typedef CSoAArrayIterator<const CSoAArray, const_reference, value_type> const_iterator;
+
+  template <std::size_t Index>
+  using column_type = CArray<typename std::tuple_element<Index, value_type>::type>;
+
+  iterator begin();
+  iterator end();
+
+  const_iterator begin() const;
+  const_iterator end() const;
+
+  const_iterator cbegin() const;
+  const_iterator cend() const;
+
+public:
+  CSoAArray() = default;
+  CSoAArray(
+      std::initializer_list<value_type> _values
+    );
+
+public:
+  void push_back(
+      const Fields&... _values
+    );
+  void push_back(
+      const value_type& _value
+    );
+  void push_back(
+      value_type&& _value
+    );
+  // по одному аргументу на поле, каждое поле создаётся на месте
+  template <typename... TArgs>
+  void emplace_back(
+      TArgs&&... _args
+    );
+  void insert(
+      std::size_t _index,
+      const value_type& _value
+    );
+  void insert(
+      std::size_t _index,
+      value_type&& _value
+    );
+  template <typename... TArgs>
+  void emplace(
+      std::size_t _index,
+      TArgs&&... _args
+    );
+
+  void pop_back();
+  void erase(
+      std::size_t _index
+    );
+  void erase(
+      std::size_t _first,
+      std::size_t _last
+    );
+  template <typename TPredicate>
+  std::size_t erase_if(
+      TPredicate _predicate
+    );
+  void clear();
+
+  void swap(
+      CSoAArray& _array
+    ) noexcept;
+  std::size_t size() const;
+  bool empty() const;
+  void reserve(
+      std::size_t _size
+    );
+  void resize(
+      std::size_t _size
+    );
+  void shrink_to_fit();
+
+  reference operator[](
+      std::size_t _index
+    );
+  const_reference operator[](
+      std::size_t _index
+    ) const;
+
+  template <std::size_t Index>
+  column_type<Index>& column();
+  template <std::size_t Index>
+  const column_type<Index>& column() const;
+
+  // Устойчивая сортировка по _compare(const_reference, const_reference):
+  // сначала сортируется массив индексов, затем каждый столбец
+  // переставляется по нему одним проходом.
+  template <typename TCompare>
+  void sort(
+      TCompare _compare
+    );
+  // сортировка по одному полю
+  template <std::size_t Index>
+  void sort_by();
+
+private:
+  template <typename TTuple, std::size_t Column>
+  void emplace_columns(
+      std::size_t _index,
+      TTuple&& _values,
+      std::integral_constant<std::size_t, Column>
+    );
+  template <typename TTuple>
+  void emplace_columns(
+      std::size_t _index,
+      TTuple&& _values,
+      std::integral_constant<std::size_t, sizeof...(Fields)>
+    );
+  template <std::size_t... Columns>
+  reference make_reference(
+      std::size_t _index,
+      CSoAIndices<Columns...>
+    );
+  template <std::size_t... Columns>
+  const_reference make_reference(
+      std::size_t _index,
+      CSoAIndices<Columns...>
+    ) const;
+  template <typename TFunction, std::size_t... Columns>
+  void for_each_column(
+      TFunction _function,
+      CSoAIndices<Columns...>
+    );
+
+  // Операции над одним столбцом для for_each_column (в C++11 нет
+  // обобщённых лямбд). EraseColumn обрезает _last до размера столбца.
+  struct EraseColumn
+  {
+    std::size_t first;
+    std::size_t last;
+    template <typename TColumn>
+    void operator()(TColumn& _column) const
+    {
+      const std::size_t end = std::min(last, _column.size());
+      if (first < end) _column.erase(first, end);
+    }
+  };
+  struct ReserveColumn
+  {
+    std::size_t size;
+    template <typename TColumn>
+    void operator()(TColumn& _column) const { _column.reserve(size); }
+  };
+  struct ResizeColumn
+  {
+    std::size_t size;
+    template <typename TColumn>
+    void operator()(TColumn& _column) const { _column.resize(size); }
+  };
+  struct ShrinkColumn
+  {
+    template <typename TColumn>
+    void operator()(TColumn& _column) const { _column.shrink_to_fit(); }
+  };
+  // оставить элементы с номерами из kept (по возрастанию), сдвинув их к началу
+  struct CompactColumn
+  {
+    const CArray<std::size_t>& kept;
+    template <typename TColumn>
+    void operator()(TColumn& _column) const
+    {
+      for (std::size_t i = 0; i < kept.size(); ++i)
+      {
+        if (kept[i] != i) _column[i] = std::move(_column[kept[i]]);
+      }
+      _column.erase(kept.size(), _column.size());
+    }
+  };
+  // переложить столбец в порядке order одним проходом в новый буфер
+  struct PermuteColumn
+  {
+    const CArray<std::size_t>& order;
+    template <typename TColumn>
+    void operator()(TColumn& _column) const
+    {
+      TColumn permuted(_column.get_allocator());
+      permuted.reserve(_column.size());
+      for (std::size_t index: order) permuted.push_back(std::move(_column[index]));
+      _column.swap(permuted);
+    }
+  };
+
+private:
+  std::tuple<CArray<Fields>...> m_columns;
+};
+
+
+// -----------------------------------------------------------------------------
+
+template<typename... Fields>
+typename CSoAArray<Fields...>::iterator CSoAArray<Fields...>::begin()
+{
+  return iterator(this, 0);
+}
+
+template<typename... Fields>
+typename CSoAArray<Fields...>::iterator CSoAArray<Fields...>::end()
+{
+  return iterator(this, size());
+}
+
+template<typename... Fields>
+typename CSoAArray<Fields...>::const_iterator CSoAArray<Fields...>::begin() const
+{
+  return const_iterator(this, 0);
+}
+
+template<typename... Fields>
+typename CSoAArray<Fields...>::const_iterator CSoAArray<Fields...>::end() const
+{
+  return const_iterator(this, size());
+}
+
+template<typename... Fields>
+typename CSoAArray<Fields...>::const_iterator CSoAArray<Fields...>::cbegin() const
+{
+  return begin();
+}
+
+template<typename... Fields>
+typename CSoAArray<Fields...>::const_iterator CSoAArray<Fields...>::cend() const
+{
+  return end();
+}
+
+template<typename... Fields>
+CSoAArray<Fields...>::CSoAArray(
+    std::initializer_list<value_type> _values
+  )
+{
+  reserve(_values.size());
+  for (const value_type& value: _values) push_back(value);
+}
+
+template<typename... Fields>
+void CSoAArray<Fields...>::push_back(
+    const Fields&... _values
+  )
+{
+  emplace_columns(size(), std::forward_as_tuple(_values...), std::integral_constant<std::size_t, 0>());
+}
+
+template<typename... Fields>
+void CSoAArray<Fields...>::push_back(
+    const value_type& _value
+  )
+{
+  emplace_columns(size(), _value, std::integral_constant<std::size_t, 0>());
+}
+
+template<typename... Fields>
+void CSoAArray<Fields...>::push_back(
+    value_type&& _value
+  )
+{
+  emplace_columns(size(), std::move(_value), std::integral_constant<std::size_t, 0>());
+}
+
+template<typename... Fields>
+template<typename... TArgs>
+void CSoAArray<Fields...>::emplace_back(
+    TArgs&&... _args
+  )
+{
+  emplace(size(), std::forward<TArgs>(_args)...);
+}
+
+template<typename... Fields>
+void CSoAArray<Fields...>::insert(
+    std::size_t _index,
+    const value_type& _value
+  )
+{
+  emplace_columns(_index, _value, std::integral_constant<std::size_t, 0>());
+}
+
+template<typename... Fields>
+void CSoAArray<Fields...>::insert(
+    std::size_t _index,
+    value_type&& _value
+  )
+{
+  emplace_columns(_index, std::move(_value), std::integral_constant<std::size_t, 0>());
+}
+
+template<typename... Fields>
+template<typename... TArgs>
+void CSoAArray<Fields...>::emplace(
+    std::size_t _index,
+    TArgs&&... _args
+  )
+{
+  static_assert(sizeof...(TArgs) == sizeof...(Fields), "CSoAArray::emplace takes one argument per field");
+  emplace_columns(_index, std::forward_as_tuple(std::forward<TArgs>(_args)...),
+                  std::integral_constant<std::size_t, 0>());
+}
+
+template<typename... Fields>
+void CSoAArray<Fields...>::pop_back()
+{
+  erase(size() - 1);
+}
+
+template<typename... Fields>
+void CSoAArray<Fields...>::erase(
+    std::size_t _index
+  )
+{
+  for_each_column(EraseColumn{_index, _index + 1}, Indices());
+}
+
+template<typename... Fields>
+void CSoAArray<Fields...>::erase(
+    std::size_t _first,
+    std::size_t _last
+  )
+{
+  for_each_column(EraseColumn{_first, _last}, Indices());
+}
+
+template<typename... Fields>
+template<typename TPredicate>
+std::size_t CSoAArray<Fields...>::erase_if(
+    TPredicate _predicate
+  )
+{
+  // предикат видит элемент целиком, поэтому сначала собираются номера
+  // оставшихся, затем каждый столбец уплотняется по ним
+  const std::size_t oldSize = size();
+  CArray<std::size_t> kept;
+  kept.reserve(oldSize);
+  for (std::size_t i = 0; i < oldSize; ++i)
+  {
+    if (!_predicate(static_cast<const CSoAArray&>(*this)[i])) kept.push_back(i);
+  }
+  if (kept.size() == oldSize) return 0;
+
+  for_each_column(CompactColumn{kept}, Indices());
+  return oldSize - kept.size();
+}
+
+template<typename... Fields>
+void CSoAArray<Fields...>::clear()
+{
+  for_each_column(EraseColumn{0, size()}, Indices());
+}
+
+template<typename... Fields>
+void CSoAArray<Fields...>::swap(
+    CSoAArray& _array
+  ) noexcept
+{
+  m_columns.swap(_array.m_columns);
+}
+
+template<typename... Fields>
+std::size_t CSoAArray<Fields...>::size() const
+{
+  return std::get<0>(m_columns).size();
+}
+
+template<typename... Fields>
+bool CSoAArray<Fields...>::empty() const
+{
+  return size() == 0;
+}
+
+template<typename... Fields>
+void CSoAArray<Fields...>::reserve(
+    std::size_t _size
+  )
+{
+  for_each_column(ReserveColumn{_size}, Indices());
+}
+
+template<typename... Fields>
+void CSoAArray<Fields...>::resize(
+    std::size_t _size
+  )
+{
+  // при ошибке в середине столбцы возвращаются к прежнему размеру
+  const std::size_t oldSize = size();
+  try
+  {
+    for_each_column(ResizeColumn{_size}, Indices());
+  }
+  catch (...)
+  {
+    for_each_column(EraseColumn{oldSize, std::size_t(-1)}, Indices());
+    throw;
+  }
+}
+
+template<typename... Fields>
+void CSoAArray<Fields...>::shrink_to_fit()
+{
+  for_each_column(ShrinkColumn(), Indices());
+}
+
+template<typename... Fields>
+typename CSoAArray<Fields...>::reference CSoAArray<Fields...>::operator[](
+    std::size_t _index
+  )
+{
+  assert(_index < size());
+  return make_reference(_index, Indices());
+}
+
+template<typename... Fields>
+typename CSoAArray<Fields...>::const_reference CSoAArray<Fields...>::operator[](
+    std::size_t _index
+  ) const
+{
+  assert(_index < size());
+  return make_reference(_index, Indices());
+}
+
+template<typename... Fields>
+template<std::size_t Index>
+typename CSoAArray<Fields...>::template column_type<Index>& CSoAArray<Fields...>::column()
+{
+  return std::get<Index>(m_columns);
+}
+
+template<typename... Fields>
+template<std::size_t Index>
+const typename CSoAArray<Fields...>::template column_type<Index>& CSoAArray<Fields...>::column() const
+{
+  return std::get<Index>(m_columns);
+}
+
+template<typename... Fields>
+template<typename TCompare>
+void CSoAArray<Fields...>::sort(
+    TCompare _compare
+  )
+{
+  const std::size_t count = size();
+  CArray<std::size_t> order;
+  order.reserve(count);
+  for (std::size_t i = 0; i < count; ++i) order.push_back(i);
+
+  const CSoAArray& self = *this;
+  std::stable_sort(order.begin(), order.end(), [&self, &_compare](std::size_t _left, std::size_t _right) {
+    return _compare(self[_left], self[_right]);
+  });
+  for_each_column(PermuteColumn{order}, Indices());
+}
+
+template<typename... Fields>
+template<std::size_t Index>
+void CSoAArray<Fields...>::sort_by()
+{
+  const column_type<Index>& key = column<Index>();
+  const std::size_t count = size();
+  CArray<std::size_t> order;
+  order.reserve(count);
+  for (std::size_t i = 0; i < count; ++i) order.push_back(i);
+
+  std::stable_sort(order.begin(), order.end(), [&key](std::size_t _left, std::size_t _right) {
+    return key[_left] < key[_right];
+  });
+  for_each_column(PermuteColumn{order}, Indices());
+}
+
+template<typename... Fields>
+template<typename TTuple, std::size_t Column>
+void CSoAArray<Fields...>::emplace_columns(
+    std::size_t _index,
+    TTuple&& _values,
+    std::integral_constant<std::size_t, Column>
+  )
+{
+  assert(_index <= size());
+  std::get<Column>(m_columns).emplace(_index, std::get<Column>(std::forward<TTuple>(_values)));
+  try
+  {
+    emplace_columns(_index, std::forward<TTuple>(_values), std::integral_constant<std::size_t, Column + 1>());
+  }
+  catch (...)
+  {
+    std::get<Column>(m_columns).erase(_index);
+    throw;
+  }
+}
+
+template<typename... Fields>
+template<typename TTuple>
+void CSoAArray<Fields...>::emplace_columns(
+    std::size_t,
+    TTuple&&,
+    std::integral_constant<std::size_t, sizeof...(Fields)>
+  )
+{}
+
+template<typename... Fields>
+template<std::size_t... Columns>
+typename CSoAArray<Fields...>::reference CSoAArray<Fields...>::make_reference(
+    std::size_t _index,
+    CSoAIndices<Columns...>
+  )
+{
+  return reference(std::get<Columns>(m_columns)[_index]...);
+}
+
+template<typename... Fields>
+template<std::size_t... Columns>
+typename CSoAArray<Fields...>::const_reference CSoAArray<Fields...>::make_reference(
+    std::size_t _index,
+    CSoAIndices<Columns...>
+  ) const
+{
+  return const_reference(std::get<Columns>(m_columns)[_index]...);
+}
+
+template<typename... Fields>
+template<typename TFunction, std::size_t... Columns>
+void CSoAArray<Fields...>::for_each_column(
+    TFunction _function,
+    CSoAIndices<Columns...>
+  )
+{
+  // раскрытие пакета в инициализаторе массива задаёт порядок вызовов
+  const int expand[] = {(_function(std::get<Columns>(m_columns)), 0)...};
+  (void)expand;
+}
@@ -0,0 +1,470 @@
+#pragma once
+
+#include "CArray.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <utility>
+
+// Общая часть CFlatSet и CFlatMap: упорядоченный по ключу CArray без
+// повторяющихся ключей. Поиск - бинарный без ветвлений (выбор половины
+// компилируется в cmov), пакетная вставка дописывает пакет в конец, сортирует
+// его и сливает с прежним содержимым за один проход.
+
+struct CIdentityKey
+{
+  template <typename TValue>
+  const TValue& operator()(
+      const TValue& _value
+    ) const
+  {
+    return _value;
+  }
+};
+
+struct CPairFirstKey
+{
+  template <typename TPair>
+  const typename TPair::first_type& operator()(
+      const TPair& _value
+    ) const
+  {
+    return _value.first;
+  }
+};
+
+template <
+    typename TValue,
+    typename TKey,
+    typename TKeyOf,
+    typename TCompare,
+    typename TAllocator
+  >
+class CSortedArray
+{
+protected:
+  typedef CArray<TValue, TAllocator> Storage;
+
+public:
+  typedef TKey key_type;
+  typedef TValue value_type;
+  typedef TCompare key_compare;
+  typedef TAllocator allocator_type;
+  typedef std::size_t size_type;
+  typedef typename Storage::const_iterator const_iterator;
+  typedef typename Storage::const_reverse_iterator const_reverse_iterator;
+
+  const_iterator begin() const;
+  const_iterator end() const;
+
+  const_iterator cbegin() const;
+  const_iterator cend() const;
+
+  const_reverse_iterator rbegin() const;
+  const_reverse_iterator rend() const;
+
+public:
+  explicit CSortedArray(
+      const TCompare& _compare = TCompare(),
+      const TAllocator& _allocator = TAllocator()
+    );
+
+public:
+  template <typename TIterator>
+  void insert(
+      TIterator _first,
+      TIterator _last
+    );
+  void insert(
+      std::initializer_list<TValue> _values
+    );
+  std::size_t erase(
+      const TKey& _key
+    );
+  const_iterator erase(
+      const_iterator _position
+    );
+  void clear();
+  void reserve(
+      std::size_t _size
+    );
+  void shrink_to_fit();
+  std::size_t size() const;
+  bool empty() const;
+  const TValue* data() const;
+  const TValue& operator[](
+      std::size_t _index
+    ) const;
+
+  const_iterator find(
+      const TKey& _key
+    ) const;
+  std::size_t count(
+      const TKey& _key
+    ) const;
+  bool contains(
+      const TKey& _key
+    ) const;
+  const_iterator lower_bound(
+      const TKey& _key
+    ) const;
+  const_iterator upper_bound(
+      const TKey& _key
+    ) const;
+
+  key_compare key_comp() const;
+  allocator_type get_allocator() const;
+
+protected:
+  std::size_t lower_bound_index(
+      const TKey& _key
+    ) const;
+  std::size_t upper_bound_index(
+      const TKey& _key
+    ) const;
+  std::size_t find_index(
+      const TKey& _key
+    ) const;
+  template <typename TArgument>
+  std::pair<std::size_t, bool> insert_value(
+      TArgument&& _value
+    );
+  template <typename... TArgs>
+  std::pair<std::size_t, bool> emplace_value(
+      const TKey& _key,
+      TArgs&&... _args
+    );
+  bool less(
+      const TValue& _left,
+      const TValue& _right
+    ) const;
+
+protected:
+  Storage m_data;
+  TCompare m_compare;
+  TKeyOf m_keyOf;
+};
+
+
+// -----------------------------------------------------------------------------
+
+template<typename TValue, typename TKey, typename TKeyOf, typename TCompare, typename TAllocator>
+typename CSortedArray<TValue, TKey, TKeyOf, TCompare, TAllocator>::const_iterator
+CSortedArray<TValue, TKey, TKeyOf, TCompare, TAllocator>::begin() const
+{
+  return m_data.begin();
+}
+
+template<typename TValue, typename TKey, typename TKeyOf, typename TCompare, typename TAllocator>
+typename CSortedArray<TValue, TKey, TKeyOf, TCompare, TAllocator>::const_iterator
+CSortedArray<TValue, TKey, TKeyOf, TCompare, TAllocator>::end() const
+{
+  return m_data.end();
+}
+
+template<typename TValue, typename TKey, typename TKeyOf, typename TCompare, typename TAllocator>
+typename CSortedArray<TValue, TKey, TKeyOf, TCompare, TAllocator>::const_iterator
+CSortedArray<TValue, TKey, TKeyOf, TCompare, TAllocator>::cbegin() const
+{
+  return m_data.cbegin();
+}
+
+template<typename TValue, typename TKey, typename TKeyOf, typename TCompare, typename TAllocator>
+typename CSortedArray<TValue, TKey, TKeyOf, TCompare, TAllocator>::const_iterator
+CSortedArray<TValue, TKey, TKeyOf, TCompare, TAllocator>::cend() const
+{
+  return m_data.cend();
+}
+
+template<typename TValue, typename TKey, typename TKeyOf, typename TCompare, typename TAllocator>
+typename CSortedArray<TValue, TKey, TKeyOf, TCompare, TAllocator>::const_reverse_iterator
+CSortedArray<TValue, TKey, TKeyOf, TCompare, TAllocator>::rbegin() const
+{
+  return m_data.rbegin();
+}
+
+template<typename TValue, typename TKey, typename TKeyOf, typename TCompare, typename TAllocator>
+typename CSortedArray<TValue, TKey, TKeyOf, TCompare, TAllocator>::const_reverse_iterator
+CSortedArray<TValue, TKey, TKeyOf, TCompare, TAllocator>::rend() const
+{
+  return m_data.rend();
+}
+
+template<typename TValue, typename TKey, typename TKeyOf, typename TCompare, typename TAllocator>
+CSortedArray<TValue, TKey, TKeyOf, TCompare, TAllocator>::CSortedArray(
+    const TCompare& _compare,
+    const TAllocator& _allocator
+  )
+  : m_data(_allocator)
+  , m_compare(_compare)
+{}
+
+template<typename TValue, typename TKey, typename TKeyOf, typename TCompare, typename TAllocator>
+template<typename TIterator>
+void CSortedArray<TValue, TKey, TKeyOf, TCompare, TAllocator>::insert(
+    TIterator _first,
+    TIterator _last
+  )
+{
+  std::size_t oldSize = m_data.size();
+  m_data.append(_first, _last);
+
+  // пакет сортируется отдельно; при равных ключах остаётся первый, как в std::set
+  TValue* batchBegin = m_data.data() + oldSize;
+  TValue* batchEnd = m_data.data() + m_data.size();
+  auto valueLess = [this](const TValue& _left, const TValue& _right) {
+    return less(_left, _right);
+  };
+  std::stable_sort(batchBegin, batchEnd, valueLess);
+  batchEnd = std::unique(batchBegin, batchEnd, [&valueLess](const TValue& _left, const TValue& _right) {
+    return !valueLess(_left, _right);
+  });
+  m_data.erase(batchEnd - m_data.data(), m_data.size());
+
+  if (oldSize == 0 || oldSize == m_data.size()) return;
+  // пакет целиком после прежних элементов: сливать нечего
+  if (less(m_data[oldSize - 1], m_data[oldSize])) return;
+
+  Storage merged(m_data.get_allocator());
+  merged.reserve(m_data.size());
+  std::size_t left = 0;
+  std::size_t right = oldSize;
+  while (left < oldSize && right < m_data.size())
+  {
+    if (less(m_data[right], m_data[left])) merged.push_back(std::move(m_data[right++]));
+    else
+    {
+      // прежний элемент с тем же ключом имеет приоритет над новым
+      if (!less(m_data[left], m_data[right])) ++right;
+      merged.push_back(std::move(m_data[left++]));
+    }
+  }
+  merged.append(std::make_move_iterator(m_data.data() + left),
+                std::make_move_iterator(m_data.data() + oldSize));
+  merged.append(std::make_move_iterator(m_data.data() + right),
+                std::make_move_iterator(m_data.data() + m_data.size()));
+  m_data = std::move(merged);
+}
+
+template<typename TValue, typename TKey, typename TKeyOf, typename TCompare, typename TAllocator>
+void CSortedArray<TValue, TKey, TKeyOf, TCompare, TAllocator>::insert(
+    std::initializer_list<TValue> _values
+  )
+{
+  insert(_values.begin(), _values.end());
+}
+
+template<typename TValue, typename TKey, typename TKeyOf, typename TCompare, typename TAllocator>
+std::size_t CSortedArray<TValue, TKey, TKeyOf, TCompare, TAllocator>::erase(
+    const TKey& _key
+  )
+{
+  std::size_t index = find_index(_key);
+  if (index == m_data.size()) return 0;
+  m_data.erase(index);
+  return 1;
+}
+
+template<typename TValue, typename TKey, typename TKeyOf, typename TCompare, typename TAllocator>
+typename CSortedArray<TValue, TKey, TKeyOf, TCompare, TAllocator>::const_iterator
+CSortedArray<TValue, TKey, TKeyOf, TCompare, TAllocator>::erase(
+    const_iterator _position
+  )
+{
+  std::size_t index = _position - m_data.cbegin();
+  m_data.erase(index);
+  return m_data.cbegin() + index;
+}
+
+template<typename TValue, typename TKey, typename TKeyOf, typename TCompare, typename TAllocator>
+void CSortedArray<TValue, TKey, TKeyOf, TCompare, TAllocator>::clear()
+{
+  m_data.clear();
+}
+
+template<typename TValue, typename TKey, typename TKeyOf, typename TCompare, typename TAllocator>
+void CSortedArray<TValue, TKey, TKeyOf, TCompare, TAllocator>::reserve(
+    std::size_t _size
+  )
+{
+  m_data.reserve(_size);
+}
+
+template<typename TValue, typename TKey, typename TKeyOf, typename TCompare, typename TAllocator>
+void CSortedArray<TValue, TKey, TKeyOf, TCompare, TAllocator>::shrink_to_fit()
+{
+  m_data.shrink_to_fit();
+}
+
+template<typename TValue, typename TKey, typename TKeyOf, typename TCompare, typename TAllocator>
+std::size_t CSortedArray<TValue, TKey, TKeyOf, TCompare, TAllocator>::size() const
+{
+  return m_data.size();
+}
+
+template<typename TValue, typename TKey, typename TKeyOf, typename TCompare, typename TAllocator>
+bool CSortedArray<TValue, TKey, TKeyOf, TCompare, TAllocator>::empty() const
+{
+  return m_data.size() == 0;
+}
+
+template<typename TValue, typename TKey, typename TKeyOf, typename TCompare, typename TAllocator>
+const TValue* CSortedArray<TValue, TKey, TKeyOf, TCompare, TAllocator>::data() const
+{
+  return m_data.data();
+}
+
+template<typename TValue, typename TKey, typename TKeyOf, typename TCompare, typename TAllocator>
+const TValue& CSortedArray<TValue, TKey, TKeyOf, TCompare, TAllocator>::operator[](
+    std::size_t _index
+  ) const
+{
+  return m_data[_index];
+}
+
+template<typename TValue, typename TKey, typename TKeyOf, typename TCompare, typename TAllocator>
+typename CSortedArray<TValue, TKey, TKeyOf, TCompare, TAllocator>::const_iterator
+CSortedArray<TValue, TKey, TKeyOf, TCompare, TAllocator>::find(
+    const TKey& _key
+  ) const
+{
+  return m_data.cbegin() + find_index(_key);
+}
+
+template<typename TValue, typename TKey, typename TKeyOf, typename TCompare, typename TAllocator>
+std::size_t CSortedArray<TValue, TKey, TKeyOf, TCompare, TAllocator>::count(
+    const TKey& _key
+  ) const
+{
+  return find_index(_key) != m_data.size() ? 1 : 0;
+}
+
+template<typename TValue, typename TKey, typename TKeyOf, typename TCompare, typename TAllocator>
+bool CSortedArray<TValue, TKey, TKeyOf, TCompare, TAllocator>::contains(
+    const TKey& _key
+  ) const
+{
+  return find_index(_key) != m_data.size();
+}
+
+template<typename TValue, typename TKey, typename TKeyOf, typename TCompare, typename TAllocator>
+typename CSortedArray<TValue, TKey, TKeyOf, TCompare, TAllocator>::const_iterator
+CSortedArray<TValue, TKey, TKeyOf, TCompare, TAllocator>::lower_bound(
+    const TKey& _key
+  ) const
+{
+  return m_data.cbegin() + lower_bound_index(_key);
+}
+
+template<typename TValue, typename TKey, typename TKeyOf, typename TCompare, typename TAllocator>
+typename CSortedArray<TValue, TKey, TKeyOf, TCompare, TAllocator>::const_iterator
+CSortedArray<TValue, TKey, TKeyOf, TCompare, TAllocator>::upper_bound(
+    const TKey& _key
+  ) const
+{
+  return m_data.cbegin() + upper_bound_index(_key);
+}
+
+template<typename TValue, typename TKey, typename TKeyOf, typename TCompare, typename TAllocator>
+TCompare CSortedArray<TValue, TKey, TKeyOf, TCompare, TAllocator>::key_comp() const
+{
+  return m_compare;
+}
+
+template<typename TValue, typename TKey, typename TKeyOf, typename TCompare, typename TAllocator>
+TAllocator CSortedArray<TValue, TKey, TKeyOf, TCompare, TAllocator>::get_allocator() const
+{
+  return m_data.get_allocator();
+}
+
+template<typename TValue, typename TKey, typename TKeyOf, typename TCompare, typename TAllocator>
+std::size_t CSortedArray<TValue, TKey, TKeyOf, TCompare, TAllocator>::lower_bound_index(
+    const TKey& _key
+  ) const
+{
+  const TValue* first = m_data.data();
+  std::size_t length = m_data.size();
+  if (length == 0) return 0;
+
+  const TValue* base = first;
+  while (length > 1)
+  {
+    std::size_t half = length / 2;
+    base = m_compare(m_keyOf(base[half]), _key) ? base + half : base;
+    length -= half;
+  }
+  return (base - first) + (m_compare(m_keyOf(*base), _key) ? 1 : 0);
+}
+
+template<typename TValue, typename TKey, typename TKeyOf, typename TCompare, typename TAllocator>
+std::size_t CSortedArray<TValue, TKey, TKeyOf, TCompare, TAllocator>::upper_bound_index(
+    const TKey& _key
+  ) const
+{
+  const TValue* first = m_data.data();
+  std::size_t length = m_data.size();
+  if (length == 0) return 0;
+
+  const TValue* base = first;
+  while (length > 1)
+  {
+    std::size_t half = length / 2;
+    base = !m_compare(_key, m_keyOf(base[half])) ? base + half : base;
+    length -= half;
+  }
+  return (base - first) + (!m_compare(_key, m_keyOf(*base)) ? 1 : 0);
+}
+
+template<typename TValue, typename TKey, typename TKeyOf, typename TCompare, typename TAllocator>
+std::size_t CSortedArray<TValue, TKey, TKeyOf, TCompare, TAllocator>::find_index(
+    const TKey& _key
+  ) const
+{
+  std::size_t index = lower_bound_index(_key);
+  if (index == m_data.size() || m_compare(_key, m_keyOf(m_data[index]))) return m_data.size();
+  return index;
+}
+
+template<typename TValue, typename TKey, typename TKeyOf, typename TCompare, typename TAllocator>
+template<typename TArgument>
+std::pair<std::size_t, bool> CSortedArray<TValue, TKey, TKeyOf, TCompare, TAllocator>::insert_value(
+    TArgument&& _value
+  )
+{
+  std::size_t index = lower_bound_index(m_keyOf(_value));
+  if (index < m_data.size() && !m_compare(m_keyOf(_value), m_keyOf(m_data[index])))
+  {
+    return std::make_pair(index, false);
+  }
+  m_data.insert(index, std::forward<TArgument>(_value));
+  return std::make_pair(index, true);
+}
+
+template<typename TValue, typename TKey, typename TKeyOf, typename TCompare, typename TAllocator>
+template<typename... TArgs>
+std::pair<std::size_t, bool> CSortedArray<TValue, TKey, TKeyOf, TCompare, TAllocator>::emplace_value(
+    const TKey& _key,
+    TArgs&&... _args
+  )
+{
+  std::size_t index = lower_bound_index(_key);
+  if (index < m_data.size() && !m_compare(_key, m_keyOf(m_data[index])))
+  {
+    return std::make_pair(index, false);
+  }
+  m_data.emplace(index, std::forward<TArgs>(_args)...);
+  return std::make_pair(index, true);
+}
+
+template<typename TValue, typename TKey, typename TKeyOf, typename TCompare, typename TAllocator>
+bool CSortedArray<TValue, TKey, TKeyOf, TCompare, TAllocator>::less(
+    const TValue& _left,
+    const TValue& _right
+  ) const
+{
+  return m_compare(m_keyOf(_left), m_keyOf(_right));
+}
@@ -0,0 +1,529 @@
+#pragma once
+
+#include "CArray.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <assert.h>
+
+#if __cplusplus >= 201703L
+#include <string_view>
+#endif
+
+
+#if __cplusplus >= 201703L
+typedef std::string_view CStringView;
+#else
+// Замена std::string_view для сборок до C++17: только то, что нужно
+// для доступа к строкам CStringArray.
+class CStringView
+{
+public:
+  typedef const char* const_iterator;
+
+  CStringView()
+    : m_data(nullptr)
+    , m_size(0)
+  {}
+
+  CStringView(
+      const char* _data,
+      std::size_t _size
+    )
+    : m_data(_data)
+    , m_size(_size)
+  {}
+
+  CStringView(
+      const char* _string
+    )
+    : m_data(_string)
+    , m_size(std::strlen(_string))
+  {}
+
+  CStringView(
+      const std::string& _string
+    )
+    : m_data(_string.data())
+    , m_size(_string.size())
+  {}
+
+  explicit operator std::string() const
+  {
+    return std::string(m_data, m_size);
+  }
+
+  const char* data() const { return m_data; }
+  std::size_t size() const { return m_size; }
+  std::size_t length() const { return m_size; }
+  bool empty() const { return m_size == 0; }
+  const_iterator begin() const { return m_data; }
+  const_iterator end() const { return m_data + m_size; }
+
+  char operator[](
+      std::size_t _index
+    ) const
+  {
+    assert(_index < m_size);
+    return m_data[_index];
+  }
+
+  int compare(
+      CStringView _other
+    ) const
+  {
+    const int result = std::char_traits<char>::compare(m_data, _other.m_data, std::min(m_size, _other.m_size));
+    if (result) return result;
+    return m_size < _other.m_size ? -1 : (m_size > _other.m_size ? 1 : 0);
+  }
+
+  friend bool operator==(CStringView _left, CStringView _right) { return _left.compare(_right) == 0; }
+  friend bool operator!=(CStringView _left, CStringView _right) { return _left.compare(_right) != 0; }
+  friend bool operator<(CStringView _left, CStringView _right) { return _left.compare(_right) < 0; }
+  friend bool operator>(CStringView _left, CStringView _right) { return _left.compare(_right) > 0; }
+  friend bool operator<=(CStringView _left, CStringView _right) { return _left.compare(_right) <= 0; }
+  friend bool operator>=(CStringView _left, CStringView _right) { return _left.compare(_right) >= 0; }
+
+  friend std::ostream& operator<<(
+      std::ostream& _stream,
+      CStringView _view
+    )
+  {
+    return _stream.write(_view.m_data, std::streamsize(_view.m_size));
+  }
+
+private:
+  const char* m_data;
+  std::size_t m_size;
+};
+#endif
+
+
+// Итератор CStringArray: разыменование возвращает CStringView по значению.
+template <typename TArray>
+class CStringArrayIterator
+{
+public:
+  typedef std::random_access_iterator_tag iterator_category;
+  typedef CStringView value_type;
+  typedef std::ptrdiff_t difference_type;
+  typedef const CStringView* pointer;
+  typedef CStringView reference;
+
+  CStringArrayIterator()
+    : m_pos(0)
+    , m_array(nullptr)
+  {}
+
+  CStringArrayIterator(
+      const TArray* _array,
+      std::size_t _pos
+    )
+    : m_pos(_pos)
+    , m_array(_array)
+  {}
+
+public:
+  bool operator==(const CStringArrayIterator& _other) const { return m_pos == _other.m_pos; }
+  bool operator!=(const CStringArrayIterator& _other) const { return m_pos != _other.m_pos; }
+  bool operator<(const CStringArrayIterator& _other) const { return m_pos < _other.m_pos; }
+  bool operator>(const CStringArrayIterator& _other) const { return m_pos > _other.m_pos; }
+  bool operator<=(const CStringArrayIterator& _other) const { return m_pos <= _other.m_pos; }
+  bool operator>=(const CStringArrayIterator& _other) const { return m_pos >= _other.m_pos; }
+
+  CStringView operator*() const { return (*m_array)[m_pos]; }
+  CStringView operator[](difference_type _n) const { return (*m_array)[m_pos + _n]; }
+
+  CStringArrayIterator& operator++() { ++m_pos; return *this; }
+  CStringArrayIterator& operator--() { --m_pos; return *this; }
+  CStringArrayIterator operator++(int) { CStringArrayIterator it(*this); ++m_pos; return it; }
+  CStringArrayIterator operator--(int) { CStringArrayIterator it(*this); --m_pos; return it; }
+  CStringArrayIterator& operator+=(difference_type _n) { m_pos += _n; return *this; }
+  CStringArrayIterator& operator-=(difference_type _n) { m_pos -= _n; return *this; }
+  CStringArrayIterator operator+(difference_type _n) const { return CStringArrayIterator(m_array, m_pos + _n); }
+  CStringArrayIterator operator-(difference_type _n) const { return CStringArrayIterator(m_array, m_pos - _n); }
+
+  difference_type operator-(
+      const CStringArrayIterator& _other
+    ) const
+  {
+    return difference_type(m_pos) - difference_type(_other.m_pos);
+  }
+
+private:
+  std::size_t m_pos;
+  const TArray* m_array;
+};
+
+
+// Массив строк без отдельного объекта на каждую строку: символы всех строк
+// лежат подряд в одном буфере, а сам массив хранит для строки только
+// смещение и длину (8 байт вместо 32 у std::string плюс его блока в куче).
+// Вставка и удаление двигают только эти пары; символы удалённых строк
+// остаются в буфере, пока мусор не займёт больше половины, и тогда буфер
+// уплотняется за один проход. Буфер ограничен 4 ГиБ.
+//
+// Строки возвращаются как CStringView (std::string_view начиная с C++17),
+// которые действительны до следующего изменения массива.
+class CStringArray
+{
+public:
+  typedef CStringView value_type;
+  typedef std::size_t size_type;
+  typedef CStringArrayIterator<CStringArray> iterator;
+  typedef CStringArrayIterator<CStringArray> const_iterator;
+
+  const_iterator begin() const;
+  const_iterator end() const;
+  const_iterator cbegin() const;
+  const_iterator cend() const;
+
+public:
+  CStringArray();
+  CStringArray(
+      std::initializer_list<CStringView> _values
+    );
+
+public:
+  void push_back(
+      CStringView _value
+    );
+  void insert(
+      std::size_t _index,
+      CStringView _value
+    );
+  // заменяет строку; старые символы становятся мусором
+  void set(
+      std::size_t _index,
+      CStringView _value
+    );
+  void pop_back();
+  void erase(
+      std::size_t _index
+    );
+  void erase(
+      std::size_t _first,
+      std::size_t _last
+    );
+  template <typename TPredicate>
+  std::size_t erase_if(
+      TPredicate _predicate
+    );
+  void clear();
+
+  void swap(
+      CStringArray& _array
+    ) noexcept;
+  std::size_t size() const;
+  bool empty() const;
+  // место под _count строк общей длиной _chars
+  void reserve(
+      std::size_t _count,
+      std::size_t _chars
+    );
+  // занятый буфер символов, включая мусор
+  std::size_t chars_size() const;
+  std::size_t garbage_size() const;
+  // убирает мусор и раскладывает символы в порядке строк
+  void compact();
+
+  CStringView operator[](
+      std::size_t _index
+    ) const;
+
+  // Сортировка по возрастанию в порядке std::string: переставляются только
+  // пары смещение-длина. Первые 8 байт каждой строки заранее собираются
+  // в число, и сравнение доходит до буфера символов только при равных
+  // префиксах. После сортировки буфер уплотняется в новом порядке, чтобы
+  // последовательный обход снова шёл по памяти подряд.
+  void sort();
+
+private:
+  struct Entry
+  {
+    std::uint32_t offset;
+    std::uint32_t length;
+  };
+
+  struct SortKey
+  {
+    std::uint64_t prefix;
+    std::uint32_t offset;
+    std::uint32_t length;
+  };
+
+  Entry store_chars(
+      CStringView _value
+    );
+  void collect_garbage();
+  static std::uint64_t key_prefix(
+      const char* _data,
+      std::size_t _size
+    );
+
+private:
+  CArray<char> m_chars;
+  CArray<Entry> m_entries;
+  std::size_t m_garbage;
+};
+
+
+// -----------------------------------------------------------------------------
+
+inline CStringArray::const_iterator CStringArray::begin() const
+{
+  return const_iterator(this, 0);
+}
+
+inline CStringArray::const_iterator CStringArray::end() const
+{
+  return const_iterator(this, m_entries.size());
+}
+
+inline CStringArray::const_iterator CStringArray::cbegin() const
+{
+  return begin();
+}
+
+inline CStringArray::const_iterator CStringArray::cend() const
+{
+  return end();
+}
+
+inline CStringArray::CStringArray()
+  : m_garbage(0)
+{}
+
+inline CStringArray::CStringArray(
+    std::initializer_list<CStringView> _values
+  )
+  : m_garbage(0)
+{
+  for (CStringView value: _values) push_back(value);
+}
+
+inline void CStringArray::push_back(
+    CStringView _value
+  )
+{
+  const Entry entry = store_chars(_value);
+  m_entries.push_back(entry);
+}
+
+inline void CStringArray::insert(
+    std::size_t _index,
+    CStringView _value
+  )
+{
+  assert(_index <= m_entries.size());
+  const Entry entry = store_chars(_value);
+  m_entries.insert(_index, entry);
+}
+
+inline void CStringArray::set(
+    std::size_t _index,
+    CStringView _value
+  )
+{
+  assert(_index < m_entries.size());
+  const Entry entry = store_chars(_value);
+  m_garbage += m_entries[_index].length;
+  m_entries[_index] = entry;
+  collect_garbage();
+}
+
+inline void CStringArray::pop_back()
+{
+  erase(m_entries.size() - 1);
+}
+
+inline void CStringArray::erase(
+    std::size_t _index
+  )
+{
+  erase(_index, _index + 1);
+}
+
+inline void CStringArray::erase(
+    std::size_t _first,
+    std::size_t _last
+  )
+{
+  assert(_first <= _last && _last <= m_entries.size());
+  for (std::size_t i = _first; i < _last; ++i) m_garbage += m_entries[i].length;
+  m_entries.erase(_first, _last);
+  collect_garbage();
+}
+
+template<typename TPredicate>
+std::size_t CStringArray::erase_if(
+    TPredicate _predicate
+  )
+{
+  const std::size_t oldSize = m_entries.size();
+  const char* chars = m_chars.data();
+  std::size_t garbage = 0;
+  m_entries.erase_if([&](const Entry& _entry) {
+    if (!_predicate(CStringView(chars + _entry.offset, _entry.length))) return false;
+    garbage += _entry.length;
+    return true;
+  });
+  m_garbage += garbage;
+  collect_garbage();
+  return oldSize - m_entries.size();
+}
+
+inline void CStringArray::clear()
+{
+  m_entries.clear();
+  m_chars.clear();
+  m_garbage = 0;
+}
+
+inline void CStringArray::swap(
+    CStringArray& _array
+  ) noexcept
+{
+  m_chars.swap(_array.m_chars);
+  m_entries.swap(_array.m_entries);
+  std::swap(m_garbage, _array.m_garbage);
+}
+
+inline std::size_t CStringArray::size() const
+{
+  return m_entries.size();
+}
+
+inline bool CStringArray::empty() const
+{
+  return m_entries.size() == 0;
+}
+
+inline void CStringArray::reserve(
+    std::size_t _count,
+    std::size_t _chars
+  )
+{
+  m_entries.reserve(_count);
+  m_chars.reserve(m_chars.size() + _chars);
+}
+
+inline std::size_t CStringArray::chars_size() const
+{
+  return m_chars.size();
+}
+
+inline std::size_t CStringArray::garbage_size() const
+{
+  return m_garbage;
+}
+
+inline void CStringArray::compact()
+{
+  CArray<char> chars;
+  chars.reserve(m_chars.size() - m_garbage);
+  for (Entry& entry: m_entries)
+  {
+    const char* from = m_chars.data() + entry.offset;
+    entry.offset = std::uint32_t(chars.size());
+    chars.append(from, from + entry.length);
+  }
+  m_chars.swap(chars);
+  m_garbage = 0;
+}
+
+inline CStringView CStringArray::operator[](
+    std::size_t _index
+  ) const
+{
+  assert(_index < m_entries.size());
+  const Entry& entry = m_entries[_index];
+  return CStringView(m_chars.data() + entry.offset, entry.length);
+}
+
+inline void CStringArray::sort()
+{
+  const std::size_t count = m_entries.size();
+  if (count < 2) return;
+
+  CArray<SortKey> keys;
+  keys.reserve(count);
+  for (const Entry& entry: m_entries)
+  {
+    const SortKey key = {key_prefix(m_chars.data() + entry.offset, entry.length), entry.offset, entry.length};
+    keys.push_back(key);
+  }
+
+  const char* chars = m_chars.data();
+  std::sort(keys.begin(), keys.end(), [chars](const SortKey& _left, const SortKey& _right) {
+    if (_left.prefix != _right.prefix) return _left.prefix < _right.prefix;
+    // префиксы равны, значит, совпадают первые min(длина, 8) символов обеих
+    // строк; остаток сравнивается в буфере, а при общем начале короче - меньше
+    const std::size_t common = std::min(_left.length, _right.length);
+    if (common > 8)
+    {
+      const int result = std::memcmp(chars + _left.offset + 8, chars + _right.offset + 8, common - 8);
+      if (result) return result < 0;
+    }
+    return _left.length < _right.length;
+  });
+
+  for (std::size_t i = 0; i < count; ++i)
+  {
+    m_entries[i].offset = keys[i].offset;
+    m_entries[i].length = keys[i].length;
+  }
+  compact();
+}
+
+inline CStringArray::Entry CStringArray::store_chars(
+    CStringView _value
+  )
+{
+  const std::size_t offset = m_chars.size();
+  if (offset + _value.size() > std::numeric_limits<std::uint32_t>::max())
+  {
+    throw std::length_error("CStringArray character buffer exceeds 4 GiB");
+  }
+
+  // строка может указывать в наш же буфер, который сейчас переедет
+  const char* from = _value.data();
+  const bool inside = from >= m_chars.data() && from < m_chars.data() + offset;
+  const std::size_t insideOffset = inside ? std::size_t(from - m_chars.data()) : 0;
+  m_chars.resize(offset + _value.size());
+  if (inside) from = m_chars.data() + insideOffset;
+  if (_value.size()) std::memcpy(m_chars.data() + offset, from, _value.size());
+
+  const Entry entry = {std::uint32_t(offset), std::uint32_t(_value.size())};
+  return entry;
+}
+
+inline void CStringArray::collect_garbage()
+{
+  // порог в 4 КиБ не даёт уплотнять маленький массив после каждого удаления
+  if (m_garbage > 4096 && m_garbage * 2 > m_chars.size()) compact();
+}
+
+// Первые 8 байт строки как число с первым символом в старшем байте:
+// сравнение таких чисел совпадает с побайтовым сравнением без знака,
+// то есть с порядком std::string. Короткие строки дополняются нулями.
+inline std::uint64_t CStringArray::key_prefix(
+    const char* _data,
+    std::size_t _size
+  )
+{
+  std::uint64_t prefix = 0;
+  const std::size_t count = std::min(_size, std::size_t(8));
+  for (std::size_t i = 0; i < count; ++i)
+  {
+    prefix |= std::uint64_t(static_cast<unsigned char>(_data[i])) << (56 - 8 * i);
+  }
+  return prefix;
+}
@@ -0,0 +1,348 @@
+#pragma once
+
+#include "CArray.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+
+// Небольшой пул потоков с перехватом задач (work stealing). У каждого потока
+// своя очередь: свои задачи он берёт с конца (последняя порождённая ещё
+// горячая в кэше), чужие крадёт с начала (там самые крупные куски
+// рекурсивного разбиения). Поток, ожидающий группу задач, не спит, а
+// выполняет задачи пула, поэтому вложенный параллелизм не блокируется.
+class CThreadPool
+{
+public:
+  explicit CThreadPool(
+      std::size_t _threadCount
+    );
+  ~CThreadPool();
+
+  CThreadPool(const CThreadPool&) = delete;
+  CThreadPool& operator=(const CThreadPool&) = delete;
+
+  // Общий пул процесса: потоков на один меньше, чем ядер, - ожидающий
+  // поток работает сам.
+  static CThreadPool& global();
+
+  std::size_t thread_count() const;
+  // сколько потоков реально выполняет задачи вместе с ожидающим
+  std::size_t concurrency() const;
+
+  void submit(
+      std::function<void()> _task
+    );
+  // выполнить одну задачу из очередей, если она есть
+  bool run_pending_task();
+
+private:
+  struct Queue
+  {
+    std::mutex mutex;
+    std::deque<std::function<void()>> tasks;
+  };
+
+  void worker_loop(
+      std::size_t _index
+    );
+  bool pop_task(
+      std::size_t _index,
+      std::function<void()>& _task
+    );
+  // индекс очереди текущего потока, если он рабочий поток этого пула,
+  // иначе число очередей
+  std::size_t current_index() const;
+  static CThreadPool*& current_pool();
+  static std::size_t& current_thread_index();
+
+private:
+  CArray<std::unique_ptr<Queue>> m_queues;
+  CArray<std::thread> m_threads;
+  std::atomic<std::size_t> m_pending;
+  std::atomic<std::size_t> m_nextQueue;
+  std::mutex m_sleepMutex;
+  std::condition_variable m_wakeUp;
+  bool m_stop;
+};
+
+
+// Группа задач fork-join: run порождает задачу, wait дожидается всех,
+// помогая их выполнять, и пробрасывает первое исключение из задач. Когда
+// красть нечего, ожидающий спит до завершения группы или появления в ней
+// новой задачи.
+class CTaskGroup
+{
+public:
+  explicit CTaskGroup(
+      CThreadPool& _pool
+    );
+  // ждёт оставшиеся задачи, но их исключения уже не пробрасывает
+  ~CTaskGroup();
+
+  CTaskGroup(const CTaskGroup&) = delete;
+  CTaskGroup& operator=(const CTaskGroup&) = delete;
+
+  template <typename TFunction>
+  void run(
+      TFunction&& _function
+    );
+  void wait();
+
+private:
+  void finish_all();
+
+private:
+  CThreadPool& m_pool;
+  // счётчик и поколение меняются только под m_stateMutex: задача,
+  // обнулившая счётчик, будит ожидающего, не отпустив мьютекс, и группа не
+  // может быть разрушена между уменьшением счётчика и оповещением
+  std::mutex m_stateMutex;
+  std::condition_variable m_changed;
+  std::size_t m_pending;
+  std::size_t m_generation;
+  std::mutex m_exceptionMutex;
+  std::exception_ptr m_exception;
+};
+
+
+// -----------------------------------------------------------------------------
+
+inline CThreadPool::CThreadPool(
+    std::size_t _threadCount
+  )
+  : m_pending(0)
+  , m_nextQueue(0)
+  , m_stop(false)
+{
+  // очередь есть и у пула без потоков: её задачи выполнит ожидающий
+  const std::size_t queueCount = _threadCount ? _threadCount : 1;
+  m_queues.reserve(queueCount);
+  for (std::size_t i = 0; i < queueCount; ++i) m_queues.emplace_back(new Queue);
+
+  m_threads.reserve(_threadCount);
+  for (std::size_t i = 0; i < _threadCount; ++i)
+  {
+    m_threads.emplace_back(&CThreadPool::worker_loop, this, i);
+  }
+}
+
+inline CThreadPool::~CThreadPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_sleepMutex);
+    m_stop = true;
+  }
+  m_wakeUp.notify_all();
+  for (auto& thread: m_threads) thread.join();
+}
+
+inline CThreadPool& CThreadPool::global()
+{
+  static CThreadPool pool([] {
+    const std::size_t cores = std::thread::hardware_concurrency();
+    return cores > 1 ? cores - 1 : std::size_t(0);
+  }());
+  return pool;
+}
+
+inline std::size_t CThreadPool::thread_count() const
+{
+  return m_threads.size();
+}
+
+inline std::size_t CThreadPool::concurrency() const
+{
+  return m_threads.size() + 1;
+}
+
+inline void CThreadPool::submit(
+    std::function<void()> _task
+  )
+{
+  std::size_t index = current_index();
+  if (index == m_queues.size()) index = m_nextQueue.fetch_add(1, std::memory_order_relaxed) % m_queues.size();
+
+  // счётчик растёт раньше, чем задача видна в очереди, чтобы не уйти в минус
+  m_pending.fetch_add(1);
+  {
+    Queue& queue = *m_queues[index];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    queue.tasks.push_back(std::move(_task));
+  }
+
+  // пустой захват упорядочивает счётчик с проверкой условия у засыпающего
+  { std::lock_guard<std::mutex> lock(m_sleepMutex); }
+  m_wakeUp.notify_one();
+}
+
+inline bool CThreadPool::run_pending_task()
+{
+  std::function<void()> task;
+  if (!pop_task(current_index(), task)) return false;
+  task();
+  return true;
+}
+
+inline void CThreadPool::worker_loop(
+    std::size_t _index
+  )
+{
+  current_pool() = this;
+  current_thread_index() = _index;
+
+  std::function<void()> task;
+  for (;;)
+  {
+    if (pop_task(_index, task))
+    {
+      task();
+      task = nullptr;
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(m_sleepMutex);
+    m_wakeUp.wait(lock, [this] { return m_stop || m_pending.load() > 0; });
+    if (m_stop && m_pending.load() == 0) return;
+  }
+}
+
+inline bool CThreadPool::pop_task(
+    std::size_t _index,
+    std::function<void()>& _task
+  )
+{
+  if (m_pending.load() == 0) return false;
+
+  const std::size_t queueCount = m_queues.size();
+  if (_index < queueCount)
+  {
+    Queue& own = *m_queues[_index];
+    std::lock_guard<std::mutex> lock(own.mutex);
+    if (!own.tasks.empty())
+    {
+      _task = std::move(own.tasks.back());
+      own.tasks.pop_back();
+      m_pending.fetch_sub(1);
+      return true;
+    }
+  }
+
+  const std::size_t start = _index < queueCount ? _index + 1 : 0;
+  for (std::size_t i = 0; i < queueCount; ++i)
+  {
+    Queue& victim = *m_queues[(start + i) % queueCount];
+    std::lock_guard<std::mutex> lock(victim.mutex);
+    if (!victim.tasks.empty())
+    {
+      _task = std::move(victim.tasks.front());
+      victim.tasks.pop_front();
+      m_pending.fetch_sub(1);
+      return true;
+    }
+  }
+  return false;
+}
+
+inline std::size_t CThreadPool::current_index() const
+{
+  return current_pool() == this ? current_thread_index() : m_queues.size();
+}
+
+inline CThreadPool*& CThreadPool::current_pool()
+{
+  static thread_local CThreadPool* pool = nullptr;
+  return pool;
+}
+
+inline std::size_t& CThreadPool::current_thread_index()
+{
+  static thread_local std::size_t index = 0;
+  return index;
+}
+
+// -----------------------------------------------------------------------------
+
+inline CTaskGroup::CTaskGroup(
+    CThreadPool& _pool
+  )
+  : m_pool(_pool)
+  , m_pending(0)
+  , m_generation(0)
+{}
+
+inline CTaskGroup::~CTaskGroup()
+{
+  finish_all();
+}
+
+template<typename TFunction>
+void CTaskGroup::run(
+    TFunction&& _function
+  )
+{
+  {
+    std::lock_guard<std::mutex> lock(m_stateMutex);
+    ++m_pending;
+  }
+  typename std::decay<TFunction>::type function(std::forward<TFunction>(_function));
+  m_pool.submit([this, function]() mutable {
+    try
+    {
+      function();
+    }
+    catch (...)
+    {
+      std::lock_guard<std::mutex> lock(m_exceptionMutex);
+      if (!m_exception) m_exception = std::current_exception();
+    }
+    std::lock_guard<std::mutex> lock(m_stateMutex);
+    if (--m_pending == 0) m_changed.notify_all();
+  });
+
+  // задачу может породить задача этой же группы - спящий ожидающий должен
+  // проснуться и помочь её выполнить
+  {
+    std::lock_guard<std::mutex> lock(m_stateMutex);
+    ++m_generation;
+  }
+  m_changed.notify_all();
+}
+
+inline void CTaskGroup::wait()
+{
+  finish_all();
+
+  std::exception_ptr exception;
+  {
+    std::lock_guard<std::mutex> lock(m_exceptionMutex);
+    std::swap(exception, m_exception);
+  }
+  if (exception) std::rethrow_exception(exception);
+}
+
+inline void CTaskGroup::finish_all()
+{
+  // задачи группы могут лежать в любой очереди, поэтому ожидающий выполняет
+  // всё подряд; когда красть нечего, остаётся дождаться уже начатых
+  std::unique_lock<std::mutex> lock(m_stateMutex);
+  while (m_pending != 0)
+  {
+    const std::size_t generation = m_generation;
+    lock.unlock();
+    const bool ran = m_pool.run_pending_task();
+    lock.lock();
+    if (!ran)
+    {
+      m_changed.wait(lock, [this, generation] { return m_pending == 0 || m_generation != generation; });
+    }
+  }
+}
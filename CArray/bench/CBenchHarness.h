@@ -0,0 +1,87 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+
+// Результат замера: лучшее время на одну операцию среди повторов
+struct CBenchResult
+{
+  double nsPerOp;
+  std::size_t repetitions;
+};
+
+// Не даёт компилятору выбросить вычисление, результат которого не используется
+template <typename TData>
+inline void bench_escape(
+    const TData& _value
+  )
+{
+#if defined(__GNUC__)
+  asm volatile("" : : "g"(&_value) : "memory");
+#else
+  static const TData* volatile sink;
+  sink = &_value;
+#endif
+}
+
+// Возвращает системе освобождённую память кучи. Иначе следующий повтор
+// получает страницы, уже отображённые предыдущим, и лучший из повторов
+// меряет распределитель в прогретом состоянии, которое зависит от порядка
+// замеров, а не от контейнера.
+inline void bench_release_memory()
+{
+#if defined(__GLIBC__)
+  malloc_trim(0);
+#endif
+}
+
+// Повторяет замер, пока время внутри замеров не наберёт _minMeasuredMs или
+// общее время вместе с подготовкой не превысит _maxWallMs (но хотя бы один
+// раз). _setup готовит данные вне замера и возвращает их, _run выполняет
+// _operations операций над ними. Данные повтора разрушаются, а память
+// возвращается системе до подготовки следующего, так что повторы не
+// наследуют состояние распределителя друг от друга.
+template <typename TSetup, typename TRun>
+CBenchResult bench_run(
+    std::size_t _operations,
+    TSetup _setup,
+    TRun _run,
+    double _minMeasuredMs = 200.0,
+    double _maxWallMs = 2000.0
+  )
+{
+  typedef std::chrono::steady_clock clock;
+  typedef std::chrono::duration<double, std::milli> milliseconds;
+
+  const clock::time_point wallStart = clock::now();
+  double best = -1.0;
+  double measured = 0.0;
+  std::size_t repetitions = 0;
+  do
+  {
+    bench_release_memory();
+    double elapsed;
+    {
+      auto state = _setup();
+      const clock::time_point start = clock::now();
+      _run(state);
+      elapsed = milliseconds(clock::now() - start).count();
+      bench_escape(state);
+    }
+
+    measured += elapsed;
+    if (best < 0 || elapsed < best) best = elapsed;
+    ++repetitions;
+  }
+  while (measured < _minMeasuredMs && milliseconds(clock::now() - wallStart).count() < _maxWallMs);
+
+  CBenchResult result;
+  result.nsPerOp = best * 1e6 / double(_operations ? _operations : 1);
+  result.repetitions = repetitions;
+  return result;
+}
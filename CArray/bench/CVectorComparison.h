@@ -0,0 +1,432 @@
+#pragma once
+
+#include "CArray.h"
+#include "bench/CBenchHarness.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+// Крупная нетривиальная запись: строка в куче плюс полсотни байт чисел
+struct CBenchRecord
+{
+  int key;
+  std::string name;
+  double values[8];
+
+  bool operator<(
+      const CBenchRecord& _other
+    ) const
+  {
+    return key < _other.key;
+  }
+};
+
+// Одна строка результатов: случай, тип, размер и время CArray против std::vector
+struct CBenchRow
+{
+  const char* caseName;
+  const char* typeName;
+  std::size_t size;
+  std::size_t operations;
+  CBenchResult array;
+  CBenchResult vector;
+};
+
+
+// Сравнение CArray и std::vector на одинаковых данных: push_back, вставка в
+// начало, середину и конец, удаление из середины, проход, std::sort и
+// копирование для int, std::string и CBenchRecord на размерах 10..10^7.
+// Вставки и удаления в середине квадратичны, поэтому на больших размерах их
+// делается меньше: не больше 10^7 / n (и не больше 1000) на замер.
+class CVectorComparison
+{
+public:
+  // _maxSize ограничивает наибольший размер; для CBenchRecord он не больше
+  // 10^6, чтобы исходные данные и копия помещались в память
+  explicit CVectorComparison(
+      std::size_t _maxSize = 10000000
+    );
+
+  // _progress - печатать ли строки по мере получения (в stderr)
+  void run(
+      bool _progress
+    );
+  void print_table(
+      std::FILE* _stream
+    ) const;
+  void print_json(
+      std::FILE* _stream
+    ) const;
+
+private:
+  template <typename TData>
+  void run_type(
+      const char* _typeName,
+      std::size_t _maxSize,
+      bool _progress
+    );
+  template <typename TData>
+  void run_size(
+      const char* _typeName,
+      const std::vector<TData>& _values,
+      bool _progress
+    );
+  template <typename TData, typename TRunner>
+  void add_row(
+      const char* _caseName,
+      const char* _typeName,
+      std::size_t _size,
+      std::size_t _operations,
+      TRunner _runner,
+      bool _progress
+    );
+
+  static void print_row(
+      std::FILE* _stream,
+      const CBenchRow& _row
+    );
+
+private:
+  std::size_t m_maxSize;
+  CArray<CBenchRow> m_rows;
+};
+
+
+// -----------------------------------------------------------------------------
+
+inline std::uint64_t bench_random(
+    std::uint64_t& _state
+  )
+{
+  _state ^= _state << 13;
+  _state ^= _state >> 7;
+  _state ^= _state << 17;
+  return _state;
+}
+
+inline void bench_make_value(
+    std::uint64_t& _state,
+    int& _value
+  )
+{
+  _value = int(bench_random(_state) >> 33);
+}
+
+// длины 4..31: часть строк во внутреннем буфере, часть в куче
+inline void bench_make_value(
+    std::uint64_t& _state,
+    std::string& _value
+  )
+{
+  std::uint64_t random = bench_random(_state);
+  _value.resize(4 + random % 28);
+  for (char& c: _value)
+  {
+    random = random * 6364136223846793005ull + 1442695040888963407ull;
+    c = char('a' + (random >> 59) % 26);
+  }
+}
+
+inline void bench_make_value(
+    std::uint64_t& _state,
+    CBenchRecord& _value
+  )
+{
+  _value.key = int(bench_random(_state) >> 33);
+  _value.name = "record-" + std::to_string(_value.key) + "-payload";
+  for (int i = 0; i < 8; ++i) _value.values[i] = double(_value.key) * (i + 1);
+}
+
+inline long long bench_weight(
+    int _value
+  )
+{
+  return _value;
+}
+
+inline long long bench_weight(
+    const std::string& _value
+  )
+{
+  return _value.size() + _value[0];
+}
+
+inline long long bench_weight(
+    const CBenchRecord& _value
+  )
+{
+  return _value.key + (long long)_value.values[7];
+}
+
+// вставка и удаление по индексу в обоих контейнерах
+template <typename TData>
+void bench_insert(
+    CArray<TData>& _array,
+    std::size_t _index,
+    const TData& _value
+  )
+{
+  _array.insert(_index, _value);
+}
+
+template <typename TData>
+void bench_insert(
+    std::vector<TData>& _array,
+    std::size_t _index,
+    const TData& _value
+  )
+{
+  _array.insert(_array.begin() + _index, _value);
+}
+
+template <typename TData>
+void bench_erase(
+    CArray<TData>& _array,
+    std::size_t _index
+  )
+{
+  _array.erase(_index);
+}
+
+template <typename TData>
+void bench_erase(
+    std::vector<TData>& _array,
+    std::size_t _index
+  )
+{
+  _array.erase(_array.begin() + _index);
+}
+
+// Замеры одного контейнера над готовыми значениями. Подготовка (копия
+// исходного массива) идёт вне замера.
+template <typename TContainer>
+class CBenchCases
+{
+public:
+  typedef typename TContainer::value_type value_type;
+
+  explicit CBenchCases(
+      const std::vector<value_type>& _values
+    )
+    : m_values(_values)
+  {
+    for (const value_type& value: _values) m_base.push_back(value);
+  }
+
+  CBenchResult push_back() const
+  {
+    const std::vector<value_type>& values = m_values;
+    return bench_run(values.size(),
+                     [] { return TContainer(); },
+                     [&values](TContainer& _array) {
+                       for (const value_type& value: values) _array.push_back(value);
+                     });
+  }
+
+  // _position: 0 - начало, 1 - середина, 2 - конец
+  CBenchResult insert(
+      int _position,
+      std::size_t _count
+    ) const
+  {
+    const TContainer& base = m_base;
+    const std::vector<value_type>& values = m_values;
+    return bench_run(_count,
+                     [&base] { return TContainer(base); },
+                     [&values, _position, _count](TContainer& _array) {
+                       for (std::size_t i = 0; i < _count; ++i)
+                       {
+                         const std::size_t index = _position == 0 ? 0
+                                                 : _position == 1 ? _array.size() / 2
+                                                 : _array.size();
+                         bench_insert(_array, index, values[i % values.size()]);
+                       }
+                     });
+  }
+
+  CBenchResult erase(
+      std::size_t _count
+    ) const
+  {
+    const TContainer& base = m_base;
+    return bench_run(_count,
+                     [&base] { return TContainer(base); },
+                     [_count](TContainer& _array) {
+                       for (std::size_t i = 0; i < _count; ++i) bench_erase(_array, _array.size() / 2);
+                     });
+  }
+
+  CBenchResult iterate() const
+  {
+    const TContainer& base = m_base;
+    return bench_run(base.size(),
+                     [] { return 0ll; },
+                     [&base](long long& _sum) {
+                       for (const value_type& value: base) _sum += bench_weight(value);
+                     });
+  }
+
+  CBenchResult sort() const
+  {
+    const TContainer& base = m_base;
+    return bench_run(base.size(),
+                     [&base] { return TContainer(base); },
+                     [](TContainer& _array) { std::sort(_array.begin(), _array.end()); });
+  }
+
+  // копия разрушается вне замера, при подготовке следующего повтора
+  CBenchResult copy() const
+  {
+    const TContainer& base = m_base;
+    return bench_run(base.size(),
+                     [] { return std::unique_ptr<TContainer>(); },
+                     [&base](std::unique_ptr<TContainer>& _copy) { _copy.reset(new TContainer(base)); });
+  }
+
+private:
+  const std::vector<value_type>& m_values;
+  TContainer m_base;
+};
+
+inline CVectorComparison::CVectorComparison(
+    std::size_t _maxSize
+  )
+  : m_maxSize(_maxSize)
+{}
+
+inline void CVectorComparison::run(
+    bool _progress
+  )
+{
+  m_rows.clear();
+  run_type<int>("int", m_maxSize, _progress);
+  run_type<std::string>("string", m_maxSize, _progress);
+  run_type<CBenchRecord>("record", std::min<std::size_t>(m_maxSize, 1000000), _progress);
+}
+
+inline void CVectorComparison::print_table(
+    std::FILE* _stream
+  ) const
+{
+  std::fprintf(_stream, "%-14s %-8s %10s %14s %14s %8s\n",
+               "case", "type", "n", "CArray, ns/op", "vector, ns/op", "ratio");
+  for (const CBenchRow& row: m_rows) print_row(_stream, row);
+}
+
+inline void CVectorComparison::print_json(
+    std::FILE* _stream
+  ) const
+{
+  // ratio > 1 - CArray медленнее std::vector
+  std::fprintf(_stream, "{\n  \"benchmarks\": [");
+  for (std::size_t i = 0; i < m_rows.size(); ++i)
+  {
+    const CBenchRow& row = m_rows[i];
+    std::fprintf(_stream,
+                 "%s\n    {\"case\": \"%s\", \"type\": \"%s\", \"size\": %zu, \"operations\": %zu, "
+                 "\"carray_ns_per_op\": %.3f, \"vector_ns_per_op\": %.3f, \"ratio\": %.4f, "
+                 "\"carray_repetitions\": %zu, \"vector_repetitions\": %zu}",
+                 i ? "," : "",
+                 row.caseName, row.typeName, row.size, row.operations,
+                 row.array.nsPerOp, row.vector.nsPerOp, row.array.nsPerOp / row.vector.nsPerOp,
+                 row.array.repetitions, row.vector.repetitions);
+  }
+  std::fprintf(_stream, "\n  ]\n}\n");
+}
+
+template<typename TData>
+void CVectorComparison::run_type(
+    const char* _typeName,
+    std::size_t _maxSize,
+    bool _progress
+  )
+{
+  std::uint64_t state = 0x9E3779B97F4A7C15ull;
+  std::vector<TData> values;
+  for (std::size_t size = 10; size <= _maxSize; size *= 10)
+  {
+    // значения для меньших размеров - начало тех же данных
+    while (values.size() < size)
+    {
+      values.emplace_back();
+      bench_make_value(state, values.back());
+    }
+    run_size(_typeName, values, _progress);
+  }
+}
+
+template<typename TData>
+void CVectorComparison::run_size(
+    const char* _typeName,
+    const std::vector<TData>& _values,
+    bool _progress
+  )
+{
+  const std::size_t size = _values.size();
+  const std::size_t shifts = std::max<std::size_t>(1, std::min<std::size_t>(1000, 10000000 / size));
+
+  CBenchCases<CArray<TData>> array(_values);
+  CBenchCases<std::vector<TData>> vector(_values);
+
+  add_row<TData>("push_back", _typeName, size, size, [&](bool _array) {
+    return _array ? array.push_back() : vector.push_back();
+  }, _progress);
+  add_row<TData>("insert_front", _typeName, size, shifts, [&](bool _array) {
+    return _array ? array.insert(0, shifts) : vector.insert(0, shifts);
+  }, _progress);
+  add_row<TData>("insert_middle", _typeName, size, shifts, [&](bool _array) {
+    return _array ? array.insert(1, shifts) : vector.insert(1, shifts);
+  }, _progress);
+  add_row<TData>("insert_back", _typeName, size, shifts, [&](bool _array) {
+    return _array ? array.insert(2, shifts) : vector.insert(2, shifts);
+  }, _progress);
+  add_row<TData>("erase_middle", _typeName, size, std::min(shifts, size), [&](bool _array) {
+    return _array ? array.erase(std::min(shifts, size)) : vector.erase(std::min(shifts, size));
+  }, _progress);
+  add_row<TData>("iterate", _typeName, size, size, [&](bool _array) {
+    return _array ? array.iterate() : vector.iterate();
+  }, _progress);
+  add_row<TData>("sort", _typeName, size, size, [&](bool _array) {
+    return _array ? array.sort() : vector.sort();
+  }, _progress);
+  add_row<TData>("copy", _typeName, size, size, [&](bool _array) {
+    return _array ? array.copy() : vector.copy();
+  }, _progress);
+}
+
+template<typename TData, typename TRunner>
+void CVectorComparison::add_row(
+    const char* _caseName,
+    const char* _typeName,
+    std::size_t _size,
+    std::size_t _operations,
+    TRunner _runner,
+    bool _progress
+  )
+{
+  CBenchRow row;
+  row.caseName = _caseName;
+  row.typeName = _typeName;
+  row.size = _size;
+  row.operations = _operations;
+  row.array = _runner(true);
+  row.vector = _runner(false);
+  m_rows.push_back(row);
+  if (_progress) print_row(stderr, row);
+}
+
+inline void CVectorComparison::print_row(
+    std::FILE* _stream,
+    const CBenchRow& _row
+  )
+{
+  std::fprintf(_stream, "%-14s %-8s %10zu %14.2f %14.2f %7.2fx\n",
+               _row.caseName, _row.typeName, _row.size,
+               _row.array.nsPerOp, _row.vector.nsPerOp, _row.array.nsPerOp / _row.vector.nsPerOp);
+}
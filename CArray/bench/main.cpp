@@ -0,0 +1,144 @@
+#include "CArray.h"
+#include "CChunkedArray.h"
+#include "bench/CVectorComparison.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+
+namespace
+{
+  template <typename TFunction>
+  double measure_ms(
+      TFunction _function
+    )
+  {
+    auto start = std::chrono::steady_clock::now();
+    _function();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  }
+
+  // вставки в случайные позиции
+  template <typename TArray>
+  double random_inserts(
+      std::size_t _count
+    )
+  {
+    TArray array;
+    srand(1);
+    return measure_ms([&] {
+      for (std::size_t i = 0; i < _count; ++i) array.insert(rand() % (array.size() + 1), int(i));
+    });
+  }
+
+  // вставки у курсора, который понемногу смещается, как при редактировании текста
+  template <typename TArray>
+  double cursor_inserts(
+      std::size_t _count
+    )
+  {
+    TArray array;
+    srand(1);
+    return measure_ms([&] {
+      std::size_t cursor = 0;
+      for (std::size_t i = 0; i < _count; ++i)
+      {
+        array.insert(cursor, int(i));
+        cursor += rand() % 3;
+        if (cursor > array.size()) cursor = array.size() / 2;
+      }
+    });
+  }
+
+  template <typename TArray>
+  double push_backs(
+      std::size_t _count
+    )
+  {
+    TArray array;
+    return measure_ms([&] {
+      for (std::size_t i = 0; i < _count; ++i) array.push_back(int(i));
+    });
+  }
+
+  template <typename TArray>
+  double iteration(
+      std::size_t _count
+    )
+  {
+    TArray array;
+    for (std::size_t i = 0; i < _count; ++i) array.push_back(int(i));
+    volatile long long sink = 0;
+    double result = measure_ms([&] {
+      long long sum = 0;
+      for (const int& value: array) sum += value;
+      sink = sum;
+    });
+    (void)sink;
+    return result;
+  }
+
+  template <typename TScenario, typename TOtherScenario>
+  void report(
+      const char* _name,
+      std::size_t _count,
+      TScenario _array,
+      TOtherScenario _chunked
+    )
+  {
+    double arrayTime = _array(_count);
+    double chunkedTime = _chunked(_count);
+    printf("%-16s %10zu %12.2f %14.2f %9.2fx\n",
+           _name, _count, arrayTime, chunkedTime, arrayTime / chunkedTime);
+  }
+}
+
+// Без аргументов печатает таблицы; с --json - только сравнение с
+// std::vector в JSON (ход замеров - в stderr). --max-size ограничивает
+// наибольший размер массива.
+int main(
+    int argc,
+    char** argv
+  )
+{
+  bool json = false;
+  std::size_t maxSize = 10000000;
+  for (int i = 1; i < argc; ++i)
+  {
+    if (strcmp(argv[i], "--json") == 0) json = true;
+    else if (strcmp(argv[i], "--max-size") == 0 && i + 1 < argc) maxSize = strtoull(argv[++i], nullptr, 10);
+    else
+    {
+      fprintf(stderr, "usage: %s [--json] [--max-size N]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  CVectorComparison comparison(maxSize);
+  if (json)
+  {
+    comparison.run(true);
+    comparison.print_json(stdout);
+    return 0;
+  }
+
+  printf("%-16s %10s %12s %14s %10s\n", "scenario", "n", "CArray, ms", "CChunked, ms", "speedup");
+
+  for (std::size_t count: {1000, 10000, 100000, 300000})
+  {
+    report("random insert", count, random_inserts<CArray<int>>, random_inserts<CChunkedArray<int>>);
+    report("cursor insert", count, cursor_inserts<CArray<int>>, cursor_inserts<CChunkedArray<int>>);
+    report("push_back", count, push_backs<CArray<int>>, push_backs<CChunkedArray<int>>);
+    report("iteration", count, iteration<CArray<int>>, iteration<CChunkedArray<int>>);
+  }
+
+  printf("\n");
+  comparison.run(false);
+  comparison.print_table(stdout);
+
+  return 0;
+}
@@ -1,4 +1,6 @@
 #include "CArray.h"
+#include "CArraySimd.h"
+#include "CStringArray.h"
 
 #include <stdlib.h>
 #include <time.h>
@@ -26,7 +28,7 @@ int main(int argc, char** argv)
   for (const auto& value: intList) std::cout << value << " ";
 
   std::cout << std::endl << std::endl << "Sort" << std::endl;
-  std::sort(intList.begin(), intList.end());
+  carray_radix_sort(intList);
   for (const auto& value: intList) std::cout << value << " ";
 
   std::cout << std::endl << std::endl << "Erase" << std::endl;
@@ -46,37 +48,33 @@ int main(int argc, char** argv)
   std::cout << std::endl << std::endl;
 
 
-  CArray<std::string> stringList;
+  CStringArray stringList;
 
   std::cout << "Push back" << std::endl;
   for (int i = 0; i < 15; ++i) stringList.push_back(generateWord());
-  for (const auto& value: stringList) std::cout << value.c_str() << " ";
+  for (const auto& value: stringList) std::cout << value << " ";
 
   std::cout << std::endl << std::endl << "Sort" << std::endl;
-  std::sort(stringList.begin(), stringList.end());
-  for (const auto& value: stringList) std::cout << value.c_str() << " ";
+  stringList.sort();
+  for (const auto& value: stringList) std::cout << value << " ";
 
   std::string markers("abcde");
   std::cout << std::endl << std::endl << "Erase" << std::endl;
-  for (int i = 0; i < stringList.size(); ++i)
-  {
-    for (char ch: stringList[i])
-    {
-      if (markers.find(ch) != std::string::npos)
-      {
-        stringList.erase(i);
-        --i;
-        break;
-      }
-    }
-  }
-  for (const auto& value: stringList) std::cout << value.c_str() << " ";
+  stringList.erase_if([&markers](CStringView _value) {
+    return std::find_first_of(_value.begin(), _value.end(), markers.begin(), markers.end()) != _value.end();
+  });
+  for (const auto& value: stringList) std::cout << value << " ";
 
   std::cout << std::endl << std::endl << "Insert" << std::endl;
   for (int i = 0; i < 3; ++i) {
     stringList.insert(rand() % (stringList.size() + 1), generateWord());
   }
-  for (const auto& value: stringList) std::cout << value.c_str() << " ";
+  for (const auto& value: stringList) std::cout << value << " ";
+
+#ifdef CARRAY_STATISTICS
+  std::cout << std::endl << std::endl;
+  CArrayStatsRegistry::instance().report(std::cout);
+#endif
 
   return 0;
 }
@@ -3,45 +3,52 @@
 #include <netdb.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/epoll.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <unistd.h>
 #include <errno.h>
+#include <algorithm>
 #include <cstring>
 
+#include <QByteArray>
 #include <QDebug>
+#include <QMetaObject>
 
 
 namespace {
-    struct PDUHeader {
-        quint32 command_length;
-        quint32 command_id;
-        quint32 command_status;
-        quint32 sequence_number;
-    };
+    const std::chrono::milliseconds CONNECT_TIMEOUT(10000);
+    const std::chrono::milliseconds RESPONSE_TIMEOUT(10000);
+    const std::size_t OUTPUT_BUFFER_CAPACITY = 64 * 1024;
+    // сколько раз сообщение, отклонённое по перегрузке SMSC, отправляется заново
+    const std::uint32_t MAX_THROTTLE_RETRIES = 3;
 
-    QByteArray createBindTransceiverPDU(quint32 sequenceNumber,
-                                        const QString& systemId,
-                                        const QString& password,
-                                        const QString& systemType,
-                                        quint8 interfaceVersion)
+    bool isThrottling(std::uint32_t commandStatus)
     {
-        QByteArray result;
-
-        PDUHeader header {0, htonl(0x00000009), 0, htonl(sequenceNumber)};
-        result.append(systemId.toLatin1(), systemId.size())
-              .append('\0')
-              .append(password.toLatin1(), password.size())
-              .append('\0')
-              .append(systemType.toLatin1(), systemType.size())
-              .append('\0')
-              .append(interfaceVersion)
-              .append(char(0))
-              .append(char(0))
-              .append('\0');
-        header.command_length = htonl(sizeof(header) + result.size());
-        result.insert(0, reinterpret_cast<char*>(&header), sizeof(header));
+        return commandStatus == PDUCodec::ESME_RTHROTTLED || commandStatus == PDUCodec::ESME_RMSGQFUL;
+    }
+
+    // с такими учётными данными повторный bind тоже получит отказ
+    bool isPermanentBindError(std::uint32_t commandStatus)
+    {
+        return commandStatus == PDUCodec::ESME_RINVPASWD || commandStatus == PDUCodec::ESME_RINVSYSID;
+    }
 
+    SubmitSM toSubmitSM(const OutboundMessage& message)
+    {
+        SubmitSM result;
+        result.serviceType = ByteView(message.serviceType.data(), message.serviceType.size());
+        result.sourceAddrTon = message.sourceAddrTon;
+        result.sourceAddrNpi = message.sourceAddrNpi;
+        result.sourceAddr = ByteView(message.sourceAddr.data(), message.sourceAddr.size());
+        result.destAddrTon = message.destAddrTon;
+        result.destAddrNpi = message.destAddrNpi;
+        result.destinationAddr = ByteView(message.destinationAddr.data(), message.destinationAddr.size());
+        result.esmClass = message.esmClass;
+        result.registeredDelivery = message.registeredDelivery;
+        result.dataCoding = message.dataCoding;
+        result.shortMessage = ByteView(message.shortMessage.data(), message.shortMessage.size());
+        result.tlvs = TLVList(ByteView(message.tlvs.data(), message.tlvs.size()));
         return result;
     }
 
@@ -65,95 +72,571 @@ namespace {
 }
 
 
-ESMETransceiver::ESMETransceiver(const QString& hostname,
-                                 quint16 port,
-                                 const QString& login,
-                                 const QString& password,
-                                 const QString& systemType,
-                                 quint8 smmpVersion,
+ESMETransceiver::ESMETransceiver(Reactor& reactor,
+                                 const SessionConfig& config,
+                                 std::shared_ptr<RateLimiter> poolLimiter,
                                  QObject* parent)
     : QObject(parent)
+    , m_reactor(reactor)
+    , m_address {}
     , m_socket(-1)
-    , m_hostname(hostname)
-    , m_port(port)
-    , m_login(login)
-    , m_password(password)
-    , m_systemType(systemType)
-    , m_smmpVersion(smmpVersion)
+    , m_connectId(0)
+    , m_responseTimer(0)
+    , m_responseSequence(0)
+    , m_expiryTimer(0)
+    , m_rateTimer(0)
+    , m_enquireLinkTimer(0)
+    , m_reconnectTimer(0)
+    , m_state(State::Closed)
+    , m_unbindRequested(false)
+    , m_finished(false)
+    , m_enquireLinkPending(false)
+    , m_reconnectAttempts(0)
+    , m_random(std::random_device()())
+    , m_output(OUTPUT_BUFFER_CAPACITY)
+    , m_reader(config.maxPDULength)
+    , m_window(config.window)
+    , m_limiter(config.rate)
+    , m_poolLimiter(std::move(poolLimiter))
+    , m_windowLimit(config.window.size)
+    , m_accepted(0)
+    , m_producersBlocked(false)
+    , m_config(config)
 {
-    if (initSocket()) {
-        m_transmitterThread = std::thread(&ESMETransceiver::transmitBindPDU, this);
-        m_receiverThread = std::thread(&ESMETransceiver::waitForBindPDUResponse, this);
+    // имя разрешается здесь, а не в цикле: gethostbyname блокирует и не
+    // потокобезопасен, а один поток цикла обслуживает много сессий. Адрес
+    // запоминается, переподключение обходится без DNS.
+    m_address.sin_family = AF_INET;
+    m_address.sin_port = htons(m_config.port);
+    if (hostnameToIp(m_config.hostname.toLatin1(), &m_address.sin_addr)) {
+        m_reactor.post([this] { connectToServer(m_address); });
     }
-    else emit close();
+    else m_reactor.post([this] { finish(); });
 }
 
 ESMETransceiver::~ESMETransceiver()
 {
-    if (m_receiverThread.joinable()) m_receiverThread.join();
-    if (m_transmitterThread.joinable()) m_transmitterThread.join();
-    if (m_socket != -1) {
-        shutdown(m_socket, SHUT_RDWR);
-        ::close(m_socket);
-        m_socket = -1;
+    // задачи цикла выполняются по порядку, поэтому после этого вызова ни один
+    // обработчик сессии уже не сработает
+    m_reactor.invoke([this] {
+        m_finished = true;
+        closeConnection();
+        abortSubmissions();
+    });
+}
+
+bool ESMETransceiver::submit(OutboundMessage message, SubmitCallback callback)
+{
+    return trySubmit(message, callback);
+}
+
+bool ESMETransceiver::trySubmit(OutboundMessage& message, SubmitCallback& callback)
+{
+    if (m_unbindRequested) return false;
+
+    // место занимается до постановки задачи, так что очередь не растёт
+    // сверх окна и queueLimit, как бы быстро ни писали производители
+    const SubmitWindow::Settings& settings = m_window.settings();
+    if (m_accepted.fetch_add(1) >= settings.size + settings.queueLimit) {
+        m_accepted.fetch_sub(1);
+        m_producersBlocked.store(true);
+        return false;
     }
+
+    m_reactor.post([this, submission = Submission {std::move(message), std::move(callback)}]() mutable {
+        if (m_finished) {
+            completeSubmission(std::move(submission), SubmitResult {SubmitResult::Aborted, 0, std::string()});
+            return;
+        }
+        m_pending.push_back(std::move(submission));
+        pumpSubmissions();
+    });
+    return true;
 }
 
-bool ESMETransceiver::initSocket()
+void ESMETransceiver::setOrphanHandler(OrphanHandler handler)
 {
-    bool result = false;
+    m_reactor.invoke([this, &handler] { m_orphanHandler = std::move(handler); });
+}
 
-    m_socket = socket(AF_INET, SOCK_STREAM, 0);
-    if (m_socket != -1) {
-        sockaddr_in serverAddr;
-        serverAddr.sin_family  = AF_INET;
-        serverAddr.sin_port = htons(m_port);
-        if (hostnameToIp(m_hostname.toLatin1(), (in_addr*)&serverAddr.sin_addr.s_addr)) {
-            qInfo() << tr("Connecting to %1").arg(inet_ntoa(*(in_addr*)&serverAddr.sin_addr.s_addr));
-            result = (::connect(m_socket, (sockaddr*) &serverAddr, sizeof(serverAddr)) == 0);
-            if (!result) {
-                qWarning() << tr("It's impossible to connect to the server %1:%2 (%3)")
-                              .arg(m_hostname, QString::number(m_port), tr(std::strerror(errno)));
-            }
-            else qInfo() << tr("Connected");
+void ESMETransceiver::unbind()
+{
+    m_unbindRequested = true;
+    m_reactor.post([this] {
+        if (m_finished) return;
+        if (m_state != State::BoundTrx) {
+            // bind ещё нет, отправленных сообщений тоже
+            finish();
+            return;
+        }
+        m_state = State::Unbinding;
+        pumpSubmissions();
+    });
+}
+
+void ESMETransceiver::connectToServer(const sockaddr_in& address)
+{
+    qInfo() << tr("Connecting to %1").arg(inet_ntoa(address.sin_addr));
+    m_connectId = m_reactor.connectAsync(address, CONNECT_TIMEOUT, [this](int socket, int error) {
+        m_connectId = 0;
+        if (socket == -1) {
+            qWarning() << tr("It's impossible to connect to the server %1:%2 (%3)")
+                          .arg(m_config.hostname, QString::number(m_config.port), tr(std::strerror(error)));
+            dropConnection();
         }
+        else onConnected(socket);
+    });
+}
+
+void ESMETransceiver::onConnected(int socket)
+{
+    qInfo() << tr("Connected");
+    m_socket = socket;
+    m_state = State::Open;
+    // EPOLLOUT остаётся в маске всё время: при edge-triggered он приходит
+    // только когда в буфере сокета снова появляется место
+    if (!m_reactor.watch(m_socket, EPOLLIN | EPOLLOUT | EPOLLRDHUP,
+                         [this](std::uint32_t events) { onSocketEvent(events); })) {
+        qWarning() << tr("It's impossible to watch socket (%1)").arg(tr(std::strerror(errno)));
+        dropConnection();
+        return;
+    }
+
+    const QByteArray login = m_config.login.toLatin1();
+    const QByteArray password = m_config.password.toLatin1();
+    const QByteArray systemType = m_config.systemType.toLatin1();
+    BindTransceiver bind;
+    bind.systemId = ByteView(login.constData(), login.size());
+    bind.password = ByteView(password.constData(), password.size());
+    bind.systemType = ByteView(systemType.constData(), systemType.size());
+    bind.interfaceVersion = m_config.smmpVersion;
+
+    // номер из общего ряда окна: 0 - недопустимый номер запроса
+    m_responseSequence = m_window.takeSequenceNumber();
+    PDUWriter writer(m_output.writePointer(), m_output.writable());
+    if (!queuePDU(writer, PDUCodec::encode(writer, bind, m_responseSequence))) {
+        // поле bind длиннее допустимого, повтор не поможет
+        finish();
+        return;
+    }
+    m_responseTimer = m_reactor.startTimer(RESPONSE_TIMEOUT, [this] {
+        m_responseTimer = 0;
+        qWarning() << tr("No response to bind in %1 ms").arg(qint64(RESPONSE_TIMEOUT.count()));
+        dropConnection();
+    });
+    flushOutput();
+}
+
+void ESMETransceiver::onBound()
+{
+    m_state = State::BoundTrx;
+    m_reconnectAttempts = 0;
+    m_lastReceived = SubmitWindow::Clock::now();
+    if (m_config.enquireLinkInterval.count() > 0) {
+        m_enquireLinkTimer = m_reactor.startTimer(m_config.enquireLinkInterval,
+                                                  [this] { onEnquireLinkTimer(); },
+                                                  m_config.enquireLinkInterval);
+    }
+    pumpSubmissions();
+}
+
+void ESMETransceiver::onSocketEvent(std::uint32_t events)
+{
+    if (events & EPOLLOUT) {
+        if (!flushOutput()) return;
+        // место в выходном кольце освободилось
+        pumpSubmissions();
+        if (m_socket == -1) return;
+    }
+    if (events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) readAvailable();
+}
+
+bool ESMETransceiver::queuePDU(const PDUWriter& writer, std::size_t length)
+{
+    if (length == 0) {
+        if (writer.isInvalid()) qWarning() << tr("PDU field exceeds its maximum length");
+        else qWarning() << tr("Output buffer is full");
+        return false;
     }
-    else qWarning() << tr("It's impossible to create socket");
+    m_output.commit(length);
+    return true;
+}
 
-    return result;
+bool ESMETransceiver::queueHeader(std::uint32_t commandId, std::uint32_t commandStatus, std::uint32_t sequenceNumber)
+{
+    PDUWriter writer(m_output.writePointer(), m_output.writable());
+    return queuePDU(writer, PDUCodec::encodeHeader(writer, commandId, commandStatus, sequenceNumber));
 }
 
-void ESMETransceiver::transmitBindPDU()
+bool ESMETransceiver::flushOutput()
 {
-    QByteArray pdu = createBindTransceiverPDU(0,
-                                              m_login,
-                                              m_password,
-                                              m_systemType,
-                                              m_smmpVersion);
-    // т.к. операции с сокетом блокирующие, то программа никогда не завершится,
-    // если здесь произойдёт ошибка
-    if (send(m_socket, pdu.data(), pdu.size(), MSG_NOSIGNAL) != pdu.size()) {
-        qWarning() << tr("Transmission error");
+    // кольцо отображено дважды, так что всё занятое лежит одним куском
+    while (m_output.readable() > 0) {
+        ssize_t sent = send(m_socket, m_output.readPointer(), m_output.readable(), MSG_NOSIGNAL);
+        if (sent > 0) m_output.consume(std::size_t(sent));
+        else if (errno == EAGAIN || errno == EWOULDBLOCK) return true;
+        else if (errno != EINTR) {
+            qWarning() << tr("Transmission error (%1)").arg(tr(std::strerror(errno)));
+            dropConnection();
+            return false;
+        }
     }
+    return true;
 }
 
-void ESMETransceiver::waitForBindPDUResponse()
+void ESMETransceiver::pumpSubmissions()
 {
-    PDUHeader header;
-    if (recv(m_socket, (char*)&header, sizeof(PDUHeader), MSG_NOSIGNAL) == sizeof(PDUHeader)) {
-        if (ntohl(header.sequence_number) == 0) handleCommandStatus(ntohl(header.command_status));
-        else {
-            qWarning() << tr("Unexpected sequence number: %1")
-                          .arg(QString::number(ntohl(header.sequence_number)));
+    if (m_state == State::Unbinding) {
+        // новое не отправляется; unbind - когда на всё отправленное придут ответы
+        if (m_window.isEmpty() && !m_responseTimer) sendUnbind();
+        return;
+    }
+    if (m_state != State::BoundTrx) return;
+
+    const SubmitWindow::Clock::time_point now = SubmitWindow::Clock::now();
+    while (!m_pending.empty() && !m_window.isFull() && m_window.outstanding() < m_windowLimit.value()) {
+        const std::uint32_t sequenceNumber = m_window.nextSequenceNumber();
+        PDUWriter writer(m_output.writePointer(), m_output.writable());
+        const std::size_t length = PDUCodec::encode(writer, toSubmitSM(m_pending.front().message), sequenceNumber);
+        // переполнение при пустом кольце не пройдёт никогда
+        if (length == 0 && writer.isOverflowed() && m_output.readable() > 0) break;
+        // токен нужен только тому, что действительно уйдёт в сокет
+        if (length != 0 && !acquireToken(now)) break;
+
+        Submission submission = std::move(m_pending.front());
+        m_pending.pop_front();
+        if (length == 0) {
+            completeSubmission(std::move(submission), SubmitResult {SubmitResult::Invalid, 0, std::string()});
+            continue;
         }
+        m_output.commit(length);
+        m_window.open(sequenceNumber, std::move(submission), now);
+    }
+
+    armExpiryTimer();
+    flushOutput();
+}
+
+void ESMETransceiver::completeSubmission(Submission&& submission, const SubmitResult& result)
+{
+    if (submission.callback) submission.callback(result);
+    releaseSubmission();
+}
+
+void ESMETransceiver::releaseSubmission()
+{
+    m_accepted.fetch_sub(1);
+    if (m_producersBlocked.exchange(false)) QMetaObject::invokeMethod(this, "readyToSubmit", Qt::QueuedConnection);
+}
+
+void ESMETransceiver::armExpiryTimer()
+{
+    if (m_expiryTimer || m_window.isEmpty()) return;
+
+    const auto delay = m_window.nextDeadline() - SubmitWindow::Clock::now();
+    m_expiryTimer = m_reactor.startTimer(std::chrono::duration_cast<std::chrono::milliseconds>(delay), [this] {
+        m_expiryTimer = 0;
+        m_window.expire(SubmitWindow::Clock::now(), [this](Submission&& submission) {
+            completeSubmission(std::move(submission), SubmitResult {SubmitResult::TimedOut, 0, std::string()});
+        });
+        armExpiryTimer();
+        pumpSubmissions();
+    });
+}
+
+void ESMETransceiver::armRateTimer(RateLimiter::Clock::duration wait)
+{
+    if (m_rateTimer) return;
+
+    // с запасом в миллисекунду, чтобы к сроку токен уже накопился
+    const auto delay = std::chrono::duration_cast<std::chrono::milliseconds>(wait) + std::chrono::milliseconds(1);
+    m_rateTimer = m_reactor.startTimer(delay, [this] {
+        m_rateTimer = 0;
+        pumpSubmissions();
+    });
+}
+
+bool ESMETransceiver::acquireToken(RateLimiter::Clock::time_point now)
+{
+    RateLimiter::Clock::duration wait = m_limiter.acquire(now);
+    if (wait == RateLimiter::Clock::duration::zero() && m_poolLimiter) {
+        wait = m_poolLimiter->acquire(now);
+        if (wait != RateLimiter::Clock::duration::zero()) m_limiter.refund();
     }
-    else qWarning() << tr("It's impossible to read message header");
+    if (wait == RateLimiter::Clock::duration::zero()) return true;
 
-    emit close();
+    armRateTimer(wait);
+    return false;
+}
+
+void ESMETransceiver::onThrottled()
+{
+    const RateLimiter::Clock::time_point now = RateLimiter::Clock::now();
+    m_limiter.onThrottled(now);
+    if (m_poolLimiter) m_poolLimiter->onThrottled(now);
+    m_windowLimit.onThrottled(now);
+}
+
+void ESMETransceiver::onAccepted()
+{
+    m_limiter.onAccepted();
+    if (m_poolLimiter) m_poolLimiter->onAccepted();
+    m_windowLimit.onAccepted();
+}
+
+void ESMETransceiver::parkSubmissions()
+{
+    // окно в порядке отправки, за ним очередь: после bind всё уйдёт в том же
+    // порядке, что и до обрыва
+    std::deque<Submission> parked;
+    m_window.drain([&parked](Submission&& submission) { parked.push_back(std::move(submission)); });
+    for (Submission& submission: m_pending) parked.push_back(std::move(submission));
+    m_pending.swap(parked);
+}
+
+void ESMETransceiver::abortSubmissions()
+{
+    // сначала окно, потом очередь: так сохраняется порядок отправки
+    auto abort = [this](Submission&& submission) {
+        if (m_orphanHandler) {
+            releaseSubmission();
+            m_orphanHandler(std::move(submission));
+        }
+        else completeSubmission(std::move(submission), SubmitResult {SubmitResult::Aborted, 0, std::string()});
+    };
+    m_window.drain(abort);
+    std::deque<Submission> pending;
+    pending.swap(m_pending);
+    for (Submission& submission: pending) abort(std::move(submission));
+}
+
+void ESMETransceiver::onEnquireLinkTimer()
+{
+    if (m_enquireLinkPending) {
+        // за целый интервал SMSC не ответил, соединение мёртвое
+        qWarning() << tr("No response to enquire_link in %1 ms").arg(qint64(m_config.enquireLinkInterval.count()));
+        dropConnection();
+        return;
+    }
+    // пока идут PDU, соединение и так проверено
+    if (SubmitWindow::Clock::now() - m_lastReceived < m_config.enquireLinkInterval) return;
+
+    if (queueHeader(PDUCodec::ENQUIRE_LINK, PDUCodec::ESME_ROK, m_window.takeSequenceNumber())) {
+        m_enquireLinkPending = true;
+        flushOutput();
+    }
+}
+
+void ESMETransceiver::sendUnbind()
+{
+    m_responseSequence = m_window.takeSequenceNumber();
+    if (!queueHeader(PDUCodec::UNBIND, PDUCodec::ESME_ROK, m_responseSequence)) {
+        finish();
+        return;
+    }
+    m_responseTimer = m_reactor.startTimer(RESPONSE_TIMEOUT, [this] {
+        m_responseTimer = 0;
+        qWarning() << tr("No response to unbind in %1 ms").arg(qint64(RESPONSE_TIMEOUT.count()));
+        finish();
+    });
+    flushOutput();
+}
+
+void ESMETransceiver::readAvailable()
+{
+    // при edge-triggered читать надо до конца, иначе событие больше не придёт;
+    // если кольцо заполнилось, PDU разбираются и чтение продолжается
+    for (;;) {
+        const PDUReader::ReadStatus status = m_reader.readFrom(m_socket);
+        const int error = errno;
+
+        // ответ, пришедший вместе с закрытием соединения, всё равно разбирается
+        PDUView pdu;
+        while (m_socket != -1 && m_reader.next(pdu)) handlePDU(pdu);
+        if (m_socket == -1) return;
+        // ответы на запросы SMSC из этой порции уходят одним send
+        if (!flushOutput()) return;
+
+        if (m_reader.isCorrupted()) {
+            qWarning() << tr("Invalid command length: %1 (maximum %2)")
+                          .arg(QString::number(m_reader.invalidLength()),
+                               QString::number(m_reader.maxPDULength()));
+            dropConnection();
+            return;
+        }
+
+        switch (status) {
+        case PDUReader::ReadStatus::Drained:
+            return;
+        case PDUReader::ReadStatus::BufferFull:
+            break;
+        case PDUReader::ReadStatus::Closed:
+            qWarning() << tr("Connection closed by the server");
+            dropConnection();
+            return;
+        case PDUReader::ReadStatus::Error:
+            qWarning() << tr("Receive error (%1)").arg(tr(std::strerror(error)));
+            dropConnection();
+            return;
+        }
+    }
+}
+
+void ESMETransceiver::handlePDU(const PDUView& pdu)
+{
+    m_lastReceived = SubmitWindow::Clock::now();
+
+    BindTransceiverResp bindResponse;
+    SubmitSMResp submitResponse;
+    Submission submission;
+    if (!PDUCodec::isResponse(pdu.commandId())) {
+        handleRequest(pdu);
+    }
+    else if (m_state == State::Open && pdu.sequenceNumber() == m_responseSequence
+             && PDUCodec::decode(pdu, bindResponse)) {
+        m_reactor.cancelTimer(m_responseTimer);
+        m_responseTimer = 0;
+        handleCommandStatus(pdu.commandStatus());
+        if (pdu.commandStatus() == PDUCodec::ESME_ROK) onBound();
+        else if (isPermanentBindError(pdu.commandStatus())) finish();
+        else dropConnection();
+    }
+    else if (pdu.commandId() == PDUCodec::ENQUIRE_LINK_RESP) {
+        m_enquireLinkPending = false;
+    }
+    else if (pdu.commandId() == PDUCodec::UNBIND_RESP && m_state == State::Unbinding
+             && pdu.sequenceNumber() == m_responseSequence) {
+        qInfo() << tr("Unbound");
+        finish();
+    }
+    else if ((PDUCodec::decode(pdu, submitResponse) || pdu.commandId() == PDUCodec::GENERIC_NACK)
+             && m_window.complete(pdu.sequenceNumber(), submission)) {
+        // ответы приходят в любом порядке, окно находит запрос по номеру
+        if (isThrottling(pdu.commandStatus())) {
+            onThrottled();
+            // SMSC не принял сообщение, повтор после снижения скорости безопасен
+            if (++submission.throttled <= MAX_THROTTLE_RETRIES) {
+                m_pending.push_front(std::move(submission));
+                pumpSubmissions();
+                return;
+            }
+        }
+        else if (pdu.commandStatus() == PDUCodec::ESME_ROK) onAccepted();
+
+        completeSubmission(std::move(submission),
+                           SubmitResult {SubmitResult::Responded,
+                                         pdu.commandStatus(),
+                                         std::string(submitResponse.messageId.data, submitResponse.messageId.size)});
+        pumpSubmissions();
+    }
+    else {
+        qWarning() << tr("Unexpected PDU 0x%1 with sequence number %2")
+                      .arg(QString::number(pdu.commandId(), 16),
+                           QString::number(pdu.sequenceNumber()));
+    }
+}
+
+void ESMETransceiver::handleRequest(const PDUView& pdu)
+{
+    // ответы только ставятся в кольцо, readAvailable отправит их разом
+    DeliverSM deliver;
+    switch (pdu.commandId()) {
+    case PDUCodec::ENQUIRE_LINK:
+        queueHeader(PDUCodec::ENQUIRE_LINK_RESP, PDUCodec::ESME_ROK, pdu.sequenceNumber());
+        break;
+    case PDUCodec::DELIVER_SM: {
+        // отчёты о доставке и входящие сообщения приложению не нужны, но без
+        // ответа SMSC будет слать их повторно
+        const bool valid = PDUCodec::decode(pdu, deliver);
+        PDUWriter writer(m_output.writePointer(), m_output.writable());
+        queuePDU(writer, PDUCodec::encode(writer,
+                                          DeliverSMResp(),
+                                          valid ? PDUCodec::ESME_ROK : PDUCodec::ESME_RSYSERR,
+                                          pdu.sequenceNumber()));
+        break;
+    }
+    case PDUCodec::UNBIND:
+        // SMSC закрывает bind (например, на обслуживание) - подключаемся заново
+        qInfo() << tr("Unbind requested by the server");
+        queueHeader(PDUCodec::UNBIND_RESP, PDUCodec::ESME_ROK, pdu.sequenceNumber());
+        if (flushOutput()) dropConnection();
+        break;
+    default:
+        queueHeader(PDUCodec::GENERIC_NACK, PDUCodec::ESME_RINVCMDID, pdu.sequenceNumber());
+        break;
+    }
 }
 
 void ESMETransceiver::handleCommandStatus(int status)
 {
     if (status == 0) qInfo() << tr("SMPP connection established successfully.");
-    else tr("SMPP connection error: %1").arg(QString::number(status));
+    else qWarning() << tr("SMPP connection error: 0x%1").arg(QString::number(status, 16));
+}
+
+void ESMETransceiver::dropConnection()
+{
+    if (m_finished) return;
+    if (m_unbindRequested) {
+        finish();
+        return;
+    }
+
+    closeConnection();
+    parkSubmissions();
+    scheduleReconnect();
+}
+
+void ESMETransceiver::scheduleReconnect()
+{
+    std::chrono::milliseconds delay = m_config.reconnectDelay;
+    for (unsigned i = 0; i < m_reconnectAttempts && delay < m_config.maxReconnectDelay; ++i) delay *= 2;
+    delay = std::max(std::chrono::milliseconds(1), std::min(delay, m_config.maxReconnectDelay));
+    ++m_reconnectAttempts;
+
+    // случайная половина паузы, чтобы bind пула не ломились к SMSC разом
+    std::uniform_int_distribution<std::chrono::milliseconds::rep> jitter(delay.count() / 2, delay.count());
+    delay = std::chrono::milliseconds(jitter(m_random));
+
+    qInfo() << tr("Reconnecting in %1 ms").arg(qint64(delay.count()));
+    m_reconnectTimer = m_reactor.startTimer(delay, [this] {
+        m_reconnectTimer = 0;
+        connectToServer(m_address);
+    });
+}
+
+void ESMETransceiver::finish()
+{
+    if (m_finished) return;
+    m_finished = true;
+
+    closeConnection();
+    abortSubmissions();
+    // сигнал испускается уже в потоке объекта, цикл Qt не ждёт сокетов
+    QMetaObject::invokeMethod(this, "close", Qt::QueuedConnection);
+}
+
+void ESMETransceiver::closeConnection()
+{
+    m_reactor.cancelConnect(m_connectId);
+    m_connectId = 0;
+    m_reactor.cancelTimer(m_responseTimer);
+    m_responseTimer = 0;
+    m_reactor.cancelTimer(m_expiryTimer);
+    m_expiryTimer = 0;
+    m_reactor.cancelTimer(m_rateTimer);
+    m_rateTimer = 0;
+    m_reactor.cancelTimer(m_enquireLinkTimer);
+    m_enquireLinkTimer = 0;
+    m_reactor.cancelTimer(m_reconnectTimer);
+    m_reconnectTimer = 0;
+    m_enquireLinkPending = false;
+    m_state = State::Closed;
+    if (m_socket != -1) {
+        m_reactor.unwatch(m_socket);
+        shutdown(m_socket, SHUT_RDWR);
+        ::close(m_socket);
+        m_socket = -1;
+    }
+    m_output.clear();
+    m_reader.reset();
 }
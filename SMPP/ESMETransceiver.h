@@ -2,43 +2,163 @@
 
 #include <QObject>
 
-// стандартная библиотека, как заказывали
-#include <thread>
+#include "PDUCodec.h"
+#include "PDUReader.h"
+#include "RateLimiter.h"
+#include "Reactor.h"
+#include "RingBuffer.h"
+#include "SessionConfig.h"
+#include "SubmitWindow.h"
 
+#include <netinet/in.h>
 
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <random>
+
+
+// Сессия ESME поверх Reactor: сокет неблокирующий, вся работа с ним идёт в
+// потоке цикла, а в поток Qt результаты попадают через очередь событий.
+//
+// Состояния по SMPP 3.4, раздел 2.2: Closed -> Open (соединение есть, ждём
+// ответ на bind) -> BoundTrx -> Unbinding -> Closed. При обрыве соединения
+// сессия переподключается с растущей паузой, а сообщения из очереди и окна
+// ждут нового bind и уходят в прежнем порядке. Окончательно сессия
+// закрывается (сигнал close) только после unbind или отказа в bind по
+// неверному логину или паролю.
 class ESMETransceiver: public QObject
 {
     Q_OBJECT
 
 public:
-    explicit ESMETransceiver(const QString& hostname,
-                             quint16 port,
-                             const QString& login,
-                             const QString& password,
-                             const QString& systemType,
-                             quint8 smmpVersion,
+    enum class State {
+        Closed,
+        Open,
+        BoundTrx,
+        Unbinding
+    };
+
+    // сообщения, которые сессия не доставила до окончательного закрытия
+    using OrphanHandler = std::function<void(Submission&& submission)>;
+
+    // poolLimiter - общий для всех сессий пула ограничитель скорости, если есть
+    explicit ESMETransceiver(Reactor& reactor,
+                             const SessionConfig& config,
+                             std::shared_ptr<RateLimiter> poolLimiter = nullptr,
                              QObject* parent = nullptr);
+    // дожидается, пока цикл отпустит сокет и таймеры сессии
     virtual ~ESMETransceiver();
 
+    // Можно вызывать из любого потока. Сообщение ждёт места в окне и уходит
+    // после bind; callback вызывается в потоке цикла ровно один раз. false -
+    // окно и очередь заполнены: сообщение не принято, о свободном месте
+    // сообщит readyToSubmit.
+    bool submit(OutboundMessage message, SubmitCallback callback);
+    // то же, но message и callback забираются только при успехе: при отказе
+    // их можно отдать другой сессии
+    bool trySubmit(OutboundMessage& message, SubmitCallback& callback);
+
+    // Если задан, сообщения из очереди и окна при закрытии сессии уходят
+    // сюда (в потоке цикла) вместо завершения с Aborted. Запрос из окна мог
+    // дойти до SMSC, так что повторная отправка - "хотя бы один раз".
+    void setOrphanHandler(OrphanHandler handler);
+
+    // Можно вызывать из любого потока. Новые сообщения не принимаются,
+    // отправленные дожидаются ответа, затем unbind и close. Очередь уходит
+    // в OrphanHandler.
+    void unbind();
+
+    // можно читать из любого потока
+    State state() const { return m_state.load(); }
+    bool isBound() const { return m_state.load() == State::BoundTrx; }
+    bool isUnbinding() const { return m_unbindRequested.load(); }
+    bool isFinished() const { return m_finished.load(); }
+    // сообщения в очереди и в окне
+    quint32 load() const { return m_accepted.load(); }
+    // сколько ещё сообщений примет submit: у каждой сессии свои окно и очередь
+    quint32 freeCapacity() const
+    {
+        const SubmitWindow::Settings& settings = m_window.settings();
+        const quint32 capacity = settings.size + settings.queueLimit;
+        const quint32 load = m_accepted.load();
+        return load < capacity ? capacity - load : 0;
+    }
+
 signals:
     void close();
+    void readyToSubmit();
 
 private:
-    bool initSocket();
-    void transmitBindPDU();
-    void waitForBindPDUResponse();
+    // всё ниже вызывается только в потоке цикла
+    void connectToServer(const sockaddr_in& address);
+    void onConnected(int socket);
+    void onBound();
+    void onSocketEvent(std::uint32_t events);
+    // PDU уже закодирован через writer в свободное место m_output
+    bool queuePDU(const PDUWriter& writer, std::size_t length);
+    bool queueHeader(std::uint32_t commandId, std::uint32_t commandStatus, std::uint32_t sequenceNumber);
+    bool flushOutput();
+    void pumpSubmissions();
+    void completeSubmission(Submission&& submission, const SubmitResult& result);
+    void releaseSubmission();
+    void armExpiryTimer();
+    void armRateTimer(RateLimiter::Clock::duration wait);
+    bool acquireToken(RateLimiter::Clock::time_point now);
+    void onThrottled();
+    void onAccepted();
+    void parkSubmissions();
+    void abortSubmissions();
+    void onEnquireLinkTimer();
+    void sendUnbind();
+    void readAvailable();
+    void handlePDU(const PDUView& pdu);
+    void handleRequest(const PDUView& pdu);
     void handleCommandStatus(int status);
+    // обрыв: соединение закрывается, сообщения ждут переподключения
+    void dropConnection();
+    void scheduleReconnect();
+    void finish();
+    void closeConnection();
 
 private:
-    int m_socket;  // QTcpSocket можно использовать только с QThread
+    Reactor& m_reactor;
+    sockaddr_in m_address;
+    int m_socket;
+    Reactor::Id m_connectId;
+    // ответ на bind или unbind
+    Reactor::Id m_responseTimer;
+    // номер последовательности этого bind или unbind: ответ ищется по нему
+    std::uint32_t m_responseSequence;
+    Reactor::Id m_expiryTimer;
+    Reactor::Id m_rateTimer;
+    Reactor::Id m_enquireLinkTimer;
+    Reactor::Id m_reconnectTimer;
+    std::atomic<State> m_state;
+    std::atomic<bool> m_unbindRequested;
+    std::atomic<bool> m_finished;
+
+    bool m_enquireLinkPending;
+    SubmitWindow::Clock::time_point m_lastReceived;
+    unsigned m_reconnectAttempts;
+    std::minstd_rand m_random;
+
+    RingBuffer m_output;
+    PDUReader m_reader;
 
-    std::thread m_transmitterThread;
-    std::thread m_receiverThread;
+    SubmitWindow m_window;
+    std::deque<Submission> m_pending;
+    RateLimiter m_limiter;
+    std::shared_ptr<RateLimiter> m_poolLimiter;
+    // окно, до которого сейчас разрешено заполнять m_window
+    WindowLimit m_windowLimit;
+    // принятые submit, ещё не получившие результата (очередь + окно);
+    // по нему submit отказывает сразу в потоке производителя
+    std::atomic<std::uint32_t> m_accepted;
+    std::atomic<bool> m_producersBlocked;
+    OrphanHandler m_orphanHandler;
 
-    QString m_hostname;
-    quint16 m_port;
-    QString m_login;
-    QString m_password;
-    QString m_systemType;
-    quint8  m_smmpVersion;
+    SessionConfig m_config;
 };
@@ -0,0 +1,378 @@
+#include "PDUCodec.h"
+
+#include <algorithm>
+
+
+namespace {
+    // пределы полей вместе с завершающим нулём, SMPP 3.4, раздел 5.2
+    const std::uint32_t SYSTEM_ID_LENGTH = 16;
+    const std::uint32_t PASSWORD_LENGTH = 9;
+    const std::uint32_t SYSTEM_TYPE_LENGTH = 13;
+    const std::uint32_t ADDRESS_RANGE_LENGTH = 41;
+    const std::uint32_t SERVICE_TYPE_LENGTH = 6;
+    const std::uint32_t ADDRESS_LENGTH = 21;
+    const std::uint32_t TIME_LENGTH = 17;
+    const std::uint32_t MESSAGE_ID_LENGTH = 65;
+    const std::uint32_t SHORT_MESSAGE_LENGTH = 254;
+
+    const std::uint32_t TLV_HEADER_LENGTH = 4;
+
+    std::uint16_t peekUInt16(const char* data)
+    {
+        const unsigned char* bytes = reinterpret_cast<const unsigned char*>(data);
+        return std::uint16_t(bytes[0] << 8 | bytes[1]);
+    }
+
+    void writeUInt32At(char* data, std::uint32_t value)
+    {
+        data[0] = char(value >> 24);
+        data[1] = char(value >> 16);
+        data[2] = char(value >> 8);
+        data[3] = char(value);
+    }
+}
+
+
+bool TLVList::next(std::uint32_t& offset, TLV& tlv) const
+{
+    if (offset >= m_raw.size || m_raw.size - offset < TLV_HEADER_LENGTH) return false;
+
+    const char* entry = m_raw.data + offset;
+    const std::uint16_t length = peekUInt16(entry + 2);
+    if (m_raw.size - offset - TLV_HEADER_LENGTH < length) return false;
+
+    tlv.tag = peekUInt16(entry);
+    tlv.value = ByteView(entry + TLV_HEADER_LENGTH, length);
+    offset += TLV_HEADER_LENGTH + length;
+    return true;
+}
+
+bool TLVList::find(std::uint16_t tag, ByteView& value) const
+{
+    std::uint32_t offset = 0;
+    TLV tlv;
+    while (next(offset, tlv)) {
+        if (tlv.tag == tag) {
+            value = tlv.value;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool TLVList::isValid() const
+{
+    std::uint32_t offset = 0;
+    TLV tlv;
+    while (next(offset, tlv)) {}
+    return offset == m_raw.size;
+}
+
+// -----------------------------------------------------------------------------
+
+PDUWriter::PDUWriter(char* data, std::size_t capacity)
+    : m_data(data)
+    , m_capacity(capacity)
+    , m_size(0)
+    , m_overflowed(false)
+    , m_invalid(false)
+{}
+
+void PDUWriter::begin(std::uint32_t commandId, std::uint32_t commandStatus, std::uint32_t sequenceNumber)
+{
+    m_size = 0;
+    m_overflowed = false;
+    m_invalid = false;
+    // command_length вписывается в finish
+    writeUInt32(0);
+    writeUInt32(commandId);
+    writeUInt32(commandStatus);
+    writeUInt32(sequenceNumber);
+}
+
+void PDUWriter::writeUInt8(std::uint8_t value)
+{
+    if (char* data = reserve(1)) data[0] = char(value);
+}
+
+void PDUWriter::writeUInt16(std::uint16_t value)
+{
+    if (char* data = reserve(2)) {
+        data[0] = char(value >> 8);
+        data[1] = char(value);
+    }
+}
+
+void PDUWriter::writeUInt32(std::uint32_t value)
+{
+    if (char* data = reserve(4)) writeUInt32At(data, value);
+}
+
+void PDUWriter::writeCString(const ByteView& value, std::uint32_t maxLength)
+{
+    if (value.size >= maxLength) {
+        m_invalid = true;
+        return;
+    }
+    if (char* data = reserve(value.size + 1)) {
+        std::memcpy(data, value.data, value.size);
+        data[value.size] = '\0';
+    }
+}
+
+void PDUWriter::writeOctets(const ByteView& value)
+{
+    if (char* data = reserve(value.size)) std::memcpy(data, value.data, value.size);
+}
+
+void PDUWriter::writeTLV(std::uint16_t tag, const ByteView& value)
+{
+    if (value.size > 0xFFFF) {
+        m_invalid = true;
+        return;
+    }
+    writeUInt16(tag);
+    writeUInt16(std::uint16_t(value.size));
+    writeOctets(value);
+}
+
+void PDUWriter::writeTLVs(const TLVList& tlvs)
+{
+    if (!tlvs.isValid()) {
+        m_invalid = true;
+        return;
+    }
+    writeOctets(tlvs.raw());
+}
+
+std::size_t PDUWriter::finish()
+{
+    if (m_overflowed || m_invalid || m_size < PDUView::HEADER_LENGTH) return 0;
+
+    writeUInt32At(m_data, std::uint32_t(m_size));
+    return m_size;
+}
+
+char* PDUWriter::reserve(std::size_t size)
+{
+    if (m_overflowed || m_invalid) return nullptr;
+    if (m_capacity - m_size < size) {
+        m_overflowed = true;
+        return nullptr;
+    }
+
+    char* result = m_data + m_size;
+    m_size += size;
+    return result;
+}
+
+// -----------------------------------------------------------------------------
+
+PDUParser::PDUParser(const PDUView& pdu)
+    : m_position(pdu.body())
+    , m_end(pdu.data() + pdu.length())
+{}
+
+bool PDUParser::readUInt8(std::uint8_t& value)
+{
+    if (m_end - m_position < 1) return false;
+    value = std::uint8_t(*m_position++);
+    return true;
+}
+
+bool PDUParser::readUInt16(std::uint16_t& value)
+{
+    if (m_end - m_position < 2) return false;
+    value = peekUInt16(m_position);
+    m_position += 2;
+    return true;
+}
+
+bool PDUParser::readUInt32(std::uint32_t& value)
+{
+    if (m_end - m_position < 4) return false;
+    value = PDUView::readUInt32(m_position);
+    m_position += 4;
+    return true;
+}
+
+bool PDUParser::readCString(ByteView& value, std::uint32_t maxLength)
+{
+    const std::size_t limit = std::min<std::size_t>(std::size_t(m_end - m_position), maxLength);
+    const char* terminator = static_cast<const char*>(std::memchr(m_position, '\0', limit));
+    if (!terminator) return false;
+
+    value = ByteView(m_position, std::uint32_t(terminator - m_position));
+    m_position = terminator + 1;
+    return true;
+}
+
+bool PDUParser::readOctets(ByteView& value, std::uint32_t size)
+{
+    if (std::size_t(m_end - m_position) < size) return false;
+
+    value = ByteView(m_position, size);
+    m_position += size;
+    return true;
+}
+
+bool PDUParser::readTLVs(TLVList& tlvs)
+{
+    tlvs = TLVList(ByteView(m_position, std::uint32_t(m_end - m_position)));
+    m_position = m_end;
+    return tlvs.isValid();
+}
+
+// -----------------------------------------------------------------------------
+
+std::size_t PDUCodec::encode(PDUWriter& writer, const BindTransceiver& pdu, std::uint32_t sequenceNumber)
+{
+    writer.begin(BIND_TRANSCEIVER, ESME_ROK, sequenceNumber);
+    writer.writeCString(pdu.systemId, SYSTEM_ID_LENGTH);
+    writer.writeCString(pdu.password, PASSWORD_LENGTH);
+    writer.writeCString(pdu.systemType, SYSTEM_TYPE_LENGTH);
+    writer.writeUInt8(pdu.interfaceVersion);
+    writer.writeUInt8(pdu.addrTon);
+    writer.writeUInt8(pdu.addrNpi);
+    writer.writeCString(pdu.addressRange, ADDRESS_RANGE_LENGTH);
+    return writer.finish();
+}
+
+std::size_t PDUCodec::encode(PDUWriter& writer, const SubmitSM& pdu, std::uint32_t sequenceNumber)
+{
+    writer.begin(SUBMIT_SM, ESME_ROK, sequenceNumber);
+    encodeShortMessage(writer, pdu);
+    return writer.finish();
+}
+
+std::size_t PDUCodec::encode(PDUWriter& writer, const DeliverSM& pdu, std::uint32_t sequenceNumber)
+{
+    writer.begin(DELIVER_SM, ESME_ROK, sequenceNumber);
+    encodeShortMessage(writer, pdu);
+    return writer.finish();
+}
+
+std::size_t PDUCodec::encode(PDUWriter& writer,
+                             const SubmitSMResp& pdu,
+                             std::uint32_t commandStatus,
+                             std::uint32_t sequenceNumber)
+{
+    writer.begin(SUBMIT_SM_RESP, commandStatus, sequenceNumber);
+    writer.writeCString(pdu.messageId, MESSAGE_ID_LENGTH);
+    return writer.finish();
+}
+
+std::size_t PDUCodec::encode(PDUWriter& writer,
+                             const DeliverSMResp& pdu,
+                             std::uint32_t commandStatus,
+                             std::uint32_t sequenceNumber)
+{
+    // message_id в deliver_sm_resp не используется и всегда пустой
+    (void)pdu;
+    writer.begin(DELIVER_SM_RESP, commandStatus, sequenceNumber);
+    writer.writeCString(ByteView(), MESSAGE_ID_LENGTH);
+    return writer.finish();
+}
+
+std::size_t PDUCodec::encodeHeader(PDUWriter& writer,
+                                   std::uint32_t commandId,
+                                   std::uint32_t commandStatus,
+                                   std::uint32_t sequenceNumber)
+{
+    writer.begin(commandId, commandStatus, sequenceNumber);
+    return writer.finish();
+}
+
+bool PDUCodec::decode(const PDUView& pdu, BindTransceiverResp& result)
+{
+    if (pdu.commandId() != BIND_TRANSCEIVER_RESP) return false;
+
+    result = BindTransceiverResp();
+    if (pdu.bodyLength() == 0) return pdu.commandStatus() != ESME_ROK;
+
+    PDUParser parser(pdu);
+    return parser.readCString(result.systemId, SYSTEM_ID_LENGTH)
+        && parser.readTLVs(result.tlvs);
+}
+
+bool PDUCodec::decode(const PDUView& pdu, SubmitSM& result)
+{
+    return pdu.commandId() == SUBMIT_SM && decodeShortMessage(pdu, result);
+}
+
+bool PDUCodec::decode(const PDUView& pdu, DeliverSM& result)
+{
+    return pdu.commandId() == DELIVER_SM && decodeShortMessage(pdu, result);
+}
+
+bool PDUCodec::decode(const PDUView& pdu, SubmitSMResp& result)
+{
+    return pdu.commandId() == SUBMIT_SM_RESP && decodeMessageIdResp(pdu, result.messageId);
+}
+
+bool PDUCodec::decode(const PDUView& pdu, DeliverSMResp& result)
+{
+    return pdu.commandId() == DELIVER_SM_RESP && decodeMessageIdResp(pdu, result.messageId);
+}
+
+void PDUCodec::encodeShortMessage(PDUWriter& writer, const ShortMessage& pdu)
+{
+    writer.writeCString(pdu.serviceType, SERVICE_TYPE_LENGTH);
+    writer.writeUInt8(pdu.sourceAddrTon);
+    writer.writeUInt8(pdu.sourceAddrNpi);
+    writer.writeCString(pdu.sourceAddr, ADDRESS_LENGTH);
+    writer.writeUInt8(pdu.destAddrTon);
+    writer.writeUInt8(pdu.destAddrNpi);
+    writer.writeCString(pdu.destinationAddr, ADDRESS_LENGTH);
+    writer.writeUInt8(pdu.esmClass);
+    writer.writeUInt8(pdu.protocolId);
+    writer.writeUInt8(pdu.priorityFlag);
+    writer.writeCString(pdu.scheduleDeliveryTime, TIME_LENGTH);
+    writer.writeCString(pdu.validityPeriod, TIME_LENGTH);
+    writer.writeUInt8(pdu.registeredDelivery);
+    writer.writeUInt8(pdu.replaceIfPresentFlag);
+    writer.writeUInt8(pdu.dataCoding);
+    writer.writeUInt8(pdu.smDefaultMsgId);
+    if (pdu.shortMessage.size > SHORT_MESSAGE_LENGTH) {
+        writer.invalidate();
+        return;
+    }
+    writer.writeUInt8(std::uint8_t(pdu.shortMessage.size));
+    writer.writeOctets(pdu.shortMessage);
+    writer.writeTLVs(pdu.tlvs);
+}
+
+bool PDUCodec::decodeShortMessage(const PDUView& pdu, ShortMessage& result)
+{
+    PDUParser parser(pdu);
+    std::uint8_t smLength = 0;
+    return parser.readCString(result.serviceType, SERVICE_TYPE_LENGTH)
+        && parser.readUInt8(result.sourceAddrTon)
+        && parser.readUInt8(result.sourceAddrNpi)
+        && parser.readCString(result.sourceAddr, ADDRESS_LENGTH)
+        && parser.readUInt8(result.destAddrTon)
+        && parser.readUInt8(result.destAddrNpi)
+        && parser.readCString(result.destinationAddr, ADDRESS_LENGTH)
+        && parser.readUInt8(result.esmClass)
+        && parser.readUInt8(result.protocolId)
+        && parser.readUInt8(result.priorityFlag)
+        && parser.readCString(result.scheduleDeliveryTime, TIME_LENGTH)
+        && parser.readCString(result.validityPeriod, TIME_LENGTH)
+        && parser.readUInt8(result.registeredDelivery)
+        && parser.readUInt8(result.replaceIfPresentFlag)
+        && parser.readUInt8(result.dataCoding)
+        && parser.readUInt8(result.smDefaultMsgId)
+        && parser.readUInt8(smLength)
+        && smLength <= SHORT_MESSAGE_LENGTH
+        && parser.readOctets(result.shortMessage, smLength)
+        && parser.readTLVs(result.tlvs);
+}
+
+bool PDUCodec::decodeMessageIdResp(const PDUView& pdu, ByteView& messageId)
+{
+    messageId = ByteView();
+    if (pdu.bodyLength() == 0) return pdu.commandStatus() != ESME_ROK;
+
+    PDUParser parser(pdu);
+    return parser.readCString(messageId, MESSAGE_ID_LENGTH) && parser.atEnd();
+}
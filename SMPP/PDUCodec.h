@@ -0,0 +1,251 @@
+#pragma once
+
+#include "PDUReader.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+
+// Участок байтов без владения: поле PDU в приёмном буфере или данные
+// вызывающего при кодировании. Для C-Octet String - без завершающего нуля.
+struct ByteView
+{
+    ByteView() : data(""), size(0) {}
+    ByteView(const char* data, std::uint32_t size) : data(data), size(size) {}
+    ByteView(const char* string) : data(string), size(std::uint32_t(std::strlen(string))) {}
+
+    bool isEmpty() const { return size == 0; }
+
+    const char* data;
+    std::uint32_t size;
+};
+
+
+// Необязательные параметры (TLV) в конце тела PDU: tag и length по 16 бит
+// в сетевом порядке, затем value.
+class TLVList
+{
+public:
+    struct TLV
+    {
+        std::uint16_t tag;
+        ByteView value;
+    };
+
+    TLVList() {}
+    explicit TLVList(const ByteView& raw) : m_raw(raw) {}
+
+    const ByteView& raw() const { return m_raw; }
+    bool isEmpty() const { return m_raw.isEmpty(); }
+
+    // перебор: offset начинается с 0; false - конец списка или битая запись
+    bool next(std::uint32_t& offset, TLV& tlv) const;
+    bool find(std::uint16_t tag, ByteView& value) const;
+    // все записи целые и укладываются ровно в raw
+    bool isValid() const;
+
+private:
+    ByteView m_raw;
+};
+
+
+// Кодирование PDU прямо в чужой буфер: begin резервирует место под
+// заголовок, поля дописываются следом, finish вписывает command_length.
+// Если места не хватило, finish возвращает 0 и в буфере ничего не считается
+// записанным.
+class PDUWriter
+{
+public:
+    PDUWriter(char* data, std::size_t capacity);
+
+    void begin(std::uint32_t commandId, std::uint32_t commandStatus, std::uint32_t sequenceNumber);
+
+    void writeUInt8(std::uint8_t value);
+    void writeUInt16(std::uint16_t value);
+    void writeUInt32(std::uint32_t value);
+    // maxLength - предел поля из спецификации вместе с завершающим нулём
+    void writeCString(const ByteView& value, std::uint32_t maxLength);
+    void writeOctets(const ByteView& value);
+    void writeTLV(std::uint16_t tag, const ByteView& value);
+    void writeTLVs(const TLVList& tlvs);
+    // для проверок, которые делает сам кодек PDU
+    void invalidate() { m_invalid = true; }
+
+    // длина PDU или 0 (isOverflowed или isInvalid)
+    std::size_t finish();
+
+    // не хватило места: можно повторить, когда буфер освободится
+    bool isOverflowed() const { return m_overflowed; }
+    // поле длиннее допустимого: повтор не поможет
+    bool isInvalid() const { return m_invalid; }
+
+private:
+    char* reserve(std::size_t size);
+
+private:
+    char* m_data;
+    std::size_t m_capacity;
+    std::size_t m_size;
+    bool m_overflowed;
+    bool m_invalid;
+};
+
+
+// Чтение полей тела PDU по порядку. Строки и октеты выдаются как ByteView в
+// приёмный буфер, без копирования.
+class PDUParser
+{
+public:
+    explicit PDUParser(const PDUView& pdu);
+
+    bool readUInt8(std::uint8_t& value);
+    bool readUInt16(std::uint16_t& value);
+    bool readUInt32(std::uint32_t& value);
+    // завершающий нуль должен найтись в пределах maxLength байт
+    bool readCString(ByteView& value, std::uint32_t maxLength);
+    bool readOctets(ByteView& value, std::uint32_t size);
+    // оставшаяся часть тела как список TLV
+    bool readTLVs(TLVList& tlvs);
+
+    bool atEnd() const { return m_position == m_end; }
+
+private:
+    const char* m_position;
+    const char* m_end;
+};
+
+
+// Поля PDU SMPP 3.4 - только представления, ничего не копируется.
+
+struct BindTransceiver
+{
+    ByteView systemId;
+    ByteView password;
+    ByteView systemType;
+    std::uint8_t interfaceVersion = 0x34;
+    std::uint8_t addrTon = 0;
+    std::uint8_t addrNpi = 0;
+    ByteView addressRange;
+};
+
+struct BindTransceiverResp
+{
+    ByteView systemId;
+    TLVList tlvs;
+};
+
+// общая раскладка submit_sm и deliver_sm
+struct ShortMessage
+{
+    ByteView serviceType;
+    std::uint8_t sourceAddrTon = 0;
+    std::uint8_t sourceAddrNpi = 0;
+    ByteView sourceAddr;
+    std::uint8_t destAddrTon = 0;
+    std::uint8_t destAddrNpi = 0;
+    ByteView destinationAddr;
+    std::uint8_t esmClass = 0;
+    std::uint8_t protocolId = 0;
+    std::uint8_t priorityFlag = 0;
+    ByteView scheduleDeliveryTime;
+    ByteView validityPeriod;
+    std::uint8_t registeredDelivery = 0;
+    std::uint8_t replaceIfPresentFlag = 0;
+    std::uint8_t dataCoding = 0;
+    std::uint8_t smDefaultMsgId = 0;
+    // до 254 байт; длиннее - через TLV message_payload
+    ByteView shortMessage;
+    TLVList tlvs;
+};
+
+struct SubmitSM: ShortMessage {};
+struct DeliverSM: ShortMessage {};
+
+struct SubmitSMResp
+{
+    ByteView messageId;
+};
+
+struct DeliverSMResp
+{
+    ByteView messageId;
+};
+
+
+class PDUCodec
+{
+public:
+    enum CommandId : std::uint32_t {
+        GENERIC_NACK          = 0x80000000,
+        BIND_TRANSCEIVER      = 0x00000009,
+        BIND_TRANSCEIVER_RESP = 0x80000009,
+        SUBMIT_SM             = 0x00000004,
+        SUBMIT_SM_RESP        = 0x80000004,
+        DELIVER_SM            = 0x00000005,
+        DELIVER_SM_RESP       = 0x80000005,
+        UNBIND                = 0x00000006,
+        UNBIND_RESP           = 0x80000006,
+        ENQUIRE_LINK          = 0x00000015,
+        ENQUIRE_LINK_RESP     = 0x80000015
+    };
+
+    enum CommandStatus : std::uint32_t {
+        ESME_ROK         = 0x00000000,
+        ESME_RINVMSGLEN  = 0x00000001,
+        ESME_RINVCMDLEN  = 0x00000002,
+        ESME_RINVCMDID   = 0x00000003,
+        ESME_RINVBNDSTS  = 0x00000004,
+        ESME_RALYBND     = 0x00000005,
+        ESME_RSYSERR     = 0x00000008,
+        ESME_RBINDFAIL   = 0x0000000D,
+        ESME_RINVPASWD   = 0x0000000E,
+        ESME_RINVSYSID   = 0x0000000F,
+        ESME_RMSGQFUL    = 0x00000014,
+        ESME_RTHROTTLED  = 0x00000058
+    };
+
+    enum TLVTag : std::uint16_t {
+        SC_INTERFACE_VERSION = 0x0210,
+        RECEIPTED_MESSAGE_ID = 0x001E,
+        MESSAGE_STATE        = 0x0427,
+        MESSAGE_PAYLOAD      = 0x0424,
+        SAR_MSG_REF_NUM      = 0x020C,
+        SAR_TOTAL_SEGMENTS   = 0x020E,
+        SAR_SEGMENT_SEQNUM   = 0x020F
+    };
+
+    static bool isResponse(std::uint32_t commandId) { return (commandId & GENERIC_NACK) != 0; }
+
+    // запросы; возвращают длину PDU или 0, как PDUWriter::finish
+    static std::size_t encode(PDUWriter& writer, const BindTransceiver& pdu, std::uint32_t sequenceNumber);
+    static std::size_t encode(PDUWriter& writer, const SubmitSM& pdu, std::uint32_t sequenceNumber);
+    static std::size_t encode(PDUWriter& writer, const DeliverSM& pdu, std::uint32_t sequenceNumber);
+    // ответы
+    static std::size_t encode(PDUWriter& writer,
+                              const SubmitSMResp& pdu,
+                              std::uint32_t commandStatus,
+                              std::uint32_t sequenceNumber);
+    static std::size_t encode(PDUWriter& writer,
+                              const DeliverSMResp& pdu,
+                              std::uint32_t commandStatus,
+                              std::uint32_t sequenceNumber);
+    // enquire_link, unbind, их ответы и generic_nack - один заголовок
+    static std::size_t encodeHeader(PDUWriter& writer,
+                                    std::uint32_t commandId,
+                                    std::uint32_t commandStatus,
+                                    std::uint32_t sequenceNumber);
+
+    // false - не тот command_id или тело не по спецификации. Ответ с
+    // ненулевым статусом может прийти без тела, тогда поля остаются пустыми.
+    static bool decode(const PDUView& pdu, BindTransceiverResp& result);
+    static bool decode(const PDUView& pdu, SubmitSM& result);
+    static bool decode(const PDUView& pdu, DeliverSM& result);
+    static bool decode(const PDUView& pdu, SubmitSMResp& result);
+    static bool decode(const PDUView& pdu, DeliverSMResp& result);
+
+private:
+    static void encodeShortMessage(PDUWriter& writer, const ShortMessage& pdu);
+    static bool decodeShortMessage(const PDUView& pdu, ShortMessage& result);
+    static bool decodeMessageIdResp(const PDUView& pdu, ByteView& messageId);
+};
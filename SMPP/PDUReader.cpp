@@ -0,0 +1,70 @@
+#include "PDUReader.h"
+
+#include <sys/socket.h>
+#include <errno.h>
+
+#include <algorithm>
+
+
+namespace {
+    // кольцо вмещает несколько PDU наибольшей длины, чтобы пачка мелких
+    // читалась одним recv
+    const std::size_t MIN_BUFFER_CAPACITY = 64 * 1024;
+}
+
+
+const std::uint32_t PDUView::HEADER_LENGTH;
+const std::uint32_t PDUReader::DEFAULT_MAX_PDU_LENGTH;
+
+PDUReader::PDUReader(std::uint32_t maxPDULength)
+    : m_buffer(std::max<std::size_t>(MIN_BUFFER_CAPACITY, 2 * std::size_t(maxPDULength)))
+    , m_maxPDULength(std::max(maxPDULength, PDUView::HEADER_LENGTH))
+    , m_corrupted(false)
+    , m_invalidLength(0)
+{}
+
+PDUReader::ReadStatus PDUReader::readFrom(int socket)
+{
+    for (;;) {
+        const std::size_t writable = m_buffer.writable();
+        if (writable == 0) return ReadStatus::BufferFull;
+
+        ssize_t received = recv(socket, m_buffer.writePointer(), writable, 0);
+        // Неполное чтение ещё не значит, что сокет опустел: закрытие, пришедшее
+        // тем же событием (EPOLLIN | EPOLLRDHUP), видно только следующему
+        // recv, а нового события для него уже не будет. Поэтому читаем до
+        // EAGAIN или нуля.
+        if (received > 0) m_buffer.commit(std::size_t(received));
+        else if (received == 0) return ReadStatus::Closed;
+        else if (errno == EAGAIN || errno == EWOULDBLOCK) return ReadStatus::Drained;
+        else if (errno != EINTR) return ReadStatus::Error;
+    }
+}
+
+bool PDUReader::next(PDUView& pdu)
+{
+    if (isCorrupted()) return false;
+
+    const std::size_t readable = m_buffer.readable();
+    if (readable < PDUView::HEADER_LENGTH) return false;
+
+    const std::uint32_t length = PDUView::readUInt32(m_buffer.readPointer());
+    if (length < PDUView::HEADER_LENGTH || length > m_maxPDULength) {
+        m_corrupted = true;
+        m_invalidLength = length;
+        return false;
+    }
+    if (readable < length) return false;
+
+    // место освобождается сразу, но перезаписать его может только следующий readFrom
+    pdu = PDUView(m_buffer.readPointer(), length);
+    m_buffer.consume(length);
+    return true;
+}
+
+void PDUReader::reset()
+{
+    m_buffer.clear();
+    m_corrupted = false;
+    m_invalidLength = 0;
+}
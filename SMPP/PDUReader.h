@@ -0,0 +1,79 @@
+#pragma once
+
+#include "RingBuffer.h"
+
+#include <cstdint>
+
+
+// PDU, лежащий прямо в приёмном буфере. Поля заголовка хранятся в сетевом
+// порядке байтов и разбираются при обращении.
+class PDUView
+{
+public:
+    static const std::uint32_t HEADER_LENGTH = 16;
+
+    PDUView() : m_data(nullptr), m_length(0) {}
+    PDUView(const char* data, std::uint32_t length) : m_data(data), m_length(length) {}
+
+    const char* data() const { return m_data; }
+    std::uint32_t length() const { return m_length; }
+
+    std::uint32_t commandId() const { return readUInt32(m_data + 4); }
+    std::uint32_t commandStatus() const { return readUInt32(m_data + 8); }
+    std::uint32_t sequenceNumber() const { return readUInt32(m_data + 12); }
+
+    const char* body() const { return m_data + HEADER_LENGTH; }
+    std::uint32_t bodyLength() const { return m_length - HEADER_LENGTH; }
+
+    static std::uint32_t readUInt32(const char* data)
+    {
+        const unsigned char* bytes = reinterpret_cast<const unsigned char*>(data);
+        return std::uint32_t(bytes[0]) << 24 | std::uint32_t(bytes[1]) << 16
+             | std::uint32_t(bytes[2]) << 8 | std::uint32_t(bytes[3]);
+    }
+
+private:
+    const char* m_data;
+    std::uint32_t m_length;
+};
+
+
+// Потоковый разбор PDU из неблокирующего сокета. readFrom забирает всё, что
+// есть в сокете (сколько влезет в кольцо), next выдаёт по одному каждый
+// целый PDU по его command_length, сколько бы их ни пришло одним сегментом и
+// на сколько бы сегментов ни разбился один PDU.
+//
+// Выданные PDUView указывают прямо в кольцо и действительны до следующего
+// readFrom или reset.
+class PDUReader
+{
+public:
+    enum class ReadStatus {
+        Drained,     // сокет пуст, ждём следующего события
+        BufferFull,  // сокет ещё не пуст: разобрать PDU и читать дальше
+        Closed,      // соединение закрыто другой стороной
+        Error        // ошибка чтения, причина в errno
+    };
+
+    static const std::uint32_t DEFAULT_MAX_PDU_LENGTH = 65536;
+
+    explicit PDUReader(std::uint32_t maxPDULength = DEFAULT_MAX_PDU_LENGTH);
+
+    ReadStatus readFrom(int socket);
+    // false - целого PDU ещё нет или поток испорчен (isCorrupted)
+    bool next(PDUView& pdu);
+
+    // command_length вне [16, maxPDULength]: границы следующих PDU
+    // неизвестны, соединение придётся закрыть
+    bool isCorrupted() const { return m_corrupted; }
+    std::uint32_t invalidLength() const { return m_invalidLength; }
+    std::uint32_t maxPDULength() const { return m_maxPDULength; }
+
+    void reset();
+
+private:
+    RingBuffer m_buffer;
+    std::uint32_t m_maxPDULength;
+    bool m_corrupted;
+    std::uint32_t m_invalidLength;
+};
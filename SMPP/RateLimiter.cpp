@@ -0,0 +1,97 @@
+#include "RateLimiter.h"
+
+#include <algorithm>
+
+
+const RateLimiter::Clock::duration RateLimiter::DECREASE_INTERVAL = std::chrono::seconds(1);
+
+RateLimiter::RateLimiter(const Settings& settings)
+    : m_settings(settings)
+    , m_rate(settings.rate)
+    , m_tokens(std::max(1.0, settings.burst))
+    , m_updated(Clock::now())
+    , m_lastDecrease(m_updated - DECREASE_INTERVAL)
+{
+    m_settings.burst = std::max(1.0, m_settings.burst);
+    m_settings.minRate = std::min(std::max(m_settings.minRate, 0.001), std::max(m_settings.rate, 0.001));
+}
+
+RateLimiter::Clock::duration RateLimiter::acquire(Clock::time_point now)
+{
+    if (!isLimited()) return Clock::duration::zero();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    refill(now);
+    if (m_tokens >= 1) {
+        m_tokens -= 1;
+        return Clock::duration::zero();
+    }
+    const std::chrono::duration<double> wait((1 - m_tokens) / m_rate);
+    return std::max<Clock::duration>(std::chrono::duration_cast<Clock::duration>(wait), Clock::duration(1));
+}
+
+void RateLimiter::refund()
+{
+    if (!isLimited()) return;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_tokens = std::min(m_tokens + 1, m_settings.burst);
+}
+
+void RateLimiter::onAccepted()
+{
+    if (!isLimited()) return;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_rate = std::min(m_rate + m_settings.increase / m_rate, m_settings.rate);
+}
+
+void RateLimiter::onThrottled(Clock::time_point now)
+{
+    if (!isLimited()) return;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (now - m_lastDecrease < DECREASE_INTERVAL) return;
+
+    refill(now);
+    m_rate = std::max(m_rate / 2, m_settings.minRate);
+    // запас тоже сгорает, иначе после снижения сразу уйдёт пачка
+    m_tokens = std::min(m_tokens, 0.0);
+    m_lastDecrease = now;
+}
+
+double RateLimiter::rate() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return isLimited() ? m_rate : 0;
+}
+
+void RateLimiter::refill(Clock::time_point now)
+{
+    if (now <= m_updated) return;
+
+    const std::chrono::duration<double> elapsed = now - m_updated;
+    m_tokens = std::min(m_tokens + elapsed.count() * m_rate, m_settings.burst);
+    m_updated = now;
+}
+
+// -----------------------------------------------------------------------------
+
+WindowLimit::WindowLimit(unsigned maximum)
+    : m_value(std::max(1u, maximum))
+    , m_maximum(std::max(1u, maximum))
+    , m_lastDecrease(RateLimiter::Clock::now() - RateLimiter::DECREASE_INTERVAL)
+{}
+
+void WindowLimit::onAccepted()
+{
+    m_value = std::min(m_value + 1 / m_value, m_maximum);
+}
+
+void WindowLimit::onThrottled(RateLimiter::Clock::time_point now)
+{
+    if (now - m_lastDecrease < RateLimiter::DECREASE_INTERVAL) return;
+
+    m_value = std::max(1.0, m_value / 2);
+    m_lastDecrease = now;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <chrono>
+#include <mutex>
+
+
+// Ограничитель скорости отправки: ведро токенов с настраиваемым запасом
+// (burst) и AIMD-подстройкой. Ответ SMSC "слишком часто" (ESME_RTHROTTLED,
+// ESME_RMSGQFUL) делит скорость пополам, каждое успешное подтверждение
+// прибавляет increase / rate, то есть около increase сообщений в секунду за
+// секунду без отказов. Так скорость держится чуть ниже потолка SMSC.
+//
+// Потокобезопасен: общий ограничитель пула берут сессии из разных потоков.
+class RateLimiter
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Settings
+    {
+        // сообщений в секунду; 0 - без ограничения (и без подстройки)
+        double rate = 0;
+        // сколько сообщений можно отправить подряд после простоя
+        double burst = 1;
+        // ниже этой скорости AIMD не опускается
+        double minRate = 1;
+        // прирост скорости за секунду без отказов
+        double increase = 1;
+    };
+
+    explicit RateLimiter(const Settings& settings);
+
+    bool isLimited() const { return m_settings.rate > 0; }
+
+    // Clock::duration::zero() - токен взят, иначе сколько ждать следующего
+    Clock::duration acquire(Clock::time_point now);
+    // вернуть взятый токен, если отправка не состоялась
+    void refund();
+
+    void onAccepted();
+    // Отказ по перегрузке. Отказы на сообщения, ушедшие до предыдущего
+    // снижения, вызваны той же перегрузкой, поэтому скорость снижается не
+    // чаще раза за DECREASE_INTERVAL.
+    void onThrottled(Clock::time_point now);
+
+    double rate() const;
+
+    static const Clock::duration DECREASE_INTERVAL;
+
+private:
+    void refill(Clock::time_point now);
+
+private:
+    mutable std::mutex m_mutex;
+    Settings m_settings;
+    double m_rate;
+    double m_tokens;
+    Clock::time_point m_updated;
+    Clock::time_point m_lastDecrease;
+};
+
+
+// Та же AIMD-подстройка для размера окна: +1/limit за каждый успешный
+// ответ (около +1 за круг окна), половина при перегрузке. Живёт в потоке
+// сессии.
+class WindowLimit
+{
+public:
+    explicit WindowLimit(unsigned maximum);
+
+    unsigned value() const { return unsigned(m_value); }
+
+    void onAccepted();
+    void onThrottled(RateLimiter::Clock::time_point now);
+
+private:
+    double m_value;
+    double m_maximum;
+    RateLimiter::Clock::time_point m_lastDecrease;
+};
@@ -0,0 +1,316 @@
+#include "Reactor.h"
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include <future>
+#include <system_error>
+
+
+namespace {
+    const int MAX_EVENTS = 256;
+
+    // в data.u64 события: поколение регистрации и дескриптор, чтобы событие
+    // для закрытого и заново открытого дескриптора не попало чужому обработчику
+    std::uint64_t watchKey(std::uint32_t generation, int fd)
+    {
+        return (std::uint64_t(generation) << 32) | std::uint32_t(fd);
+    }
+}
+
+
+Reactor::Reactor()
+    : m_epoll(-1)
+    , m_wakeFd(-1)
+    , m_stopRequested(false)
+    , m_state(State::NotStarted)
+    , m_nextGeneration(1)
+    , m_nextId(1)
+{
+    m_epoll = epoll_create1(EPOLL_CLOEXEC);
+    if (m_epoll < 0) throw std::system_error(errno, std::generic_category(), "epoll_create1");
+
+    m_wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (m_wakeFd < 0) {
+        int error = errno;
+        ::close(m_epoll);
+        throw std::system_error(error, std::generic_category(), "eventfd");
+    }
+
+    epoll_event event {};
+    event.events = EPOLLIN | EPOLLET;
+    event.data.u64 = watchKey(0, m_wakeFd);
+    epoll_ctl(m_epoll, EPOLL_CTL_ADD, m_wakeFd, &event);
+}
+
+Reactor::~Reactor()
+{
+    for (auto& connect: m_connects) ::close(connect.second.fd);
+    ::close(m_wakeFd);
+    ::close(m_epoll);
+}
+
+void Reactor::run()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_postedMutex);
+        m_state = State::Running;
+        m_loopThread = std::this_thread::get_id();
+    }
+
+    epoll_event events[MAX_EVENTS];
+    while (!m_stopRequested.load()) {
+        int count = epoll_wait(m_epoll, events, MAX_EVENTS, nextTimeout());
+        if (count < 0 && errno != EINTR) {
+            int error = errno;
+            finish();
+            throw std::system_error(error, std::generic_category(), "epoll_wait");
+        }
+
+        for (int i = 0; i < count; ++i) {
+            if (int(std::uint32_t(events[i].data.u64)) == m_wakeFd) {
+                std::uint64_t value;
+                while (read(m_wakeFd, &value, sizeof(value)) > 0) {}
+            }
+            else dispatch(events[i].data.u64, events[i].events);
+        }
+        runTimers();
+        runPosted();
+    }
+    finish();
+}
+
+void Reactor::stop()
+{
+    m_stopRequested.store(true);
+    wakeUp();
+}
+
+bool Reactor::isInLoopThread() const
+{
+    std::lock_guard<std::mutex> lock(m_postedMutex);
+    return m_loopThread == std::this_thread::get_id();
+}
+
+void Reactor::post(Task task)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_postedMutex);
+        if (m_state != State::Finished) {
+            m_posted.push_back(std::move(task));
+            task = nullptr;
+        }
+    }
+    if (task) task();
+    else wakeUp();
+}
+
+void Reactor::invoke(const Task& task)
+{
+    if (isInLoopThread()) {
+        task();
+        return;
+    }
+
+    std::promise<void> done;
+    post([&task, &done] {
+        task();
+        done.set_value();
+    });
+    done.get_future().wait();
+}
+
+bool Reactor::watch(int fd, std::uint32_t events, IoHandler handler)
+{
+    Watch watch {m_nextGeneration++, std::make_shared<IoHandler>(std::move(handler))};
+
+    epoll_event event {};
+    event.events = events | EPOLLET;
+    event.data.u64 = watchKey(watch.generation, fd);
+    if (epoll_ctl(m_epoll, EPOLL_CTL_ADD, fd, &event) != 0) return false;
+
+    m_watches[fd] = std::move(watch);
+    return true;
+}
+
+bool Reactor::modify(int fd, std::uint32_t events)
+{
+    auto it = m_watches.find(fd);
+    if (it == m_watches.end()) return false;
+
+    epoll_event event {};
+    event.events = events | EPOLLET;
+    event.data.u64 = watchKey(it->second.generation, fd);
+    return epoll_ctl(m_epoll, EPOLL_CTL_MOD, fd, &event) == 0;
+}
+
+void Reactor::unwatch(int fd)
+{
+    if (m_watches.erase(fd)) epoll_ctl(m_epoll, EPOLL_CTL_DEL, fd, nullptr);
+}
+
+Reactor::Id Reactor::startTimer(std::chrono::milliseconds delay,
+                                Task task,
+                                std::chrono::milliseconds interval)
+{
+    Id id = m_nextId++;
+    Timer timer {Clock::now() + delay, interval, std::make_shared<Task>(std::move(task))};
+    m_timerQueue.emplace(timer.deadline, id);
+    m_timers.emplace(id, std::move(timer));
+    return id;
+}
+
+void Reactor::cancelTimer(Id id)
+{
+    // запись в очереди остаётся и пропускается, когда до неё дойдёт черёд
+    m_timers.erase(id);
+}
+
+Reactor::Id Reactor::connectAsync(const sockaddr_in& address,
+                                  std::chrono::milliseconds timeout,
+                                  ConnectHandler handler)
+{
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        handler(-1, errno);
+        return 0;
+    }
+
+    if (::connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0) {
+        handler(fd, 0);
+        return 0;
+    }
+    if (errno != EINPROGRESS) {
+        int error = errno;
+        ::close(fd);
+        handler(-1, error);
+        return 0;
+    }
+
+    Id id = m_nextId++;
+    Id timer = startTimer(timeout, [this, id] { finishConnect(id, ETIMEDOUT); });
+    watch(fd, EPOLLOUT, [this, id, fd](std::uint32_t) {
+        int error = 0;
+        socklen_t length = sizeof(error);
+        if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &length) != 0) error = errno;
+        finishConnect(id, error);
+    });
+    m_connects.emplace(id, PendingConnect {fd, timer, std::move(handler)});
+    return id;
+}
+
+void Reactor::cancelConnect(Id id)
+{
+    auto it = m_connects.find(id);
+    if (it == m_connects.end()) return;
+
+    unwatch(it->second.fd);
+    cancelTimer(it->second.timer);
+    ::close(it->second.fd);
+    m_connects.erase(it);
+}
+
+int Reactor::nextTimeout() const
+{
+    {
+        std::lock_guard<std::mutex> lock(m_postedMutex);
+        if (!m_posted.empty()) return 0;
+    }
+    if (m_timerQueue.empty()) return -1;
+
+    auto left = m_timerQueue.top().first - Clock::now();
+    if (left <= Clock::duration::zero()) return 0;
+    // округление вверх, чтобы не проснуться за миг до срока и не крутиться вхолостую
+    return int(std::chrono::duration_cast<std::chrono::milliseconds>(left + std::chrono::milliseconds(1) - Clock::duration(1)).count());
+}
+
+void Reactor::dispatch(std::uint64_t key, std::uint32_t events)
+{
+    int fd = int(std::uint32_t(key));
+    auto it = m_watches.find(fd);
+    if (it == m_watches.end() || watchKey(it->second.generation, fd) != key) return;
+
+    // копия держит обработчик живым, даже если он снимет сам себя
+    std::shared_ptr<IoHandler> handler = it->second.handler;
+    (*handler)(events);
+}
+
+void Reactor::runTimers()
+{
+    const Clock::time_point now = Clock::now();
+    while (!m_timerQueue.empty() && m_timerQueue.top().first <= now) {
+        TimerEntry entry = m_timerQueue.top();
+        m_timerQueue.pop();
+
+        auto it = m_timers.find(entry.second);
+        if (it == m_timers.end() || it->second.deadline != entry.first) continue;
+
+        std::shared_ptr<Task> task = it->second.task;
+        if (it->second.interval > Clock::duration::zero()) {
+            it->second.deadline = now + it->second.interval;
+            m_timerQueue.emplace(it->second.deadline, entry.second);
+        }
+        else m_timers.erase(it);
+        (*task)();
+    }
+}
+
+bool Reactor::runPosted()
+{
+    std::vector<Task> tasks;
+    {
+        std::lock_guard<std::mutex> lock(m_postedMutex);
+        tasks.swap(m_posted);
+    }
+    for (Task& task: tasks) task();
+    return !tasks.empty();
+}
+
+void Reactor::finish()
+{
+    // Задачи, поставленные до остановки, выполняются здесь, а после смены
+    // состояния - сразу у того, кто их ставит. Проверка очереди и смена
+    // состояния - под одной блокировкой, иначе задача, поставленная между
+    // ними, не выполнится никогда.
+    for (;;) {
+        std::vector<Task> tasks;
+        {
+            std::lock_guard<std::mutex> lock(m_postedMutex);
+            if (m_posted.empty()) {
+                m_state = State::Finished;
+                m_loopThread = std::thread::id();
+                return;
+            }
+            tasks.swap(m_posted);
+        }
+        for (Task& task: tasks) task();
+    }
+}
+
+void Reactor::wakeUp()
+{
+    std::uint64_t value = 1;
+    if (write(m_wakeFd, &value, sizeof(value)) < 0) {
+        // EAGAIN: счётчик переполнен, цикл и так проснётся
+    }
+}
+
+void Reactor::finishConnect(Id id, int error)
+{
+    auto it = m_connects.find(id);
+    if (it == m_connects.end()) return;
+
+    PendingConnect connect = std::move(it->second);
+    m_connects.erase(it);
+    unwatch(connect.fd);
+    cancelTimer(connect.timer);
+
+    if (error) {
+        ::close(connect.fd);
+        connect.handler(-1, error);
+    }
+    else connect.handler(connect.fd, 0);
+}
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <netinet/in.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+
+// Цикл событий на epoll в режиме edge-triggered: один поток обслуживает
+// сокеты многих сессий, таймеры и задачи из других потоков.
+//
+// Обработчик сокета вызывается, только когда состояние меняется, поэтому
+// читать и писать надо до EAGAIN. watch/unwatch, таймеры и connectAsync
+// вызываются только в потоке цикла (из других потоков - через post или
+// invoke). Обработчики можно снимать прямо во время их вызова.
+class Reactor
+{
+public:
+    using Task = std::function<void()>;
+    // events - маска EPOLLIN, EPOLLOUT, EPOLLRDHUP, EPOLLERR, EPOLLHUP
+    using IoHandler = std::function<void(std::uint32_t events)>;
+    // fd - подключённый неблокирующий сокет или -1, error - errno при неудаче
+    using ConnectHandler = std::function<void(int fd, int error)>;
+    using Id = std::uint64_t;
+
+    // бросает std::system_error, если не удалось создать epoll или eventfd
+    Reactor();
+    ~Reactor();
+
+    Reactor(const Reactor&) = delete;
+    Reactor& operator=(const Reactor&) = delete;
+
+    // Крутит цикл в текущем потоке до stop(). Если epoll_wait отказал не
+    // из-за сигнала, цикл завершается как после stop() и бросает
+    // std::system_error.
+    void run();
+    // можно вызывать из любого потока; незавершённые задачи post
+    // выполняются перед выходом из run()
+    void stop();
+    bool isInLoopThread() const;
+
+    // Выполнить задачу в потоке цикла. После выхода из run() задачи
+    // выполняются сразу в вызывающем потоке, так что очистка при завершении
+    // не теряется.
+    void post(Task task);
+    // то же, но дождаться выполнения (в потоке цикла - выполняется сразу)
+    void invoke(const Task& task);
+
+    // fd должен быть неблокирующим, к events добавляется EPOLLET
+    bool watch(int fd, std::uint32_t events, IoHandler handler);
+    bool modify(int fd, std::uint32_t events);
+    void unwatch(int fd);
+
+    // interval > 0 - повторяющийся таймер
+    Id startTimer(std::chrono::milliseconds delay,
+                  Task task,
+                  std::chrono::milliseconds interval = std::chrono::milliseconds(0));
+    void cancelTimer(Id id);
+
+    // Неблокирующее подключение с ограничением времени. handler вызывается
+    // ровно один раз (при немедленной ошибке - прямо из connectAsync), если
+    // подключение не отменено через cancelConnect.
+    Id connectAsync(const sockaddr_in& address,
+                    std::chrono::milliseconds timeout,
+                    ConnectHandler handler);
+    // закрывает незавершённое подключение без вызова обработчика
+    void cancelConnect(Id id);
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    enum class State { NotStarted, Running, Finished };
+
+    struct Watch
+    {
+        std::uint32_t generation;
+        std::shared_ptr<IoHandler> handler;
+    };
+
+    struct Timer
+    {
+        Clock::time_point deadline;
+        Clock::duration interval;
+        std::shared_ptr<Task> task;
+    };
+
+    struct PendingConnect
+    {
+        int fd;
+        Id timer;
+        ConnectHandler handler;
+    };
+
+    using TimerEntry = std::pair<Clock::time_point, Id>;
+
+    int nextTimeout() const;
+    void dispatch(std::uint64_t key, std::uint32_t events);
+    void runTimers();
+    bool runPosted();
+    // выполняет оставшиеся задачи и переводит цикл в State::Finished
+    void finish();
+    void wakeUp();
+    void finishConnect(Id id, int error);
+
+private:
+    int m_epoll;
+    int m_wakeFd;
+    std::atomic<bool> m_stopRequested;
+
+    mutable std::mutex m_postedMutex;
+    State m_state;
+    std::thread::id m_loopThread;
+    std::vector<Task> m_posted;
+
+    std::unordered_map<int, Watch> m_watches;
+    std::uint32_t m_nextGeneration;
+
+    std::unordered_map<Id, Timer> m_timers;
+    std::priority_queue<TimerEntry, std::vector<TimerEntry>, std::greater<TimerEntry>> m_timerQueue;
+    std::unordered_map<Id, PendingConnect> m_connects;
+    Id m_nextId;
+};
@@ -0,0 +1,36 @@
+#include "ReactorPool.h"
+
+#include <algorithm>
+
+
+ReactorPool::ReactorPool(std::size_t threadCount)
+    : m_next(0)
+{
+    if (threadCount == 0) threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+    for (std::size_t i = 0; i < threadCount; ++i) m_reactors.emplace_back(new Reactor);
+    for (auto& reactor: m_reactors) m_threads.emplace_back(&Reactor::run, reactor.get());
+}
+
+ReactorPool::~ReactorPool()
+{
+    stop();
+}
+
+Reactor& ReactorPool::next()
+{
+    return *m_reactors[m_next.fetch_add(1, std::memory_order_relaxed) % m_reactors.size()];
+}
+
+std::size_t ReactorPool::size() const
+{
+    return m_reactors.size();
+}
+
+void ReactorPool::stop()
+{
+    for (auto& reactor: m_reactors) reactor->stop();
+    for (auto& thread: m_threads) {
+        if (thread.joinable()) thread.join();
+    }
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "Reactor.h"
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <thread>
+#include <vector>
+
+
+// Несколько циклов Reactor, каждый в своём потоке (по умолчанию по одному на
+// ядро). Сессии раздаются по кругу и дальше живут в одном потоке, так что
+// внутри сессии синхронизация не нужна.
+class ReactorPool
+{
+public:
+    // threadCount == 0 - по числу ядер
+    explicit ReactorPool(std::size_t threadCount = 0);
+    // останавливает циклы и дожидается потоков
+    ~ReactorPool();
+
+    ReactorPool(const ReactorPool&) = delete;
+    ReactorPool& operator=(const ReactorPool&) = delete;
+
+    Reactor& next();
+    std::size_t size() const;
+    void stop();
+
+private:
+    std::vector<std::unique_ptr<Reactor>> m_reactors;
+    std::vector<std::thread> m_threads;
+    std::atomic<std::size_t> m_next;
+};
@@ -0,0 +1,62 @@
+#include "RingBuffer.h"
+
+#include <sys/mman.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include <system_error>
+
+
+namespace {
+    std::size_t roundUpToPowerOfTwo(std::size_t value)
+    {
+        std::size_t result = 1;
+        while (result < value) result <<= 1;
+        return result;
+    }
+}
+
+
+RingBuffer::RingBuffer(std::size_t capacity)
+    : m_data(nullptr)
+    , m_capacity(0)
+    , m_readPosition(0)
+    , m_writePosition(0)
+{
+    // степень двойки не меньше страницы: смещение берётся по маске, а
+    // отображать можно только целые страницы
+    const std::size_t pageSize = std::size_t(sysconf(_SC_PAGESIZE));
+    m_capacity = roundUpToPowerOfTwo(capacity < pageSize ? pageSize : capacity);
+
+    int memory = memfd_create("smpp-ring", MFD_CLOEXEC);
+    if (memory < 0) throw std::system_error(errno, std::generic_category(), "memfd_create");
+    if (ftruncate(memory, off_t(m_capacity)) != 0) {
+        int error = errno;
+        ::close(memory);
+        throw std::system_error(error, std::generic_category(), "ftruncate");
+    }
+
+    // резервируем 2 * capacity адресов и кладём в обе половины один и тот же файл
+    void* area = mmap(nullptr, 2 * m_capacity, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (area == MAP_FAILED) {
+        int error = errno;
+        ::close(memory);
+        throw std::system_error(error, std::generic_category(), "mmap");
+    }
+    char* base = static_cast<char*>(area);
+    if (mmap(base, m_capacity, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, memory, 0) == MAP_FAILED
+        || mmap(base + m_capacity, m_capacity, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, memory, 0) == MAP_FAILED) {
+        int error = errno;
+        munmap(area, 2 * m_capacity);
+        ::close(memory);
+        throw std::system_error(error, std::generic_category(), "mmap");
+    }
+    // отображения держат файл сами
+    ::close(memory);
+    m_data = base;
+}
+
+RingBuffer::~RingBuffer()
+{
+    munmap(m_data, 2 * m_capacity);
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+
+// Кольцевой буфер байтов, отображённый в память дважды подряд: любой участок
+// длиной до capacity() лежит непрерывно, даже если переходит через конец
+// кольца. Поэтому и запись из сокета, и выдача PDU наружу обходятся без
+// копирования и без склейки кусков.
+class RingBuffer
+{
+public:
+    // capacity округляется вверх до размера страницы; бросает
+    // std::system_error, если не удалось отобразить память
+    explicit RingBuffer(std::size_t capacity);
+    ~RingBuffer();
+
+    RingBuffer(const RingBuffer&) = delete;
+    RingBuffer& operator=(const RingBuffer&) = delete;
+
+    std::size_t capacity() const { return m_capacity; }
+
+    // занятые байты, начиная с самого старого
+    const char* readPointer() const { return m_data + (m_readPosition & (m_capacity - 1)); }
+    std::size_t readable() const { return std::size_t(m_writePosition - m_readPosition); }
+    void consume(std::size_t size) { m_readPosition += size; }
+
+    // свободное место сразу за последним записанным байтом
+    char* writePointer() { return m_data + (m_writePosition & (m_capacity - 1)); }
+    std::size_t writable() const { return m_capacity - readable(); }
+    void commit(std::size_t size) { m_writePosition += size; }
+
+    void clear() { m_readPosition = m_writePosition = 0; }
+
+private:
+    char* m_data;
+    std::size_t m_capacity;
+    // счётчики растут неограниченно, смещение в кольце - по маске
+    std::uint64_t m_readPosition;
+    std::uint64_t m_writePosition;
+};
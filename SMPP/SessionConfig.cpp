@@ -0,0 +1,155 @@
+#include "SessionConfig.h"
+
+#include <QSettings>
+
+
+namespace {
+    const QString DEFAULT_HOSTNAME = "xml55.smstec.ru";
+    const quint16 DEFAULT_PORT = 3333;
+    const QString DEFAULT_LOGIN = "Test";
+    const QString DEFAULT_PASSWORD = "Test";
+    const QString DEFAULT_SYSTEM_TYPE = "WWW";
+    const quint8 DEFAULT_SMPP_VERSION = 34;
+    const quint32 DEFAULT_MAX_PDU_LENGTH = PDUReader::DEFAULT_MAX_PDU_LENGTH;
+    const quint32 DEFAULT_WINDOW_SIZE = 10;
+    const quint32 DEFAULT_SUBMIT_QUEUE_LIMIT = 1000;
+    const quint32 DEFAULT_RESPONSE_TIMEOUT_MS = 30000;
+    const quint32 DEFAULT_BINDS = 1;
+    const quint32 DEFAULT_ENQUIRE_LINK_INTERVAL_MS = 30000;
+    const quint32 DEFAULT_RECONNECT_DELAY_MS = 500;
+    const quint32 DEFAULT_MAX_RECONNECT_DELAY_MS = 30000;
+    // 0 - без ограничения
+    const double DEFAULT_RATE = 0;
+    const double DEFAULT_BURST = 10;
+    const double DEFAULT_MIN_RATE = 1;
+    const double DEFAULT_RATE_INCREASE = 1;
+
+    quint32 readUInt(const QSettings& setting, const QString& key, quint32 defaultValue)
+    {
+        bool parsed = false;
+        quint32 result = setting.value(key, defaultValue).toUInt(&parsed);
+        return parsed ? result : defaultValue;
+    }
+
+    double readDouble(const QSettings& setting, const QString& key, double defaultValue)
+    {
+        bool parsed = false;
+        double result = setting.value(key, defaultValue).toDouble(&parsed);
+        return parsed && result >= 0 ? result : defaultValue;
+    }
+
+    // prefix "pool": rate -> poolRate, minRate -> poolMinRate
+    RateLimiter::Settings readRate(const QSettings& setting, const QString& prefix, const RateLimiter::Settings& base)
+    {
+        auto key = [&prefix](const QString& name) {
+            return prefix.isEmpty() ? name : prefix + name.left(1).toUpper() + name.mid(1);
+        };
+
+        RateLimiter::Settings result;
+        result.rate = readDouble(setting, key("rate"), base.rate);
+        result.burst = readDouble(setting, key("burst"), base.burst);
+        result.minRate = readDouble(setting, key("minRate"), base.minRate);
+        result.increase = readDouble(setting, key("rateIncrease"), base.increase);
+        return result;
+    }
+
+    RateLimiter::Settings defaultRate()
+    {
+        RateLimiter::Settings result;
+        result.rate = DEFAULT_RATE;
+        result.burst = DEFAULT_BURST;
+        result.minRate = DEFAULT_MIN_RATE;
+        result.increase = DEFAULT_RATE_INCREASE;
+        return result;
+    }
+
+    // ключи текущей группы или массива поверх base
+    SessionConfig readSession(const QSettings& setting, const SessionConfig& base)
+    {
+        SessionConfig result = base;
+        result.hostname = setting.value("hostname", base.hostname).toString();
+        result.port = quint16(readUInt(setting, "port", base.port));
+        result.login = setting.value("login", base.login).toString();
+        result.password = setting.value("password", base.password).toString();
+        result.systemType = setting.value("systemType", base.systemType).toString();
+        result.smmpVersion = quint8(readUInt(setting, "smmpVersion", base.smmpVersion));
+        result.maxPDULength = readUInt(setting, "maxPDULength", base.maxPDULength);
+        result.window.size = readUInt(setting, "windowSize", base.window.size);
+        result.window.queueLimit = readUInt(setting, "submitQueueLimit", base.window.queueLimit);
+        result.window.timeout = std::chrono::milliseconds(readUInt(setting, "responseTimeoutMs",
+                                                                   quint32(base.window.timeout.count())));
+        result.rate = readRate(setting, "", base.rate);
+        result.enquireLinkInterval = std::chrono::milliseconds(readUInt(setting, "enquireLinkIntervalMs",
+                                                                        quint32(base.enquireLinkInterval.count())));
+        result.reconnectDelay = std::chrono::milliseconds(readUInt(setting, "reconnectDelayMs",
+                                                                   quint32(base.reconnectDelay.count())));
+        result.maxReconnectDelay = std::chrono::milliseconds(readUInt(setting, "maxReconnectDelayMs",
+                                                                      quint32(base.maxReconnectDelay.count())));
+        return result;
+    }
+}
+
+
+QList<SessionConfig> SessionConfig::readAll(QSettings& settings)
+{
+    SessionConfig defaults;
+    defaults.hostname = DEFAULT_HOSTNAME;
+    defaults.port = DEFAULT_PORT;
+    defaults.login = DEFAULT_LOGIN;
+    defaults.password = DEFAULT_PASSWORD;
+    defaults.systemType = DEFAULT_SYSTEM_TYPE;
+    defaults.smmpVersion = DEFAULT_SMPP_VERSION;
+    defaults.maxPDULength = DEFAULT_MAX_PDU_LENGTH;
+    defaults.window.size = DEFAULT_WINDOW_SIZE;
+    defaults.window.queueLimit = DEFAULT_SUBMIT_QUEUE_LIMIT;
+    defaults.window.timeout = std::chrono::milliseconds(DEFAULT_RESPONSE_TIMEOUT_MS);
+    defaults.rate = defaultRate();
+    defaults.enquireLinkInterval = std::chrono::milliseconds(DEFAULT_ENQUIRE_LINK_INTERVAL_MS);
+    defaults.reconnectDelay = std::chrono::milliseconds(DEFAULT_RECONNECT_DELAY_MS);
+    defaults.maxReconnectDelay = std::chrono::milliseconds(DEFAULT_MAX_RECONNECT_DELAY_MS);
+
+    const SessionConfig common = readSession(settings, defaults);
+    const quint32 commonBinds = readUInt(settings, "binds", DEFAULT_BINDS);
+
+    QList<SessionConfig> result;
+    const int hostCount = settings.beginReadArray("hosts");
+    for (int i = 0; i < hostCount; ++i) {
+        settings.setArrayIndex(i);
+        const SessionConfig host = readSession(settings, common);
+        const quint32 binds = readUInt(settings, "binds", commonBinds);
+        for (quint32 bind = 0; bind < binds; ++bind) result.append(host);
+    }
+    settings.endArray();
+
+    if (hostCount == 0) {
+        for (quint32 bind = 0; bind < commonBinds; ++bind) result.append(common);
+    }
+    return result;
+}
+
+RateLimiter::Settings SessionConfig::readPoolRate(const QSettings& settings)
+{
+    return readRate(settings, "pool", defaultRate());
+}
+
+void SessionConfig::writeDefaults(QSettings& settings)
+{
+    settings.setValue("hostname", DEFAULT_HOSTNAME);
+    settings.setValue("port", DEFAULT_PORT);
+    settings.setValue("login", DEFAULT_LOGIN);
+    settings.setValue("password", DEFAULT_PASSWORD);
+    settings.setValue("systemType", DEFAULT_SYSTEM_TYPE);
+    settings.setValue("smmpVersion", DEFAULT_SMPP_VERSION);
+    settings.setValue("maxPDULength", DEFAULT_MAX_PDU_LENGTH);
+    settings.setValue("windowSize", DEFAULT_WINDOW_SIZE);
+    settings.setValue("submitQueueLimit", DEFAULT_SUBMIT_QUEUE_LIMIT);
+    settings.setValue("responseTimeoutMs", DEFAULT_RESPONSE_TIMEOUT_MS);
+    settings.setValue("binds", DEFAULT_BINDS);
+    settings.setValue("enquireLinkIntervalMs", DEFAULT_ENQUIRE_LINK_INTERVAL_MS);
+    settings.setValue("reconnectDelayMs", DEFAULT_RECONNECT_DELAY_MS);
+    settings.setValue("maxReconnectDelayMs", DEFAULT_MAX_RECONNECT_DELAY_MS);
+    settings.setValue("rate", DEFAULT_RATE);
+    settings.setValue("burst", DEFAULT_BURST);
+    settings.setValue("poolRate", DEFAULT_RATE);
+    settings.setValue("poolBurst", DEFAULT_BURST);
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <QList>
+#include <QString>
+
+#include "PDUReader.h"
+#include "RateLimiter.h"
+#include "SubmitWindow.h"
+
+class QSettings;
+
+
+// Параметры одного bind к SMSC
+struct SessionConfig
+{
+    QString hostname;
+    quint16 port = 3333;
+    QString login;
+    QString password;
+    QString systemType;
+    quint8 smmpVersion = 34;
+    quint32 maxPDULength = PDUReader::DEFAULT_MAX_PDU_LENGTH;
+    SubmitWindow::Settings window;
+    RateLimiter::Settings rate;
+    // enquire_link после такого простоя; 0 - не отправлять
+    std::chrono::milliseconds enquireLinkInterval = std::chrono::milliseconds(30000);
+    // первая пауза перед переподключением, дальше она удваивается до максимума
+    std::chrono::milliseconds reconnectDelay = std::chrono::milliseconds(500);
+    std::chrono::milliseconds maxReconnectDelay = std::chrono::milliseconds(30000);
+
+    // Все bind из config.ini. Общие ключи верхнего уровня задают значения
+    // по умолчанию; binds - сколько параллельных bind открыть на хост.
+    // Несколько хостов задаются массивом hosts (hosts/1/hostname,
+    // hosts/1/port, hosts/1/binds, ...), без него берётся hostname:port.
+    static QList<SessionConfig> readAll(QSettings& settings);
+    // общий предел пула: poolRate, poolBurst, poolMinRate, poolRateIncrease
+    static RateLimiter::Settings readPoolRate(const QSettings& settings);
+    static void writeDefaults(QSettings& settings);
+};
@@ -0,0 +1,102 @@
+#include "SessionPool.h"
+
+#include <QDebug>
+
+#include <algorithm>
+#include <memory>
+
+
+SessionPool::SessionPool(ReactorPool& reactors,
+                         const QList<SessionConfig>& sessions,
+                         const RateLimiter::Settings& rate,
+                         QObject* parent)
+    : QObject(parent)
+    , m_openSessions(0)
+    , m_closing(false)
+{
+    std::shared_ptr<RateLimiter> poolLimiter;
+    if (rate.rate > 0) poolLimiter = std::make_shared<RateLimiter>(rate);
+
+    for (const SessionConfig& config: sessions) {
+        ESMETransceiver* session = new ESMETransceiver(reactors.next(), config, poolLimiter, this);
+        session->setOrphanHandler([this](Submission&& submission) { redistribute(std::move(submission)); });
+        connect(session, &ESMETransceiver::close, this, &SessionPool::onSessionClosed);
+        connect(session, &ESMETransceiver::readyToSubmit, this, &SessionPool::readyToSubmit);
+        m_sessions.append(session);
+        ++m_openSessions;
+    }
+    if (m_sessions.isEmpty()) {
+        qWarning() << tr("No SMPP binds are configured");
+        QMetaObject::invokeMethod(this, "close", Qt::QueuedConnection);
+    }
+}
+
+SessionPool::~SessionPool()
+{
+    // При закрытии всего пула перекладывать сообщения уже некуда.
+    // setOrphanHandler выполняется в потоке цикла сессии, поэтому после него
+    // её redistribute не идёт и не начнётся, и удалять сессии, по которым он
+    // ходит, безопасно.
+    m_closing.store(true);
+    for (ESMETransceiver* session: m_sessions) session->setOrphanHandler(nullptr);
+    qDeleteAll(m_sessions);
+}
+
+bool SessionPool::submit(OutboundMessage message, SubmitCallback callback)
+{
+    // Свободное место могло кончиться между выбором и submit (сессию
+    // заполняют и другие производители), тогда пробуется следующая. Если
+    // места нет нигде, отказ каждой сессии обещает readyToSubmit.
+    for (ESMETransceiver* session: candidates()) {
+        if (session->trySubmit(message, callback)) return true;
+    }
+    return false;
+}
+
+void SessionPool::unbind()
+{
+    // остальные сессии тоже закрываются, перекладывать сообщения некуда
+    m_closing.store(true);
+    for (ESMETransceiver* session: m_sessions) session->unbind();
+}
+
+std::vector<ESMETransceiver*> SessionPool::candidates() const
+{
+    // Пока bind нет ни у одной сессии, сообщения ждут в очереди ещё не
+    // связанных. Пределы окна и очереди у сессий разные, поэтому сравнивается
+    // свободное место, а не загрузка.
+    struct Candidate
+    {
+        ESMETransceiver* session;
+        bool bound;
+        quint32 free;
+    };
+    std::vector<Candidate> ranked;
+    for (ESMETransceiver* session: m_sessions) {
+        if (session->isFinished() || session->isUnbinding()) continue;
+        ranked.push_back(Candidate {session, session->isBound(), session->freeCapacity()});
+    }
+    std::stable_sort(ranked.begin(), ranked.end(), [](const Candidate& left, const Candidate& right) {
+        return left.bound != right.bound ? left.bound : left.free > right.free;
+    });
+
+    std::vector<ESMETransceiver*> result;
+    result.reserve(ranked.size());
+    for (const Candidate& candidate: ranked) result.push_back(candidate.session);
+    return result;
+}
+
+void SessionPool::redistribute(Submission&& submission)
+{
+    // вызывается в потоке цикла оборвавшейся сессии; submit у остальных
+    // потокобезопасен
+    SubmitCallback callback = submission.callback;
+    if (m_closing.load() || !submit(std::move(submission.message), std::move(submission.callback))) {
+        if (callback) callback(SubmitResult {SubmitResult::Aborted, 0, std::string()});
+    }
+}
+
+void SessionPool::onSessionClosed()
+{
+    if (--m_openSessions == 0) emit close();
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <QObject>
+#include <QList>
+
+#include "ESMETransceiver.h"
+#include "RateLimiter.h"
+#include "ReactorPool.h"
+#include "SessionConfig.h"
+
+#include <atomic>
+#include <vector>
+
+
+// Несколько параллельных bind (возможно, к разным SMSC), сессии раздаются
+// по потокам ReactorPool. Сообщение уходит в связанную сессию с наибольшим
+// свободным местом (окно и очередь у каждого SMSC свои). Пока сессия переподключается, её
+// сообщения ждут нового bind; когда сессия закрывается насовсем, её очередь
+// и окно раскладываются по остальным, а не теряются. Общий предел
+// скорости rate делят все сессии пула, у каждой есть и свой.
+class SessionPool: public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit SessionPool(ReactorPool& reactors,
+                         const QList<SessionConfig>& sessions,
+                         const RateLimiter::Settings& rate = RateLimiter::Settings(),
+                         QObject* parent = nullptr);
+    virtual ~SessionPool();
+
+    // можно вызывать из любого потока; false - все сессии заполнены или
+    // закрыты, о свободном месте сообщит readyToSubmit
+    bool submit(OutboundMessage message, SubmitCallback callback);
+
+    int size() const { return m_sessions.size(); }
+
+public slots:
+    // unbind всех сессий; close - когда все закроются
+    void unbind();
+
+signals:
+    // закрылись все сессии
+    void close();
+    void readyToSubmit();
+
+private:
+    // открытые сессии: сначала связанные, среди них - у кого больше места
+    std::vector<ESMETransceiver*> candidates() const;
+    void redistribute(Submission&& submission);
+    void onSessionClosed();
+
+private:
+    QList<ESMETransceiver*> m_sessions;
+    int m_openSessions;
+    std::atomic<bool> m_closing;
+};
@@ -0,0 +1,109 @@
+#include "SubmitWindow.h"
+
+#include <algorithm>
+#include <assert.h>
+
+
+SubmitWindow::SubmitWindow(const Settings& settings)
+    : m_settings(settings)
+    , m_mask(0)
+    , m_nextSequenceNumber(1)
+    , m_outstanding(0)
+{
+    m_settings.size = std::max<std::uint32_t>(1, m_settings.size);
+
+    std::uint32_t capacity = 1;
+    while (capacity < 2 * m_settings.size) capacity <<= 1;
+    m_slots.resize(capacity);
+    for (Slot& slot: m_slots) slot.sequenceNumber = 0;
+    m_mask = capacity - 1;
+}
+
+std::uint32_t SubmitWindow::nextSequenceNumber() const
+{
+    // занято меньше половины слотов, так что свободный находится сразу
+    std::uint32_t result = m_nextSequenceNumber;
+    while (slot(result).sequenceNumber != 0) result = following(result);
+    return result;
+}
+
+std::uint32_t SubmitWindow::takeSequenceNumber()
+{
+    const std::uint32_t result = nextSequenceNumber();
+    m_nextSequenceNumber = following(result);
+    return result;
+}
+
+void SubmitWindow::open(std::uint32_t sequenceNumber, Submission&& submission, Clock::time_point now)
+{
+    Slot& target = slot(sequenceNumber);
+    assert(target.sequenceNumber == 0);
+
+    target.sequenceNumber = sequenceNumber;
+    target.deadline = now + m_settings.timeout;
+    target.submission = std::move(submission);
+    m_order.push_back(sequenceNumber);
+    m_nextSequenceNumber = following(sequenceNumber);
+    ++m_outstanding;
+}
+
+bool SubmitWindow::complete(std::uint32_t sequenceNumber, Submission& submission)
+{
+    Slot& target = slot(sequenceNumber);
+    if (sequenceNumber == 0 || target.sequenceNumber != sequenceNumber) return false;
+
+    submission = std::move(target.submission);
+    release(target);
+    dropCompletedHead();
+    return true;
+}
+
+void SubmitWindow::expire(Clock::time_point now, const std::function<void(Submission&& submission)>& handler)
+{
+    dropCompletedHead();
+    while (!m_order.empty() && slot(m_order.front()).deadline <= now) {
+        Slot& target = slot(m_order.front());
+        m_order.pop_front();
+        Submission submission = std::move(target.submission);
+        release(target);
+        handler(std::move(submission));
+        dropCompletedHead();
+    }
+}
+
+SubmitWindow::Clock::time_point SubmitWindow::nextDeadline() const
+{
+    assert(!m_order.empty());
+    return slot(m_order.front()).deadline;
+}
+
+void SubmitWindow::drain(const std::function<void(Submission&& submission)>& handler)
+{
+    std::deque<std::uint32_t> order;
+    order.swap(m_order);
+    for (std::uint32_t sequenceNumber: order) {
+        Slot& target = slot(sequenceNumber);
+        if (target.sequenceNumber != sequenceNumber) continue;
+
+        Submission submission = std::move(target.submission);
+        release(target);
+        handler(std::move(submission));
+    }
+}
+
+std::uint32_t SubmitWindow::following(std::uint32_t sequenceNumber)
+{
+    return sequenceNumber >= 0x7FFFFFFF ? 1 : sequenceNumber + 1;
+}
+
+void SubmitWindow::release(Slot& slot)
+{
+    slot.sequenceNumber = 0;
+    slot.submission = Submission();
+    --m_outstanding;
+}
+
+void SubmitWindow::dropCompletedHead()
+{
+    while (!m_order.empty() && slot(m_order.front()).sequenceNumber != m_order.front()) m_order.pop_front();
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <string>
+#include <vector>
+
+
+// Исходящее сообщение для submit_sm. Владеет данными: оно живёт в очереди и
+// в окне, пока SMSC не ответит.
+struct OutboundMessage
+{
+    std::string serviceType;
+    std::uint8_t sourceAddrTon = 0;
+    std::uint8_t sourceAddrNpi = 0;
+    std::string sourceAddr;
+    std::uint8_t destAddrTon = 1;
+    std::uint8_t destAddrNpi = 1;
+    std::string destinationAddr;
+    std::uint8_t esmClass = 0;
+    std::uint8_t registeredDelivery = 0;
+    std::uint8_t dataCoding = 0;
+    std::string shortMessage;
+    // уже закодированные TLV (см. PDUWriter::writeTLV)
+    std::string tlvs;
+};
+
+struct SubmitResult
+{
+    enum Outcome {
+        Responded,  // пришёл submit_sm_resp или generic_nack, см. commandStatus
+        TimedOut,   // ответа не было дольше Settings::timeout
+        Aborted,    // сессия закрылась раньше ответа
+        Invalid     // сообщение не кодируется (поле длиннее допустимого)
+    };
+
+    Outcome outcome;
+    std::uint32_t commandStatus;
+    std::string messageId;
+};
+
+using SubmitCallback = std::function<void(const SubmitResult& result)>;
+
+struct Submission
+{
+    OutboundMessage message;
+    SubmitCallback callback;
+    // сколько раз SMSC уже отказал по перегрузке
+    std::uint32_t throttled = 0;
+};
+
+
+// Окно отправленных, но ещё не подтверждённых submit_sm. Номера
+// sequence_number растут монотонно и сами служат индексом в таблице слотов
+// (слотов - степень двойки не меньше двух окон), поэтому поиск ответа, даже
+// пришедшего не по порядку, - O(1). Номер, чей слот ещё занят старым
+// запросом, пропускается.
+//
+// Сроки ответа идут в порядке отправки, так что просроченные снимаются с
+// начала очереди, без перебора окна. Класс не потокобезопасен и живёт в
+// потоке цикла сессии.
+class SubmitWindow
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Settings
+    {
+        std::uint32_t size = 10;
+        // сколько сообщений может ждать места в окне, дальше submit отказывает
+        std::uint32_t queueLimit = 1000;
+        std::chrono::milliseconds timeout = std::chrono::milliseconds(30000);
+    };
+
+    explicit SubmitWindow(const Settings& settings);
+
+    const Settings& settings() const { return m_settings; }
+    std::uint32_t outstanding() const { return m_outstanding; }
+    bool isFull() const { return m_outstanding >= m_settings.size; }
+    bool isEmpty() const { return m_outstanding == 0; }
+
+    // номер для следующего open; пока open не вызван, номер не расходуется
+    std::uint32_t nextSequenceNumber() const;
+    // номер для PDU вне окна (enquire_link, unbind): расходуется сразу,
+    // чтобы не совпасть с номером следующего submit_sm
+    std::uint32_t takeSequenceNumber();
+    void open(std::uint32_t sequenceNumber, Submission&& submission, Clock::time_point now);
+    // false - такого запроса в окне нет (уже просрочен или чужой номер)
+    bool complete(std::uint32_t sequenceNumber, Submission& submission);
+
+    // снимает просроченные к now, по одному в handler
+    void expire(Clock::time_point now, const std::function<void(Submission&& submission)>& handler);
+    // срок ближайшего запроса; только для непустого окна
+    Clock::time_point nextDeadline() const;
+    // забирает всё окно в порядке отправки
+    void drain(const std::function<void(Submission&& submission)>& handler);
+
+private:
+    struct Slot
+    {
+        std::uint32_t sequenceNumber;  // 0 - слот свободен
+        Clock::time_point deadline;
+        Submission submission;
+    };
+
+    // номера 1..0x7FFFFFFF, SMPP 3.4, раздел 3.2
+    static std::uint32_t following(std::uint32_t sequenceNumber);
+    Slot& slot(std::uint32_t sequenceNumber) { return m_slots[sequenceNumber & m_mask]; }
+    const Slot& slot(std::uint32_t sequenceNumber) const { return m_slots[sequenceNumber & m_mask]; }
+    void release(Slot& slot);
+    void dropCompletedHead();
+
+private:
+    Settings m_settings;
+    std::vector<Slot> m_slots;
+    std::uint32_t m_mask;
+    std::uint32_t m_nextSequenceNumber;
+    std::uint32_t m_outstanding;
+    // номера в порядке отправки; уже подтверждённые выбрасываются, дойдя до начала
+    std::deque<std::uint32_t> m_order;
+};